@@ -0,0 +1,22 @@
+# Bench class - cycle counter and allocation counts implemented in C
+class Bench
+  # Run the block warmup times, then measure iterations runs one by one
+  # Returns {iterations:, min_ns:, median_ns:, max_ns:, median_cycles:, allocs:}
+  def self.measure(iterations, warmup = 3, &block)
+    i = 0
+    while i < warmup
+      block.call
+      i += 1
+    end
+
+    Bench.begin_run(iterations)
+    i = 0
+    while i < iterations
+      Bench.start
+      block.call
+      Bench.stop
+      i += 1
+    end
+    Bench.result
+  end
+end
@@ -0,0 +1,80 @@
+#include "bench_counter.h"
+#include "memory_heap.h"
+#include <stdlib.h>
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "Bench";
+
+// The VM task stays on one core, so its cycle counter is consistent
+// between start and stop (it wraps after ~17 s at 240 MHz)
+static uint32_t *samples = NULL;
+static uint32_t sample_count = 0;
+static uint32_t sample_max = 0;
+static uint32_t start_cycles = 0;
+static uint32_t start_allocs = 0;
+static uint32_t run_allocs = 0;
+static uint32_t run_stops = 0;
+
+uint32_t bench_alloc_count(void)
+{
+    return memory_heap_alloc_count();
+}
+
+bool bench_begin(uint32_t iterations)
+{
+    if (samples == NULL) {
+        samples = heap_caps_malloc(BENCH_MAX_SAMPLES * sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (samples == NULL) {
+            ESP_LOGE(TAG, "No memory for samples");
+            return false;
+        }
+    }
+
+    sample_count = 0;
+    sample_max = iterations < BENCH_MAX_SAMPLES ? iterations : BENCH_MAX_SAMPLES;
+    run_allocs = 0;
+    run_stops = 0;
+    return true;
+}
+
+void bench_start(void)
+{
+    start_allocs = memory_heap_alloc_count();
+    start_cycles = esp_cpu_get_cycle_count();
+}
+
+void bench_stop(void)
+{
+    uint32_t cycles = esp_cpu_get_cycle_count() - start_cycles;
+    run_allocs += memory_heap_alloc_count() - start_allocs;
+    run_stops++;
+    if (samples != NULL && sample_count < sample_max) {
+        samples[sample_count++] = cycles;
+    }
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+bool bench_result(bench_result_t *res)
+{
+    if (sample_count == 0) {
+        return false;
+    }
+
+    qsort(samples, sample_count, sizeof(uint32_t), compare_u32);
+    res->iterations = run_stops;
+    res->min_cycles = samples[0];
+    res->median_cycles = samples[sample_count / 2];
+    res->max_cycles = samples[sample_count - 1];
+    res->allocs = run_allocs;
+    res->cpu_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Most samples kept per run (longer runs keep the first ones)
+#define BENCH_MAX_SAMPLES    1024
+
+// Start a run of up to iterations samples
+// Returns false if there is no memory for the samples
+bool bench_begin(uint32_t iterations);
+
+// Start / stop one sample (cycles and mruby/c allocations in between)
+void bench_start(void);
+void bench_stop(void);
+
+typedef struct {
+    uint32_t iterations;     // samples taken (the times use the first BENCH_MAX_SAMPLES)
+    uint32_t min_cycles;
+    uint32_t median_cycles;
+    uint32_t max_cycles;
+    uint32_t allocs;         // mruby/c heap allocations over all samples
+    uint32_t cpu_mhz;
+} bench_result_t;
+
+// Result of the run (sorts the samples)
+// Returns false if no sample was taken
+bool bench_result(bench_result_t *res);
+
+// mruby/c heap allocations since boot
+uint32_t bench_alloc_count(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Bench Native mrubyc bindings
+ */
+
+#include "bench_counter.h"
+#include "spi_sweep.h"
+#include "render_queue.h"
+#include "esp_heap_caps.h"
+#include "native_hash.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Bench = NULL;
+
+// Cycles to ns (saturates past ~2 s)
+static int cycles_ns(uint32_t cycles, uint32_t mhz)
+{
+    uint64_t ns = (uint64_t)cycles * 1000 / mhz;
+    return ns > INT32_MAX ? INT32_MAX : (int)ns;
+}
+
+/* ==============================================
+ * Method: Bench.begin_run(iterations)
+ * Start a run (Bench.measure calls it)
+ * Returns: true if the samples could be allocated
+ * ============================================== */
+static void c_bench_begin_run(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_INTEGER || GET_INT_ARG(1) <= 0 ||
+        !bench_begin((uint32_t)GET_INT_ARG(1))) {
+        SET_FALSE_RETURN();
+        return;
+    }
+    SET_TRUE_RETURN();
+}
+
+/* ==============================================
+ * Method: Bench.start
+ * Method: Bench.stop
+ * Take one sample: cycles and mruby/c allocations in between
+ * ============================================== */
+static void c_bench_start(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bench_start();
+    SET_NIL_RETURN();
+}
+
+static void c_bench_stop(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bench_stop();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Bench.result
+ * Returns: {iterations:, min_ns:, median_ns:, max_ns:, median_cycles:,
+ *           allocs:} (allocs over all iterations), or nil
+ * ============================================== */
+static void c_bench_result(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bench_result_t res;
+    if (!bench_result(&res)) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    mrbc_value hash = mrbc_hash_new(vm, 6);
+    hash_set_int(&hash, "iterations", res.iterations);
+    hash_set_int(&hash, "min_ns", cycles_ns(res.min_cycles, res.cpu_mhz));
+    hash_set_int(&hash, "median_ns", cycles_ns(res.median_cycles, res.cpu_mhz));
+    hash_set_int(&hash, "max_ns", cycles_ns(res.max_cycles, res.cpu_mhz));
+    hash_set_int(&hash, "median_cycles", res.median_cycles > INT32_MAX ? INT32_MAX : (int)res.median_cycles);
+    hash_set_int(&hash, "allocs", res.allocs);
+
+    SET_RETURN(hash);
+}
+
+/* ==============================================
+ * Method: Bench.allocs
+ * Returns: mruby/c heap allocations since boot
+ * ============================================== */
+static void c_bench_allocs(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN(bench_alloc_count());
+}
+
+/* ==============================================
+ * Method: Bench.spi_sweep
+ * Write full frames over the panel SPI at each clock, transfer mode,
+ * buffer memory and chunk size (draws over the screen, redraw after)
+ * Returns: [{clock_khz:, queued:, dma:, sd:, chunk:, kb_per_s:,
+ *            overhead_x10:, sd_kb_per_s:}, ...], or nil without a panel
+ * ============================================== */
+static void c_bench_spi_sweep(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    render_fence();
+    spi_sweep_row_t *rows = heap_caps_malloc(SPI_SWEEP_MAX_ROWS * sizeof(spi_sweep_row_t),
+                                             MALLOC_CAP_8BIT);
+    int n = rows != NULL ? spi_sweep_run(rows, SPI_SWEEP_MAX_ROWS) : -1;
+    if (n < 0) {
+        heap_caps_free(rows);
+        SET_NIL_RETURN();
+        return;
+    }
+
+    mrbc_value ary = mrbc_array_new(vm, n > 0 ? n : 1);
+    for (int i = 0; i < n; i++) {
+        mrbc_value hash = mrbc_hash_new(vm, 8);
+        hash_set_int(&hash, "clock_khz", rows[i].clock_khz);
+        hash_set_bool(&hash, "queued", rows[i].queued);
+        hash_set_bool(&hash, "dma", rows[i].dma);
+        hash_set_bool(&hash, "sd", rows[i].sd);
+        hash_set_int(&hash, "chunk", rows[i].chunk);
+        hash_set_int(&hash, "kb_per_s", rows[i].kb_per_s);
+        hash_set_int(&hash, "overhead_x10", rows[i].overhead_x10);
+        hash_set_int(&hash, "sd_kb_per_s", rows[i].sd_kb_per_s);
+        mrbc_array_push(&ary, &hash);
+    }
+    heap_caps_free(rows);
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Initialize Bench class
+ * ============================================== */
+void mrbc_bench_init(mrbc_vm *vm)
+{
+    mrbc_class_Bench = mrbc_define_class(vm, "Bench", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Bench, "begin_run", c_bench_begin_run);
+    mrbc_define_method(vm, mrbc_class_Bench, "start", c_bench_start);
+    mrbc_define_method(vm, mrbc_class_Bench, "stop", c_bench_stop);
+    mrbc_define_method(vm, mrbc_class_Bench, "result", c_bench_result);
+    mrbc_define_method(vm, mrbc_class_Bench, "allocs", c_bench_allocs);
+    mrbc_define_method(vm, mrbc_class_Bench, "spi_sweep", c_bench_spi_sweep);
+}
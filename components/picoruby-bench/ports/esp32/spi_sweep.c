@@ -0,0 +1,213 @@
+#include "spi_sweep.h"
+#include "st7789_spi.h"
+#include "sdcard_driver.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "SPISweep";
+
+// Above 62.5 MHz the panel is out of spec (the last clock shows the headroom)
+static const int sweep_clocks[SPI_SWEEP_CLOCKS] = {
+    20 * 1000 * 1000,
+    26666667,
+    40 * 1000 * 1000,
+    80 * 1000 * 1000,
+};
+
+static const uint32_t sweep_chunks[SPI_SWEEP_CHUNKS] = {64, 512, 4096, SPI_SWEEP_MAX_CHUNK};
+
+// SD rows: queued DMA chunks, with a card read after every SD_EVERY bytes
+#define SD_ROW_CHUNK     4096
+#define SD_EVERY         16384
+#define SD_SECTORS       8
+#define SD_SECTOR        0       // only read, any sector will do
+
+static spi_transaction_t trans[SPI_SWEEP_QUEUE_DEPTH];
+
+typedef struct {
+    uint32_t xfers;
+    int64_t elapsed_us;
+    int64_t sd_us;
+    uint32_t sd_bytes;
+} frame_run_t;
+
+static bool wait_one(spi_device_handle_t dev, int *pending)
+{
+    spi_transaction_t *done;
+    if (spi_device_get_trans_result(dev, &done, portMAX_DELAY) != ESP_OK) {
+        return false;
+    }
+    (*pending)--;
+    return true;
+}
+
+// Write one frame of buf in chunk sized transactions
+static bool send_frame(const uint8_t *buf, uint32_t chunk, bool queued, uint8_t *sd_buf,
+                       frame_run_t *run)
+{
+    spi_device_handle_t dev = st7789_spi_device();
+    int16_t w = st7789_width();
+    int16_t h = st7789_height();
+    memset(run, 0, sizeof(*run));
+
+    st7789_begin_write(0, 0, w - 1, h - 1);
+    int64_t start = esp_timer_get_time();
+
+    uint32_t left = (uint32_t)w * h * 2;
+    uint32_t since_sd = 0;
+    int pending = 0;
+    int next = 0;
+    bool ok = true;
+    while (ok && left > 0) {
+        uint32_t n = left < chunk ? left : chunk;
+
+        // Results come back in order, so the oldest slot is the next one
+        if (queued && pending == SPI_SWEEP_QUEUE_DEPTH) {
+            ok = wait_one(dev, &pending);
+        }
+        spi_transaction_t *t = &trans[next];
+        *t = (spi_transaction_t){
+            .length = n * 8,
+            .tx_buffer = buf,
+            .user = (void*)1,  // DC = 1 for data
+        };
+        if (queued) {
+            // Only a queued transaction has a result to wait for
+            ok = ok && spi_device_queue_trans(dev, t, portMAX_DELAY) == ESP_OK;
+            if (ok) {
+                pending++;
+                next = (next + 1) % SPI_SWEEP_QUEUE_DEPTH;
+            }
+        } else {
+            ok = ok && spi_device_polling_transmit(dev, t) == ESP_OK;
+        }
+        if (!ok) {
+            break;
+        }
+        run->xfers++;
+        left -= n;
+        since_sd += n;
+
+        // The card needs the bus to itself: drain the queue first
+        if (ok && sd_buf != NULL && since_sd >= SD_EVERY) {
+            while (ok && pending > 0) {
+                ok = wait_one(dev, &pending);
+            }
+            int64_t sd_start = esp_timer_get_time();
+            ok = ok && sdcard_read_sectors(SD_SECTOR, sd_buf, SD_SECTORS);
+            run->sd_us += esp_timer_get_time() - sd_start;
+            run->sd_bytes += SD_SECTORS * 512;
+            since_sd = 0;
+        }
+    }
+    while (pending > 0 && wait_one(dev, &pending)) {
+    }
+
+    run->elapsed_us = esp_timer_get_time() - start;
+    return ok && run->elapsed_us > 0;
+}
+
+static bool run_one(spi_sweep_row_t *row, uint32_t clock_khz, const uint8_t *buf, bool dma,
+                    uint32_t chunk, bool queued, uint8_t *sd_buf)
+{
+    frame_run_t run;
+    bool ok = send_frame(buf, chunk, queued, sd_buf, &run);
+
+    // Let the idle task feed the watchdog between runs
+    vTaskDelay(1);
+    if (!ok) {
+        ESP_LOGW(TAG, "Run failed at %u kHz, chunk %u", (unsigned)clock_khz, (unsigned)chunk);
+        return false;
+    }
+
+    uint64_t bytes = (uint64_t)st7789_width() * st7789_height() * 2;
+    int64_t wire_us = (int64_t)(bytes * 8 * 1000 / clock_khz);
+    int64_t panel_us = run.elapsed_us - run.sd_us;
+
+    *row = (spi_sweep_row_t){
+        .clock_khz = clock_khz,
+        .queued = queued,
+        .dma = dma,
+        .sd = sd_buf != NULL,
+        .chunk = chunk,
+        .kb_per_s = (uint32_t)(bytes * 1000000 / 1024 / run.elapsed_us),
+        .overhead_x10 = (int32_t)((panel_us - wire_us) * 10 / run.xfers),
+        .sd_kb_per_s = (uint32_t)((uint64_t)run.sd_bytes * 1000000 / 1024 / run.elapsed_us),
+    };
+    return true;
+}
+
+int spi_sweep_run(spi_sweep_row_t *rows, int max)
+{
+    if (st7789_spi_device() == NULL) {
+        return -1;
+    }
+
+    // Gray frames, from a buffer the DMA can read and one it cannot
+    uint8_t *dma_buf = heap_caps_malloc(SPI_SWEEP_MAX_CHUNK, MALLOC_CAP_DMA);
+    uint8_t *psram_buf = heap_caps_malloc(SPI_SWEEP_MAX_CHUNK, MALLOC_CAP_SPIRAM);
+    uint8_t *sd_buf = heap_caps_malloc(SD_SECTORS * 512, MALLOC_CAP_DMA);
+    if (dma_buf == NULL) {
+        ESP_LOGE(TAG, "No DMA memory for the sweep");
+        heap_caps_free(psram_buf);
+        heap_caps_free(sd_buf);
+        return 0;
+    }
+    for (int i = 0; i < SPI_SWEEP_MAX_CHUNK; i += 2) {
+        dma_buf[i] = 0x84;
+        dma_buf[i + 1] = 0x10;
+    }
+    if (psram_buf != NULL) {
+        memcpy(psram_buf, dma_buf, SPI_SWEEP_MAX_CHUNK);
+    }
+
+    // One session for the whole sweep, so SD rows time reads only
+    bool sd_ok = sd_buf != NULL && sdcard_session_open();
+
+    int orig_hz = st7789_spi_clock();
+    int n = 0;
+    for (int c = 0; c < SPI_SWEEP_CLOCKS; c++) {
+        int khz = 0;
+        if (!st7789_set_spi_clock(sweep_clocks[c]) ||
+            spi_device_get_actual_freq(st7789_spi_device(), &khz) != ESP_OK || khz <= 0) {
+            ESP_LOGW(TAG, "Skipping %d Hz", sweep_clocks[c]);
+            continue;
+        }
+
+        for (int queued = 0; queued < 2; queued++) {
+            for (int dma = 1; dma >= 0; dma--) {
+                const uint8_t *buf = dma ? dma_buf : psram_buf;
+                if (buf == NULL) {
+                    continue;
+                }
+                for (int k = 0; k < SPI_SWEEP_CHUNKS && n < max; k++) {
+                    if (run_one(&rows[n], khz, buf, dma, sweep_chunks[k], queued, NULL)) {
+                        n++;
+                    }
+                }
+            }
+        }
+
+        if (sd_ok && n < max &&
+            run_one(&rows[n], khz, dma_buf, true, SD_ROW_CHUNK, true, sd_buf)) {
+            n++;
+        }
+    }
+
+    if (!st7789_set_spi_clock(orig_hz)) {
+        ESP_LOGE(TAG, "Failed to restore the panel clock");
+    }
+    if (sd_ok) {
+        sdcard_session_close();
+    }
+    heap_caps_free(dma_buf);
+    heap_caps_free(psram_buf);
+    heap_caps_free(sd_buf);
+
+    ESP_LOGI(TAG, "%d runs", n);
+    return n;
+}
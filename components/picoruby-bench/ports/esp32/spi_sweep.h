@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Panel SPI sweep: every combination writes one full frame
+// clocks x (polling, queued) x (DMA buffer, PSRAM buffer) x chunk sizes,
+// plus one run per clock with the SD card reading between chunks
+#define SPI_SWEEP_CLOCKS       4
+#define SPI_SWEEP_CHUNKS       4
+#define SPI_SWEEP_MAX_CHUNK    16384
+#define SPI_SWEEP_QUEUE_DEPTH  6       // below ST7789_SPI_QUEUE_SIZE
+#define SPI_SWEEP_MAX_ROWS     (SPI_SWEEP_CLOCKS * (2 * 2 * SPI_SWEEP_CHUNKS + 1))
+
+typedef struct {
+    uint32_t clock_khz;      // what the driver actually set
+    bool queued;             // queue_trans / get_trans_result instead of polling
+    bool dma;                // buffer in DMA capable RAM (PSRAM is bounced)
+    bool sd;                 // SD card reads shared the bus
+    uint32_t chunk;          // bytes per transaction
+    uint32_t kb_per_s;       // panel bytes over the whole run
+    int32_t overhead_x10;    // us x 10 per transaction beyond the bits on the wire
+    uint32_t sd_kb_per_s;    // SD bytes over the whole run (sd rows)
+} spi_sweep_row_t;
+
+// Run the sweep on the panel (it draws over the screen, the caller
+// redraws) and put the clock back afterwards
+// Returns rows filled, or -1 if the panel is not initialized
+int spi_sweep_run(spi_sweep_row_t *rows, int max);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,9 @@
+/*
+ * Bench mrubyc initialization stub
+ * Actual implementation is in ports/esp32/bench_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/bench_native.c */
+extern void mrbc_bench_init(mrbc_vm *vm);
@@ -0,0 +1,3 @@
+# Checker class - implemented in C
+class Checker
+end
@@ -0,0 +1,87 @@
+/*
+ * Checker Native mrubyc bindings
+ */
+
+#include "checker_task.h"
+#include "native_hash.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Checker = NULL;
+
+/* ==============================================
+ * Method: Checker.submit(source)
+ * Check the source for syntax errors on the other core
+ * (Event::CHECK is posted when the result is ready)
+ * Returns: buffer version, or nil if the source is too long
+ * ============================================== */
+static void c_checker_submit(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_STRING) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    uint32_t version = checker_submit((const char *)GET_STRING_ARG(1), mrbc_string_size(&v[1]));
+    if (version == 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+    SET_INT_RETURN((mrbc_int_t)(int32_t)version);
+}
+
+/* ==============================================
+ * Method: Checker.result
+ * Result of the last submit, returned once
+ * Returns: [version, line, col, message] (line 0 = no error, col 0-based),
+ *          or nil while it is parsed / already returned
+ * ============================================== */
+static void c_checker_result(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    checker_result_t res;
+    if (!checker_take_result(&res)) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    mrbc_value ary = mrbc_array_new(vm, 4);
+    mrbc_value val = mrbc_integer_value((mrbc_int_t)(int32_t)res.version);
+    mrbc_array_push(&ary, &val);
+    val = mrbc_integer_value(res.line);
+    mrbc_array_push(&ary, &val);
+    val = mrbc_integer_value(res.col);
+    mrbc_array_push(&ary, &val);
+    val = mrbc_string_new_cstr(vm, res.message);
+    mrbc_array_push(&ary, &val);
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Method: Checker.stats
+ * Returns: {parses:, cache_hits:, last_parse_us:}
+ * ============================================== */
+static void c_checker_stats(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    checker_stats_t st;
+    checker_get_stats(&st);
+
+    mrbc_value hash = mrbc_hash_new(vm, 3);
+    hash_set_int(&hash, "parses", st.parses);
+    hash_set_int(&hash, "cache_hits", st.cache_hits);
+    hash_set_int(&hash, "last_parse_us", st.last_parse_us);
+
+    SET_RETURN(hash);
+}
+
+/* ==============================================
+ * Initialize Checker class
+ * ============================================== */
+void mrbc_checker_init(mrbc_vm *vm)
+{
+    mrbc_class_Checker = mrbc_define_class(vm, "Checker", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Checker, "submit", c_checker_submit);
+    mrbc_define_method(vm, mrbc_class_Checker, "result", c_checker_result);
+    mrbc_define_method(vm, mrbc_class_Checker, "stats", c_checker_stats);
+}
@@ -0,0 +1,268 @@
+#include "checker_task.h"
+#include "event_queue.h"
+#include "memory_heap.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "prism.h"
+
+static const char *TAG = "Checker";
+
+// The parser's mruby/c heap allocations go to the system heap instead
+// (memory_heap_set_side_task), so it parses while the VM runs. state_lock
+// guards the state below; the parse itself runs on a copy of the snapshot.
+static TaskHandle_t checker_task = NULL;
+static SemaphoreHandle_t state_lock = NULL;
+
+static char *snapshot = NULL;
+static size_t snapshot_len = 0;
+static size_t snapshot_cap = 0;
+
+// Checker task only
+static char *parse_buf = NULL;
+static size_t parse_cap = 0;
+
+static uint32_t wanted = 0;      // version of the last submit
+static bool pending = false;     // wanted is not parsed yet
+static bool fresh = false;       // latest has not been taken
+static checker_result_t latest;
+
+static checker_result_t cache[CHECKER_CACHE];
+static int cache_count = 0;
+static int cache_next = 0;
+
+static checker_stats_t stats;
+
+// FNV-1a, mixed with the length
+static uint32_t source_version(const char *src, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)src[i];
+        h *= 16777619u;
+    }
+    h ^= (uint32_t)len;
+    return h != 0 ? h : 1;
+}
+
+static checker_result_t *cache_find(uint32_t version)
+{
+    for (int i = 0; i < cache_count; i++) {
+        if (cache[i].version == version) {
+            return &cache[i];
+        }
+    }
+    return NULL;
+}
+
+static void cache_put(const checker_result_t *res)
+{
+    cache[cache_next] = *res;
+    cache_next = (cache_next + 1) % CHECKER_CACHE;
+    if (cache_count < CHECKER_CACHE) {
+        cache_count++;
+    }
+}
+
+// First syntax error of the bundled compiler's parser
+static void parse_source(const char *src, size_t len, checker_result_t *res)
+{
+    pm_parser_t parser;
+    pm_parser_init(&parser, (const uint8_t *)src, len, NULL);
+    pm_node_t *node = pm_parse(&parser);
+
+    const pm_diagnostic_t *err = (const pm_diagnostic_t *)parser.error_list.head;
+    if (err != NULL) {
+        pm_line_column_t lc = pm_newline_list_line_column(&parser.newline_list, err->location.start,
+                                                          parser.start_line);
+        res->line = lc.line > 0 ? (uint32_t)lc.line : 1;
+        res->col = lc.column;
+        strncpy(res->message, err->message, CHECKER_MESSAGE_MAX - 1);
+        res->message[CHECKER_MESSAGE_MAX - 1] = '\0';
+    }
+
+    pm_node_destroy(&parser, node);
+    pm_parser_free(&parser);
+}
+
+// Grow *buf to hold len bytes and a NUL
+static bool ensure_buffer(char **buf, size_t *cap, size_t len)
+{
+    if (*cap > len) {
+        return true;
+    }
+
+    size_t size = *cap > 0 ? *cap : 1024;
+    while (size <= len) {
+        size *= 2;
+    }
+
+    char *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p == NULL) {
+        p = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (p == NULL) {
+        ESP_LOGE(TAG, "No memory for a %u byte snapshot", (unsigned)len);
+        return false;
+    }
+
+    heap_caps_free(*buf);
+    *buf = p;
+    *cap = size;
+    return true;
+}
+
+static void checker_loop(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        xSemaphoreTake(state_lock, portMAX_DELAY);
+        if (!pending || !ensure_buffer(&parse_buf, &parse_cap, snapshot_len)) {
+            xSemaphoreGive(state_lock);
+            continue;
+        }
+        uint32_t version = wanted;
+        size_t len = snapshot_len;
+        memcpy(parse_buf, snapshot, len + 1);
+        xSemaphoreGive(state_lock);
+
+        int64_t start = esp_timer_get_time();
+        checker_result_t res = { .version = version };
+        parse_source(parse_buf, len, &res);
+        uint32_t parse_us = (uint32_t)(esp_timer_get_time() - start);
+
+        // A newer submit notified the task again, this result only goes
+        // to the cache
+        xSemaphoreTake(state_lock, portMAX_DELAY);
+        stats.parses++;
+        stats.last_parse_us = parse_us;
+        cache_put(&res);
+        bool current = pending && version == wanted;
+        if (current) {
+            latest = res;
+            pending = false;
+            fresh = true;
+        }
+        xSemaphoreGive(state_lock);
+
+        if (current) {
+            event_post(EVENT_CHECK);
+        }
+    }
+}
+
+// Create the task (and the lock) on the first submit that needs a parse
+static bool start_task(void)
+{
+    if (checker_task != NULL) {
+        return true;
+    }
+
+    state_lock = xSemaphoreCreateMutex();
+    if (state_lock == NULL ||
+        xTaskCreatePinnedToCore(checker_loop, "checker", CHECKER_STACK_SIZE, NULL,
+                                CHECKER_PRIORITY, &checker_task, CHECKER_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create checker task");
+        if (state_lock != NULL) {
+            vSemaphoreDelete(state_lock);
+            state_lock = NULL;
+        }
+        checker_task = NULL;
+        return false;
+    }
+    memory_heap_set_side_task(checker_task);
+    return true;
+}
+
+// No-ops until the task exists: the VM is the only user then
+static void lock_state(void)
+{
+    if (state_lock != NULL) {
+        xSemaphoreTake(state_lock, portMAX_DELAY);
+    }
+}
+
+static void unlock_state(void)
+{
+    if (state_lock != NULL) {
+        xSemaphoreGive(state_lock);
+    }
+}
+
+uint32_t checker_submit(const char *src, size_t len)
+{
+    if (len > CHECKER_SOURCE_MAX) {
+        return 0;
+    }
+
+    uint32_t version = source_version(src, len);
+    lock_state();
+    if (version == wanted) {
+        unlock_state();
+        return version;
+    }
+
+    checker_result_t *hit = cache_find(version);
+    if (hit != NULL) {
+        stats.cache_hits++;
+        wanted = version;
+        latest = *hit;
+        pending = false;
+        fresh = true;
+        unlock_state();
+        return version;
+    }
+    unlock_state();
+
+    if (!start_task()) {
+        return 0;
+    }
+
+    lock_state();
+    if (!ensure_buffer(&snapshot, &snapshot_cap, len)) {
+        unlock_state();
+        return 0;
+    }
+    memcpy(snapshot, src, len);
+    snapshot[len] = '\0';
+    snapshot_len = len;
+    wanted = version;
+    pending = true;
+    fresh = false;
+    unlock_state();
+
+    xTaskNotifyGive(checker_task);
+    return version;
+}
+
+bool checker_take_result(checker_result_t *out)
+{
+    lock_state();
+    bool ready = !pending && fresh;
+    if (ready) {
+        *out = latest;
+        fresh = false;
+    }
+    unlock_state();
+    return ready;
+}
+
+bool checker_busy(void)
+{
+    lock_state();
+    bool busy = pending;
+    unlock_state();
+    return busy;
+}
+
+void checker_get_stats(checker_stats_t *st)
+{
+    lock_state();
+    *st = stats;
+    unlock_state();
+}
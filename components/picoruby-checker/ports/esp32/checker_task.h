@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Results kept by buffer version (hash of the source)
+#define CHECKER_CACHE         8
+
+// Longer sources are not checked
+#define CHECKER_SOURCE_MAX    32768
+
+// Bytes of the error message kept
+#define CHECKER_MESSAGE_MAX   48
+
+// The VM runs on core 0, the checker on the other core below the keyboard
+#define CHECKER_CORE          1
+#define CHECKER_PRIORITY      1
+#define CHECKER_STACK_SIZE    12288
+
+typedef struct {
+    uint32_t version;   // hash of the checked source
+    uint32_t line;      // 1-based line of the first syntax error, 0 if none
+    uint32_t col;       // 0-based byte column
+    char message[CHECKER_MESSAGE_MAX];
+} checker_result_t;
+
+// Hand a snapshot of the buffer to the checker task (copied)
+// A version checked before is answered from the cache without parsing
+// Returns the version, or 0 if the source is too long
+uint32_t checker_submit(const char *src, size_t len);
+
+// Result for the last submitted version, once
+// Returns false while it is being parsed or after it was taken
+bool checker_take_result(checker_result_t *out);
+
+// A submitted source is waiting for or in the parse
+bool checker_busy(void);
+
+typedef struct {
+    uint32_t parses;
+    uint32_t cache_hits;
+    uint32_t last_parse_us;
+} checker_stats_t;
+
+void checker_get_stats(checker_stats_t *st);
+
+#ifdef __cplusplus
+}
+#endif
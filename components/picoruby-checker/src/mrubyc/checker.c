@@ -0,0 +1,9 @@
+/*
+ * Checker mrubyc initialization stub
+ * Actual implementation is in ports/esp32/checker_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/checker_native.c */
+extern void mrbc_checker_init(mrbc_vm *vm);
@@ -0,0 +1,3 @@
+# Console class - implemented in C
+class Console
+end
@@ -0,0 +1,97 @@
+#include "console_buffer.h"
+
+#define DATA_MASK (CONSOLE_BUFFER_SIZE - 1)
+#define LINE_MASK (CONSOLE_MAX_LINES - 1)
+
+typedef struct {
+    uint32_t start;  // absolute byte offset of the first character
+    uint16_t len;
+} console_line_t;
+
+// Only the VM task touches the console, no locking needed
+static char data[CONSOLE_BUFFER_SIZE];
+static console_line_t lines[CONSOLE_MAX_LINES];
+static uint32_t written = 0;     // bytes ever written
+static uint32_t first_line = 0;  // oldest retained line
+static uint32_t open_line = 0;   // line being written
+static uint32_t version = 0;
+
+#define LINE(n) lines[(n) & LINE_MASK]
+
+static void start_line(void)
+{
+    open_line++;
+    if (open_line - first_line >= CONSOLE_MAX_LINES) {
+        first_line++;
+    }
+    LINE(open_line).start = written;
+    LINE(open_line).len = 0;
+}
+
+static void put_char(char c)
+{
+    if (c == '\n') {
+        start_line();
+        return;
+    }
+    if (c == '\r') {
+        return;
+    }
+    if (LINE(open_line).len >= CONSOLE_LINE_MAX) {
+        start_line();
+    }
+
+    data[written & DATA_MASK] = c;
+    written++;
+    LINE(open_line).len++;
+
+    // Drop lines whose text was overwritten
+    while (first_line != open_line && written - LINE(first_line).start > CONSOLE_BUFFER_SIZE) {
+        first_line++;
+    }
+}
+
+void console_write(const char *text, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        put_char(text[i]);
+    }
+    version++;
+}
+
+void console_clear(void)
+{
+    start_line();
+    first_line = open_line;
+    version++;
+}
+
+uint32_t console_first_line(void)
+{
+    return first_line;
+}
+
+uint32_t console_last_line(void)
+{
+    // The open line counts once it has text
+    return LINE(open_line).len > 0 ? open_line : open_line - 1;
+}
+
+int console_line(uint32_t line, char *out, size_t max)
+{
+    if (line - first_line > open_line - first_line) {
+        return -1;
+    }
+
+    console_line_t *l = &LINE(line);
+    size_t len = l->len < max ? l->len : max;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = data[(l->start + i) & DATA_MASK];
+    }
+    return (int)len;
+}
+
+uint32_t console_version(void)
+{
+    return version;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Byte ring for line text (power of 2)
+#define CONSOLE_BUFFER_SIZE  8192
+
+// Line index ring (power of 2)
+#define CONSOLE_MAX_LINES    512
+
+// Longer lines are wrapped into several lines
+#define CONSOLE_LINE_MAX     160
+
+// Append text ('\n' ends a line, '\r' is ignored)
+// Oldest lines are dropped when the byte or line ring is full
+void console_write(const char *text, size_t len);
+
+// Drop all lines (line numbers keep counting up)
+void console_clear(void);
+
+// Line numbers are absolute and never reused:
+// retained lines are first_line .. last_line (empty when last < first)
+uint32_t console_first_line(void);
+uint32_t console_last_line(void);
+
+// Copy line text into out (not terminated), returns its length
+// or -1 if the line is no longer (or not yet) in the buffer
+int console_line(uint32_t line, char *out, size_t max);
+
+// Bumped on every write and clear
+uint32_t console_version(void);
+
+#ifdef __cplusplus
+}
+#endif
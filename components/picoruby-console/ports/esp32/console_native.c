@@ -0,0 +1,92 @@
+/*
+ * Console Native mrubyc bindings
+ */
+
+#include "console_buffer.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Console = NULL;
+
+/* ==============================================
+ * Method: Console.write(str)
+ * Append text to the scrollback buffer
+ * ============================================== */
+static void c_console_write(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc >= 1 && mrbc_type(v[1]) == MRBC_TT_STRING) {
+        console_write((const char *)GET_STRING_ARG(1), mrbc_string_size(&v[1]));
+    }
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Console.clear
+ * Drop all lines
+ * ============================================== */
+static void c_console_clear(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    console_clear();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Console.first_line / Console.last_line
+ * Absolute numbers of the oldest and newest retained line
+ * (last_line < first_line when the console is empty)
+ * ============================================== */
+static void c_console_first_line(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN((mrbc_int_t)console_first_line());
+}
+
+static void c_console_last_line(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN((mrbc_int_t)(int32_t)console_last_line());
+}
+
+/* ==============================================
+ * Method: Console.line(n)
+ * Text of line n
+ * Returns: String or nil if the line is not in the buffer
+ * ============================================== */
+static void c_console_line(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_INTEGER) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    char buf[CONSOLE_LINE_MAX];
+    int len = console_line((uint32_t)GET_INT_ARG(1), buf, sizeof(buf));
+    if (len < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    SET_RETURN(mrbc_string_new(vm, buf, len));
+}
+
+/* ==============================================
+ * Method: Console.version
+ * Changes on every write and clear (cheap redraw check)
+ * ============================================== */
+static void c_console_version(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN((mrbc_int_t)(console_version() & 0x3FFFFFFF));
+}
+
+/* ==============================================
+ * Initialize Console class
+ * ============================================== */
+void mrbc_console_init(mrbc_vm *vm)
+{
+    mrbc_class_Console = mrbc_define_class(vm, "Console", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Console, "write", c_console_write);
+    mrbc_define_method(vm, mrbc_class_Console, "clear", c_console_clear);
+    mrbc_define_method(vm, mrbc_class_Console, "first_line", c_console_first_line);
+    mrbc_define_method(vm, mrbc_class_Console, "last_line", c_console_last_line);
+    mrbc_define_method(vm, mrbc_class_Console, "line", c_console_line);
+    mrbc_define_method(vm, mrbc_class_Console, "version", c_console_version);
+}
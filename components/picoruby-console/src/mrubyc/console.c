@@ -0,0 +1,9 @@
+/*
+ * Console mrubyc initialization stub
+ * Actual implementation is in ports/esp32/console_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/console_native.c */
+extern void mrbc_console_init(mrbc_vm *vm);
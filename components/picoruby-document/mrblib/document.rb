@@ -0,0 +1,3 @@
+# Document class - implemented in C
+class Document
+end
@@ -0,0 +1,223 @@
+/*
+ * Document Native mrubyc bindings
+ */
+
+#include "document_store.h"
+#include "native_hash.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Document = NULL;
+
+static void set_bool_return(mrbc_value *v, bool ok)
+{
+    if (ok) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Document.open(doc)
+ * Open document 0-3 (unsaved edits of the open one are dropped)
+ * Returns: number of lines, or nil if it cannot be read
+ * ============================================== */
+static void c_document_open(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_INTEGER || !document_open(GET_INT_ARG(1))) {
+        SET_NIL_RETURN();
+        return;
+    }
+    SET_INT_RETURN((mrbc_int_t)document_lines());
+}
+
+/* ==============================================
+ * Method: Document.close
+ * ============================================== */
+static void c_document_close(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    document_close();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Document.current
+ * Returns: number of the open document, or nil
+ * ============================================== */
+static void c_document_current(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int doc = document_current();
+    if (doc < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+    SET_INT_RETURN(doc);
+}
+
+/* ==============================================
+ * Method: Document.lines
+ * Line count including unsaved edits
+ * ============================================== */
+static void c_document_lines(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN((mrbc_int_t)document_lines());
+}
+
+/* ==============================================
+ * Method: Document.line(n)
+ * Text of line n (without newline, truncated to 256 bytes)
+ * Returns: String or nil if out of range
+ * ============================================== */
+static void c_document_line(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_INTEGER || GET_INT_ARG(1) < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    char buf[DOC_LINE_MAX];
+    int len = document_line((uint32_t)GET_INT_ARG(1), buf, sizeof(buf));
+    if (len < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    SET_RETURN(mrbc_string_new(vm, buf, len < DOC_LINE_MAX ? len : DOC_LINE_MAX));
+}
+
+/* ==============================================
+ * Method: Document.line_size(n)
+ * Full length of line n, also past the 256 bytes Document.line returns
+ * Returns: bytes or nil if out of range
+ * ============================================== */
+static void c_document_line_size(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_INTEGER || GET_INT_ARG(1) < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    char buf[1];
+    int len = document_line((uint32_t)GET_INT_ARG(1), buf, 0);
+    if (len < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+    SET_INT_RETURN(len);
+}
+
+/* ==============================================
+ * Method: Document.set_line(n, str)
+ * Method: Document.insert_line(n, str)
+ * Method: Document.delete_line(n)
+ * Edits stay in RAM until Document.save
+ * Returns: true on success, false also for text over 256 bytes
+ * ============================================== */
+static bool line_edit_args(mrbc_value *v, int argc, bool with_text)
+{
+    if (argc < (with_text ? 2 : 1) || mrbc_type(v[1]) != MRBC_TT_INTEGER || GET_INT_ARG(1) < 0) {
+        return false;
+    }
+    return !with_text || mrbc_type(v[2]) == MRBC_TT_STRING;
+}
+
+static void c_document_set_line(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bool ok = line_edit_args(v, argc, true) &&
+              document_set_line((uint32_t)GET_INT_ARG(1), (const char *)GET_STRING_ARG(2), mrbc_string_size(&v[2]));
+    set_bool_return(v, ok);
+}
+
+static void c_document_insert_line(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bool ok = line_edit_args(v, argc, true) &&
+              document_insert_line((uint32_t)GET_INT_ARG(1), (const char *)GET_STRING_ARG(2), mrbc_string_size(&v[2]));
+    set_bool_return(v, ok);
+}
+
+static void c_document_delete_line(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bool ok = line_edit_args(v, argc, false) && document_delete_line((uint32_t)GET_INT_ARG(1));
+    set_bool_return(v, ok);
+}
+
+/* ==============================================
+ * Method: Document.modified?
+ * ============================================== */
+static void c_document_modified(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    set_bool_return(v, document_modified());
+}
+
+/* ==============================================
+ * Method: Document.save
+ * Merge the edits into the document on the SD Card
+ * Returns: true on success
+ * ============================================== */
+static void c_document_save(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    set_bool_return(v, document_save());
+}
+
+/* ==============================================
+ * Method: Document.clear(doc)
+ * Method: Document.append(doc, str)
+ * Write to a document that is not open (e.g. logging)
+ * Returns: true on success
+ * ============================================== */
+static void c_document_clear(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bool ok = argc >= 1 && mrbc_type(v[1]) == MRBC_TT_INTEGER && document_clear(GET_INT_ARG(1));
+    set_bool_return(v, ok);
+}
+
+static void c_document_append(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bool ok = argc >= 2 && mrbc_type(v[1]) == MRBC_TT_INTEGER && mrbc_type(v[2]) == MRBC_TT_STRING &&
+              document_append(GET_INT_ARG(1), (const char *)GET_STRING_ARG(2), mrbc_string_size(&v[2]));
+    set_bool_return(v, ok);
+}
+
+/* ==============================================
+ * Method: Document.stats
+ * Returns: {bytes:, lines:, spans:, index_bytes:, cache_hits:, cache_misses:}
+ * ============================================== */
+static void c_document_stats(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    document_stats_t st;
+    document_get_stats(&st);
+
+    mrbc_value hash = mrbc_hash_new(vm, 6);
+    hash_set_int(&hash, "bytes", st.bytes);
+    hash_set_int(&hash, "lines", st.lines);
+    hash_set_int(&hash, "spans", st.spans);
+    hash_set_int(&hash, "index_bytes", st.index_bytes);
+    hash_set_int(&hash, "cache_hits", st.cache_hits);
+    hash_set_int(&hash, "cache_misses", st.cache_misses);
+
+    SET_RETURN(hash);
+}
+
+/* ==============================================
+ * Initialize Document class
+ * ============================================== */
+void mrbc_document_init(mrbc_vm *vm)
+{
+    mrbc_class_Document = mrbc_define_class(vm, "Document", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Document, "open", c_document_open);
+    mrbc_define_method(vm, mrbc_class_Document, "close", c_document_close);
+    mrbc_define_method(vm, mrbc_class_Document, "current", c_document_current);
+    mrbc_define_method(vm, mrbc_class_Document, "lines", c_document_lines);
+    mrbc_define_method(vm, mrbc_class_Document, "line", c_document_line);
+    mrbc_define_method(vm, mrbc_class_Document, "line_size", c_document_line_size);
+    mrbc_define_method(vm, mrbc_class_Document, "set_line", c_document_set_line);
+    mrbc_define_method(vm, mrbc_class_Document, "insert_line", c_document_insert_line);
+    mrbc_define_method(vm, mrbc_class_Document, "delete_line", c_document_delete_line);
+    mrbc_define_method(vm, mrbc_class_Document, "modified?", c_document_modified);
+    mrbc_define_method(vm, mrbc_class_Document, "save", c_document_save);
+    mrbc_define_method(vm, mrbc_class_Document, "clear", c_document_clear);
+    mrbc_define_method(vm, mrbc_class_Document, "append", c_document_append);
+    mrbc_define_method(vm, mrbc_class_Document, "stats", c_document_stats);
+}
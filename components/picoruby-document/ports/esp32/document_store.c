@@ -0,0 +1,784 @@
+#include "document_store.h"
+#include "sdcard_driver.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char *TAG = "Document";
+
+#define DOC_MAGIC            0x434F4450u  // "PDOC"
+#define DOC_HEADER_SECTOR(doc) (SDCARD_FREE_START_SECTOR + (doc))
+#define DOC_DATA_SECTOR(doc, side) \
+    (SDCARD_FREE_START_SECTOR + 8 + ((doc) * 2 + (side)) * DOC_REGION_SECTORS)
+
+// Streaming buffer for open (index build), save and append
+#define DOC_STREAM_SIZE      4096
+
+#define DOC_ADDED            UINT32_MAX
+#define PAGE_NONE            UINT32_MAX
+
+typedef struct {
+    uint32_t side;
+    uint32_t len;
+    uint32_t gen;
+} doc_header_t;
+
+// Edit overlay: the document is a list of spans, either a run of
+// original lines or one added line held in RAM
+typedef struct {
+    uint32_t start;  // first original line, or DOC_ADDED
+    uint32_t count;  // lines in the span (1 for an added line)
+    char *text;      // added line text
+    uint16_t len;
+} doc_span_t;
+
+static int cur_doc = -1;
+static doc_header_t cur;
+static uint32_t orig_lines = 0;
+
+// Sparse line index: index_ofs[i] = offset of line i * DOC_INDEX_STEP
+static uint32_t *index_ofs = NULL;
+static uint32_t index_count = 0;
+static uint32_t index_cap = 0;
+
+// Page cache (LRU)
+static uint8_t *pages = NULL;
+static uint32_t page_base[DOC_PAGES];
+static uint32_t page_stamp[DOC_PAGES];
+static uint32_t stamp = 0;
+static uint32_t cache_hits = 0;
+static uint32_t cache_misses = 0;
+
+// Start of the line after the last one read (sequential reads are cheap)
+static uint32_t hint_line = 0;
+static uint32_t hint_ofs = 0;
+
+static doc_span_t *spans = NULL;
+static uint32_t span_count = 0;
+static uint32_t span_cap = 0;
+static uint32_t total_lines = 0;
+static bool modified = false;
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (v >> (i * 8)) & 0xFF;
+    }
+}
+
+// Missing or foreign headers read as an empty document
+static bool read_header(int doc, doc_header_t *h, uint8_t *buf)
+{
+    if (!sdcard_read_sectors(DOC_HEADER_SECTOR(doc), buf, 1)) {
+        return false;
+    }
+
+    h->side = 0;
+    h->len = 0;
+    h->gen = 0;
+    if (get_le32(buf) == DOC_MAGIC) {
+        h->side = buf[4] & 1;
+        h->len = get_le32(buf + 8);
+        h->gen = get_le32(buf + 12);
+        if (h->len > DOC_MAX_BYTES) {
+            h->len = 0;
+        }
+    }
+    return true;
+}
+
+static bool write_header(int doc, const doc_header_t *h, uint8_t *buf)
+{
+    memset(buf, 0, 512);
+    put_le32(buf, DOC_MAGIC);
+    buf[4] = (uint8_t)h->side;
+    put_le32(buf + 8, h->len);
+    put_le32(buf + 12, h->gen);
+    return sdcard_write_sectors(DOC_HEADER_SECTOR(doc), buf, 1);
+}
+
+static bool index_push(uint32_t **arr, uint32_t *count, uint32_t *cap, uint32_t ofs)
+{
+    if (*count == *cap) {
+        uint32_t new_cap = *cap ? *cap * 2 : 32;
+        uint32_t *p = realloc(*arr, new_cap * sizeof(uint32_t));
+        if (p == NULL) {
+            return false;
+        }
+        *arr = p;
+        *cap = new_cap;
+    }
+    (*arr)[(*count)++] = ofs;
+    return true;
+}
+
+static void cache_reset(void)
+{
+    for (int i = 0; i < DOC_PAGES; i++) {
+        page_base[i] = PAGE_NONE;
+        page_stamp[i] = 0;
+    }
+    hint_line = 0;
+    hint_ofs = 0;
+}
+
+// Pointer to byte ofs of the original text, *avail = bytes readable from there
+static const uint8_t *page_at(uint32_t ofs, uint32_t *avail)
+{
+    *avail = 0;
+    if (ofs >= cur.len) {
+        return NULL;
+    }
+
+    uint32_t base = ofs - ofs % DOC_PAGE_SIZE;
+    int slot = 0;
+    for (int i = 0; i < DOC_PAGES; i++) {
+        if (page_base[i] == base) {
+            cache_hits++;
+            page_stamp[i] = ++stamp;
+            slot = i;
+            goto found;
+        }
+        if (page_stamp[i] < page_stamp[slot]) {
+            slot = i;
+        }
+    }
+
+    cache_misses++;
+    page_base[slot] = PAGE_NONE;
+    if (!sdcard_read_sectors(DOC_DATA_SECTOR(cur_doc, cur.side) + base / 512,
+                             pages + slot * DOC_PAGE_SIZE, DOC_PAGE_SIZE / 512)) {
+        return NULL;
+    }
+    page_base[slot] = base;
+    page_stamp[slot] = ++stamp;
+
+found:;
+    uint32_t end = base + DOC_PAGE_SIZE;
+    if (end > cur.len) {
+        end = cur.len;
+    }
+    *avail = end - ofs;
+    return pages + slot * DOC_PAGE_SIZE + (ofs - base);
+}
+
+// Byte offset of original line n (orig_lines gives the end of the text)
+static bool orig_seek(uint32_t n, uint32_t *out)
+{
+    if (n >= orig_lines) {
+        *out = cur.len;
+        return true;
+    }
+
+    uint32_t line = n / DOC_INDEX_STEP * DOC_INDEX_STEP;
+    uint32_t ofs = index_ofs[n / DOC_INDEX_STEP];
+    if (hint_line <= n && hint_line > line) {
+        line = hint_line;
+        ofs = hint_ofs;
+    }
+
+    while (line < n) {
+        uint32_t avail;
+        const uint8_t *p = page_at(ofs, &avail);
+        if (p == NULL) {
+            return false;
+        }
+        const uint8_t *nl = memchr(p, '\n', avail);
+        if (nl != NULL) {
+            ofs += nl - p + 1;
+            line++;
+        } else {
+            ofs += avail;
+        }
+    }
+
+    hint_line = n;
+    hint_ofs = ofs;
+    *out = ofs;
+    return true;
+}
+
+static int orig_line(uint32_t n, char *out, size_t max)
+{
+    uint32_t ofs;
+    if (!orig_seek(n, &ofs)) {
+        return -1;
+    }
+
+    size_t len = 0;
+    uint8_t last = 0;
+    for (;;) {
+        uint32_t avail;
+        const uint8_t *p = page_at(ofs, &avail);
+        if (p == NULL) {
+            break;  // end of text without a final newline
+        }
+        const uint8_t *nl = memchr(p, '\n', avail);
+        uint32_t chunk = nl ? (uint32_t)(nl - p) : avail;
+        if (len < max) {
+            size_t n_copy = chunk < max - len ? chunk : max - len;
+            memcpy(out + len, p, n_copy);
+        }
+        if (chunk > 0) {
+            last = p[chunk - 1];
+        }
+        len += chunk;
+        ofs += chunk;
+        if (nl != NULL) {
+            ofs++;
+            break;
+        }
+    }
+
+    hint_line = n + 1;
+    hint_ofs = ofs;
+
+    if (last == '\r') {
+        len--;
+    }
+    return (int)len;
+}
+
+static void spans_free(void)
+{
+    for (uint32_t i = 0; i < span_count; i++) {
+        free(spans[i].text);
+    }
+    free(spans);
+    spans = NULL;
+    span_count = 0;
+    span_cap = 0;
+}
+
+static bool span_insert(uint32_t at, const doc_span_t *span)
+{
+    if (span_count == span_cap) {
+        uint32_t new_cap = span_cap ? span_cap * 2 : 8;
+        doc_span_t *p = realloc(spans, new_cap * sizeof(doc_span_t));
+        if (p == NULL) {
+            return false;
+        }
+        spans = p;
+        span_cap = new_cap;
+    }
+    memmove(spans + at + 1, spans + at, (span_count - at) * sizeof(doc_span_t));
+    spans[at] = *span;
+    span_count++;
+    return true;
+}
+
+static void span_remove(uint32_t at)
+{
+    free(spans[at].text);
+    memmove(spans + at, spans + at + 1, (span_count - at - 1) * sizeof(doc_span_t));
+    span_count--;
+}
+
+// Make logical line n start a span, returns that span (span_count at the end)
+static int span_split(uint32_t n)
+{
+    uint32_t line = 0;
+    for (uint32_t i = 0; i < span_count; i++) {
+        if (n == line) {
+            return (int)i;
+        }
+        if (n < line + spans[i].count) {
+            uint32_t k = n - line;
+            doc_span_t rest = { spans[i].start + k, spans[i].count - k, NULL, 0 };
+            if (!span_insert(i + 1, &rest)) {
+                return -1;
+            }
+            spans[i].count = k;
+            return (int)i + 1;
+        }
+        line += spans[i].count;
+    }
+    return (int)span_count;
+}
+
+// NULL for a line longer than DOC_LINE_MAX (it is never cut)
+static char *copy_text(const char *text, size_t len)
+{
+    if (len > DOC_LINE_MAX) {
+        return NULL;
+    }
+    char *p = malloc(len + 1);
+    if (p != NULL) {
+        memcpy(p, text, len);
+        p[len] = '\0';
+    }
+    return p;
+}
+
+static void spans_reset(void)
+{
+    spans_free();
+    if (orig_lines > 0) {
+        doc_span_t all = { 0, orig_lines, NULL, 0 };
+        span_insert(0, &all);
+    }
+    total_lines = orig_lines;
+    modified = false;
+}
+
+// Count lines of the current region and build the sparse index
+static bool build_index(uint8_t *buf)
+{
+    index_count = 0;
+    if (!index_push(&index_ofs, &index_count, &index_cap, 0)) {
+        return false;
+    }
+
+    uint32_t lines = 0;
+    uint8_t last = '\n';
+    uint32_t sector = DOC_DATA_SECTOR(cur_doc, cur.side);
+
+    for (uint32_t ofs = 0; ofs < cur.len; ofs += DOC_STREAM_SIZE) {
+        uint32_t n = cur.len - ofs;
+        if (n > DOC_STREAM_SIZE) {
+            n = DOC_STREAM_SIZE;
+        }
+        if (!sdcard_read_sectors(sector + ofs / 512, buf, (n + 511) / 512)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                lines++;
+                if (lines % DOC_INDEX_STEP == 0 &&
+                    !index_push(&index_ofs, &index_count, &index_cap, ofs + i + 1)) {
+                    return false;
+                }
+            }
+        }
+        last = buf[n - 1];
+    }
+
+    orig_lines = lines + (last != '\n' ? 1 : 0);
+    return true;
+}
+
+bool document_open(int doc)
+{
+    if (doc < 0 || doc >= DOC_MAX) {
+        ESP_LOGE(TAG, "Invalid document number: %d (must be 0-%d)", doc, DOC_MAX - 1);
+        return false;
+    }
+
+    document_close();
+
+    if (!sdcard_session_open()) {
+        return false;
+    }
+    cur_doc = doc;
+
+    uint8_t *buf = heap_caps_malloc(DOC_STREAM_SIZE, MALLOC_CAP_DMA);
+    pages = heap_caps_malloc(DOC_PAGE_SIZE * DOC_PAGES, MALLOC_CAP_DMA);
+    if (buf == NULL || pages == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate document buffers");
+        free(buf);
+        document_close();
+        return false;
+    }
+
+    bool ok = read_header(doc, &cur, buf) && build_index(buf);
+    free(buf);
+
+    if (!ok) {
+        document_close();
+        return false;
+    }
+
+    cache_reset();
+    cache_hits = 0;
+    cache_misses = 0;
+    spans_reset();
+
+    ESP_LOGI(TAG, "Opened document %d: %lu bytes, %lu lines, %lu index entries",
+             doc, (unsigned long)cur.len, (unsigned long)orig_lines, (unsigned long)index_count);
+    return true;
+}
+
+void document_close(void)
+{
+    spans_free();
+    free(index_ofs);
+    index_ofs = NULL;
+    index_count = 0;
+    index_cap = 0;
+    free(pages);
+    pages = NULL;
+    orig_lines = 0;
+    total_lines = 0;
+    modified = false;
+    if (cur_doc >= 0) {
+        cur_doc = -1;
+        sdcard_session_close();
+    }
+}
+
+int document_current(void)
+{
+    return cur_doc;
+}
+
+uint32_t document_lines(void)
+{
+    return total_lines;
+}
+
+int document_line(uint32_t n, char *out, size_t max)
+{
+    if (cur_doc < 0 || n >= total_lines) {
+        return -1;
+    }
+
+    uint32_t line = 0;
+    for (uint32_t i = 0; i < span_count; i++) {
+        if (n < line + spans[i].count) {
+            if (spans[i].start == DOC_ADDED) {
+                size_t len = spans[i].len < max ? spans[i].len : max;
+                memcpy(out, spans[i].text, len);
+                return (int)spans[i].len;
+            }
+            return orig_line(spans[i].start + (n - line), out, max);
+        }
+        line += spans[i].count;
+    }
+    return -1;
+}
+
+bool document_set_line(uint32_t n, const char *text, size_t len)
+{
+    if (cur_doc < 0 || n >= total_lines) {
+        return false;
+    }
+
+    int i = span_split(n);
+    if (i < 0) {
+        return false;
+    }
+
+    char *copy = copy_text(text, len);
+    if (copy == NULL) {
+        return false;
+    }
+
+    if (spans[i].start != DOC_ADDED) {
+        // Cut the line off the front of its original span
+        if (spans[i].count > 1) {
+            doc_span_t rest = { spans[i].start + 1, spans[i].count - 1, NULL, 0 };
+            if (!span_insert(i + 1, &rest)) {
+                free(copy);
+                return false;
+            }
+        }
+        spans[i].start = DOC_ADDED;
+        spans[i].count = 1;
+    }
+
+    free(spans[i].text);
+    spans[i].text = copy;
+    spans[i].len = (uint16_t)len;
+    modified = true;
+    return true;
+}
+
+bool document_insert_line(uint32_t n, const char *text, size_t len)
+{
+    if (cur_doc < 0 || n > total_lines) {
+        return false;
+    }
+
+    int i = span_split(n);
+    if (i < 0) {
+        return false;
+    }
+
+    doc_span_t added = { DOC_ADDED, 1, copy_text(text, len), 0 };
+    if (added.text == NULL) {
+        return false;
+    }
+    added.len = (uint16_t)len;
+    if (!span_insert(i, &added)) {
+        free(added.text);
+        return false;
+    }
+
+    total_lines++;
+    modified = true;
+    return true;
+}
+
+bool document_delete_line(uint32_t n)
+{
+    if (cur_doc < 0 || n >= total_lines) {
+        return false;
+    }
+
+    int i = span_split(n);
+    if (i < 0) {
+        return false;
+    }
+
+    if (spans[i].count > 1) {
+        spans[i].start++;
+        spans[i].count--;
+    } else {
+        span_remove(i);
+    }
+
+    total_lines--;
+    modified = true;
+    return true;
+}
+
+bool document_modified(void)
+{
+    return modified;
+}
+
+// Output side of save: buffered sector writes plus the new line index
+typedef struct {
+    uint8_t *buf;
+    uint32_t used;
+    uint32_t sector;
+    uint32_t len;
+    uint32_t lines;
+    uint8_t last;
+    uint32_t *index;
+    uint32_t index_count;
+    uint32_t index_cap;
+    bool ok;
+} doc_writer_t;
+
+static void writer_flush(doc_writer_t *w)
+{
+    if (w->used == 0 || !w->ok) {
+        return;
+    }
+    uint32_t sectors = (w->used + 511) / 512;
+    memset(w->buf + w->used, 0, sectors * 512 - w->used);
+    w->ok = sdcard_write_sectors(w->sector, w->buf, sectors);
+    w->sector += sectors;
+    w->used = 0;
+}
+
+static void writer_put(doc_writer_t *w, const uint8_t *data, uint32_t len)
+{
+    if (!w->ok) {
+        return;
+    }
+    if (w->len + len > DOC_MAX_BYTES) {
+        ESP_LOGE(TAG, "Document too large (max %d bytes)", DOC_MAX_BYTES);
+        w->ok = false;
+        return;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        if (data[i] == '\n') {
+            w->lines++;
+            if (w->lines % DOC_INDEX_STEP == 0 &&
+                !index_push(&w->index, &w->index_count, &w->index_cap, w->len + i + 1)) {
+                w->ok = false;
+                return;
+            }
+        }
+    }
+
+    while (len > 0 && w->ok) {
+        uint32_t n = DOC_STREAM_SIZE - w->used;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(w->buf + w->used, data, n);
+        w->used += n;
+        w->len += n;
+        w->last = data[n - 1];
+        data += n;
+        len -= n;
+        if (w->used == DOC_STREAM_SIZE) {
+            writer_flush(w);
+        }
+    }
+}
+
+// Spans are line sequences, so each one starts on a new line
+static void writer_line_break(doc_writer_t *w)
+{
+    if (w->len > 0 && w->last != '\n') {
+        writer_put(w, (const uint8_t *)"\n", 1);
+    }
+}
+
+bool document_save(void)
+{
+    if (cur_doc < 0) {
+        return false;
+    }
+    if (!modified) {
+        return true;
+    }
+
+    doc_writer_t w = {
+        .buf = heap_caps_malloc(DOC_STREAM_SIZE, MALLOC_CAP_DMA),
+        .sector = DOC_DATA_SECTOR(cur_doc, cur.side ^ 1),
+        .last = '\n',
+        .ok = true,
+    };
+    if (w.buf == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate save buffer");
+        return false;
+    }
+    w.ok = index_push(&w.index, &w.index_count, &w.index_cap, 0);
+
+    for (uint32_t i = 0; i < span_count && w.ok; i++) {
+        writer_line_break(&w);
+
+        if (spans[i].start == DOC_ADDED) {
+            writer_put(&w, (const uint8_t *)spans[i].text, spans[i].len);
+            writer_put(&w, (const uint8_t *)"\n", 1);
+            continue;
+        }
+
+        // Copy the original bytes of the run through the page cache
+        uint32_t from, to;
+        if (!orig_seek(spans[i].start, &from) || !orig_seek(spans[i].start + spans[i].count, &to)) {
+            w.ok = false;
+            break;
+        }
+        while (from < to && w.ok) {
+            uint32_t avail;
+            const uint8_t *p = page_at(from, &avail);
+            if (p == NULL) {
+                w.ok = false;
+                break;
+            }
+            if (avail > to - from) {
+                avail = to - from;
+            }
+            writer_put(&w, p, avail);
+            from += avail;
+        }
+    }
+    writer_flush(&w);
+
+    doc_header_t next = { cur.side ^ 1, w.len, cur.gen + 1 };
+    if (w.ok) {
+        w.ok = write_header(cur_doc, &next, w.buf);
+    }
+    free(w.buf);
+
+    if (!w.ok) {
+        ESP_LOGE(TAG, "Failed to save document %d", cur_doc);
+        free(w.index);
+        return false;
+    }
+
+    // The merged text becomes the new original
+    cur = next;
+    free(index_ofs);
+    index_ofs = w.index;
+    index_count = w.index_count;
+    index_cap = w.index_cap;
+    orig_lines = w.lines + (w.last != '\n' ? 1 : 0);
+    cache_reset();
+    spans_reset();
+
+    ESP_LOGI(TAG, "Saved document %d: %lu bytes, %lu lines",
+             cur_doc, (unsigned long)cur.len, (unsigned long)orig_lines);
+    return true;
+}
+
+bool document_clear(int doc)
+{
+    if (doc < 0 || doc >= DOC_MAX || doc == cur_doc) {
+        return false;
+    }
+
+    uint8_t *buf = heap_caps_malloc(512, MALLOC_CAP_DMA);
+    if (buf == NULL) {
+        return false;
+    }
+
+    doc_header_t h = { 0, 0, 0 };
+    bool ok = write_header(doc, &h, buf);
+    free(buf);
+    return ok;
+}
+
+bool document_append(int doc, const char *text, size_t len)
+{
+    if (doc < 0 || doc >= DOC_MAX || doc == cur_doc) {
+        return false;
+    }
+
+    uint8_t *buf = heap_caps_malloc(DOC_STREAM_SIZE, MALLOC_CAP_DMA);
+    if (buf == NULL) {
+        return false;
+    }
+
+    if (!sdcard_session_open()) {
+        free(buf);
+        return false;
+    }
+
+    doc_header_t h;
+    bool ok = read_header(doc, &h, buf);
+    if (ok && h.len + len > DOC_MAX_BYTES) {
+        ESP_LOGE(TAG, "Document %d full", doc);
+        ok = false;
+    }
+
+    // Rewrite the partial last sector, then whole buffers
+    uint32_t sector = DOC_DATA_SECTOR(doc, h.side) + h.len / 512;
+    uint32_t used = h.len % 512;
+    if (ok && used > 0) {
+        ok = sdcard_read_sectors(sector, buf, 1);
+    }
+
+    size_t done = 0;
+    while (ok && done < len) {
+        size_t n = DOC_STREAM_SIZE - used;
+        if (n > len - done) {
+            n = len - done;
+        }
+        memcpy(buf + used, text + done, n);
+        used += n;
+        done += n;
+
+        uint32_t sectors = (used + 511) / 512;
+        memset(buf + used, 0, sectors * 512 - used);
+        ok = sdcard_write_sectors(sector, buf, sectors);
+
+        // Keep a partial last sector at the front for the next round
+        if (used == DOC_STREAM_SIZE) {
+            sector += sectors;
+            used = 0;
+        }
+    }
+
+    if (ok) {
+        h.len += len;
+        ok = write_header(doc, &h, buf);
+    }
+
+    sdcard_session_close();
+    free(buf);
+    return ok;
+}
+
+void document_get_stats(document_stats_t *out)
+{
+    out->bytes = cur_doc >= 0 ? cur.len : 0;
+    out->lines = total_lines;
+    out->spans = span_count;
+    out->index_bytes = index_cap * sizeof(uint32_t);
+    out->cache_hits = cache_hits;
+    out->cache_misses = cache_misses;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Documents live in raw SD sectors after the slot areas:
+//   one header sector per document, then two data regions per document
+//   (save writes the inactive region and flips the header)
+#define DOC_MAX              4
+#define DOC_REGION_SECTORS   4096    // 2MB per copy
+#define DOC_MAX_BYTES        (DOC_REGION_SECTORS * 512)
+
+// First sector after the document area (free for other stores)
+#define DOC_END_SECTOR       (SDCARD_FREE_START_SECTOR + 8 + DOC_MAX * 2 * DOC_REGION_SECTORS)
+
+// One index entry (byte offset) per DOC_INDEX_STEP lines
+#define DOC_INDEX_STEP       64
+
+// Read cache: DOC_PAGES pages of DOC_PAGE_SIZE bytes (multiple of 512)
+#define DOC_PAGE_SIZE        1024
+#define DOC_PAGES            4
+
+// Longer lines are read truncated and cannot be edited
+#define DOC_LINE_MAX         256
+
+// Open a document (closes the current one, dropping unsaved edits)
+// Builds the line index by streaming the text once
+// Returns false if the card or the document cannot be read
+bool document_open(int doc);
+
+// Close the open document and the SD session (edits are dropped)
+void document_close(void);
+
+// Number of the open document, or -1
+int document_current(void);
+
+// Lines of the open document, edits included
+uint32_t document_lines(void);
+
+// Copy up to max bytes of line n into out (not terminated)
+// Returns the full length of the line (more than max if it was cut), or -1
+int document_line(uint32_t n, char *out, size_t max);
+
+// Edits are kept in RAM until document_save
+// n may equal document_lines() for insert (append at the end)
+// Text longer than DOC_LINE_MAX is refused
+bool document_set_line(uint32_t n, const char *text, size_t len);
+bool document_insert_line(uint32_t n, const char *text, size_t len);
+bool document_delete_line(uint32_t n);
+bool document_modified(void);
+
+// Merge the edits with the original text into the other region,
+// then switch the header to it
+bool document_save(void);
+
+// Whole-document operations on a closed document
+bool document_clear(int doc);
+bool document_append(int doc, const char *text, size_t len);
+
+typedef struct {
+    uint32_t bytes;         // original text size
+    uint32_t lines;         // lines including edits
+    uint32_t spans;         // edit overlay pieces
+    uint32_t index_bytes;   // RAM used by the line index
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+} document_stats_t;
+
+void document_get_stats(document_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
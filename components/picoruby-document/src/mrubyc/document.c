@@ -0,0 +1,9 @@
+/*
+ * Document mrubyc initialization stub
+ * Actual implementation is in ports/esp32/document_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/document_native.c */
+extern void mrbc_document_init(mrbc_vm *vm);
@@ -0,0 +1,9 @@
+# Event class - implemented in C
+class Event
+  # Event.wait return bits
+  KEY       = 1
+  TRACKBALL = 2
+  TIMER     = 4
+  SD        = 8
+  CHECK     = 16
+end
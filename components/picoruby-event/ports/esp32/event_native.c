@@ -0,0 +1,85 @@
+/*
+ * Event Native mrubyc bindings
+ */
+
+#include "event_queue.h"
+#include <mrubyc.h>
+#include "esp_timer.h"
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Event = NULL;
+
+/* ==============================================
+ * Method: Event.wait or Event.wait(timeout_ms)
+ * Block the VM until a key, trackball, timer, SD or check event arrives
+ * Args:
+ *   0 args / nil: wait forever
+ *   1 arg: timeout in ms (0 = just poll)
+ * Returns: Integer bitmask of Event::KEY etc. (0 on timeout)
+ * ============================================== */
+static void c_event_wait(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    uint32_t timeout_ms = EVENT_WAIT_FOREVER;
+
+    if (argc >= 1 && mrbc_type(v[1]) == MRBC_TT_INTEGER) {
+        mrbc_int_t ms = GET_INT_ARG(1);
+        timeout_ms = ms < 0 ? 0 : (uint32_t)ms;
+    }
+
+    SET_INT_RETURN(event_wait(timeout_ms));
+}
+
+/* ==============================================
+ * Method: Event.post(bits)
+ * Wake a pending Event.wait with the given bits
+ * ============================================== */
+static void c_event_post(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc >= 1) {
+        event_post((uint32_t)GET_INT_ARG(1) & EVENT_ALL);
+    }
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Event.set_timer(period_ms)
+ * Post Event::TIMER every period_ms (0 stops the timer)
+ * Returns: true on success, false on failure
+ * ============================================== */
+static void c_event_set_timer(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    uint32_t period_ms = 0;
+    if (argc >= 1) {
+        period_ms = (uint32_t)GET_INT_ARG(1);
+    }
+
+    if (event_set_timer(period_ms)) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Event.now_ms
+ * Returns: milliseconds since boot (wraps like a 32-bit Integer)
+ * ============================================== */
+static void c_event_now_ms(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN((mrbc_int_t)(int32_t)(esp_timer_get_time() / 1000));
+}
+
+/* ==============================================
+ * Initialize Event class
+ * ============================================== */
+void mrbc_event_init(mrbc_vm *vm)
+{
+    event_init();
+
+    mrbc_class_Event = mrbc_define_class(vm, "Event", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Event, "wait", c_event_wait);
+    mrbc_define_method(vm, mrbc_class_Event, "post", c_event_post);
+    mrbc_define_method(vm, mrbc_class_Event, "set_timer", c_event_set_timer);
+    mrbc_define_method(vm, mrbc_class_Event, "now_ms", c_event_now_ms);
+}
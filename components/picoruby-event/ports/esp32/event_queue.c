@@ -0,0 +1,112 @@
+#include "event_queue.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "Event";
+
+static EventGroupHandle_t event_group = NULL;
+static esp_timer_handle_t event_timer = NULL;
+static int64_t timer_start_us = 0;
+static uint64_t timer_period_us = 0;   // 0 = stopped
+
+// Written by event_wait only (the VM)
+static int64_t last_input_us = 0;
+
+static void event_timer_callback(void *arg)
+{
+    event_post(EVENT_TIMER);
+}
+
+bool event_init(void)
+{
+    if (event_group != NULL) {
+        return true;
+    }
+
+    event_group = xEventGroupCreate();
+    if (event_group == NULL) {
+        ESP_LOGE(TAG, "Failed to create event group");
+        return false;
+    }
+    last_input_us = esp_timer_get_time();
+    return true;
+}
+
+void event_post(uint32_t bits)
+{
+    if (event_group == NULL) return;
+    xEventGroupSetBits(event_group, bits);
+}
+
+void IRAM_ATTR event_post_from_isr(uint32_t bits)
+{
+    if (event_group == NULL) return;
+
+    // Setting bits from an ISR is deferred to the timer task; skip the
+    // request when the bits are already pending so edge bursts stay cheap
+    if ((xEventGroupGetBitsFromISR(event_group) & bits) == bits) return;
+
+    BaseType_t woken = pdFALSE;
+    if (xEventGroupSetBitsFromISR(event_group, bits, &woken) == pdPASS && woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static uint32_t note_input(EventBits_t bits)
+{
+    if (bits & (EVENT_KEY | EVENT_TRACKBALL)) {
+        last_input_us = esp_timer_get_time();
+    }
+    return bits & EVENT_ALL;
+}
+
+uint32_t event_wait(uint32_t timeout_ms)
+{
+    if (event_group == NULL) return 0;
+
+    TickType_t ticks = (timeout_ms == EVENT_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    return note_input(xEventGroupWaitBits(event_group, EVENT_ALL, pdTRUE, pdFALSE, ticks));
+}
+
+int64_t event_last_input_us(void)
+{
+    return last_input_us;
+}
+
+bool event_set_timer(uint32_t period_ms)
+{
+    if (event_timer == NULL) {
+        esp_timer_create_args_t args = {
+            .callback = event_timer_callback,
+            .name = "event_timer",
+        };
+        if (esp_timer_create(&args, &event_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create event timer");
+            return false;
+        }
+    }
+
+    esp_timer_stop(event_timer);  // ESP_ERR_INVALID_STATE if not running
+    timer_period_us = 0;
+    if (period_ms == 0) {
+        return true;
+    }
+    if (esp_timer_start_periodic(event_timer, (uint64_t)period_ms * 1000) != ESP_OK) {
+        return false;
+    }
+    timer_start_us = esp_timer_get_time();
+    timer_period_us = (uint64_t)period_ms * 1000;
+    return true;
+}
+
+int64_t event_next_timer_us(void)
+{
+    if (timer_period_us == 0) {
+        return INT64_MAX;
+    }
+    uint64_t since = (uint64_t)(esp_timer_get_time() - timer_start_us);
+    return timer_start_us + (int64_t)((since / timer_period_us + 1) * timer_period_us);
+}
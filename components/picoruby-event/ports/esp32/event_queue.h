@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Event bits (keep in sync with mrblib/event.rb)
+#define EVENT_KEY        (1 << 0)
+#define EVENT_TRACKBALL  (1 << 1)
+#define EVENT_TIMER      (1 << 2)
+#define EVENT_SD         (1 << 3)
+#define EVENT_CHECK      (1 << 4)
+#define EVENT_ALL        (EVENT_KEY | EVENT_TRACKBALL | EVENT_TIMER | EVENT_SD | EVENT_CHECK)
+
+// Wait forever
+#define EVENT_WAIT_FOREVER  UINT32_MAX
+
+// Create the event group (called from the gem init)
+bool event_init(void);
+
+// Post event bits from a task (no-op before event_init)
+void event_post(uint32_t bits);
+
+// Post event bits from an ISR (no-op before event_init)
+void event_post_from_isr(uint32_t bits);
+
+// Block until any event bit is set or timeout_ms elapses
+// Returns the bits that were set (cleared on return), 0 on timeout
+uint32_t event_wait(uint32_t timeout_ms);
+
+// esp_timer time when event_wait last returned a key or trackball event
+// (event_init time before the first)
+int64_t event_last_input_us(void);
+
+// Periodic timer posting EVENT_TIMER (period_ms 0 stops it)
+bool event_set_timer(uint32_t period_ms);
+
+// esp_timer time of the next EVENT_TIMER, INT64_MAX while it is stopped
+int64_t event_next_timer_us(void);
+
+#ifdef __cplusplus
+}
+#endif
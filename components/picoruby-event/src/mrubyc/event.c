@@ -0,0 +1,9 @@
+/*
+ * Event mrubyc initialization stub
+ * Actual implementation is in ports/esp32/event_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/event_native.c */
+extern void mrbc_event_init(mrbc_vm *vm);
@@ -0,0 +1,3 @@
+# Inspect class - implemented in C
+class Inspect
+end
@@ -0,0 +1,49 @@
+/*
+ * Inspect Native mrubyc bindings
+ */
+
+#include "inspect_window.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Inspect = NULL;
+
+/* ==============================================
+ * Method: Inspect.window(value, offset, width) or
+ *         Inspect.window(value, offset, width, inspect)
+ * Characters [offset, offset + width) of value.to_s
+ * (value.inspect when inspect is true), formatted lazily
+ * Args:
+ *   width: up to 256 characters
+ * Returns: String ("" when offset is past the end)
+ * ============================================== */
+static void c_inspect_window(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 3 || mrbc_type(v[2]) != MRBC_TT_INTEGER || mrbc_type(v[3]) != MRBC_TT_INTEGER) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    mrbc_int_t offset = GET_INT_ARG(2);
+    mrbc_int_t width = GET_INT_ARG(3);
+    if (offset < 0) offset = 0;
+    if (width < 0) width = 0;
+    if (width > INSPECT_WINDOW_MAX) width = INSPECT_WINDOW_MAX;
+
+    bool inspect = argc >= 4 && mrbc_type(v[4]) == MRBC_TT_TRUE;
+
+    char buf[INSPECT_WINDOW_MAX];
+    size_t len = inspect_window(&v[1], (uint32_t)offset, buf, (size_t)width, inspect);
+
+    SET_RETURN(mrbc_string_new(vm, buf, len));
+}
+
+/* ==============================================
+ * Initialize Inspect class
+ * ============================================== */
+void mrbc_inspect_init(mrbc_vm *vm)
+{
+    mrbc_class_Inspect = mrbc_define_class(vm, "Inspect", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Inspect, "window", c_inspect_window);
+}
@@ -0,0 +1,232 @@
+#include "inspect_window.h"
+#include <stdio.h>
+#include <string.h>
+
+// Characters are counted from the start of the full text,
+// only the part inside [start, end) is copied
+typedef struct {
+    uint32_t pos;
+    uint32_t start;
+    uint32_t end;
+    char *out;
+} sink_t;
+
+// Element positions of the last top-level array or hash
+static struct {
+    const void *obj;
+    uint16_t n;
+    uint16_t step;
+    uint16_t count;
+    uint32_t pos[INSPECT_CHECKPOINTS];
+} cache;
+
+static bool format_value(sink_t *s, const mrbc_value *v, bool inspect, int depth);
+
+// Returns false once the window is full (stop formatting)
+static bool emit(sink_t *s, const char *p, size_t len)
+{
+    uint32_t from = s->pos;
+    uint32_t to = s->pos + len;
+
+    if (to > s->start && from < s->end) {
+        uint32_t a = from > s->start ? from : s->start;
+        uint32_t b = to < s->end ? to : s->end;
+        memcpy(s->out + (a - s->start), p + (a - from), b - a);
+    }
+
+    s->pos = to;
+    return s->pos < s->end;
+}
+
+static bool emit_str(sink_t *s, const char *p)
+{
+    return emit(s, p, strlen(p));
+}
+
+static bool format_string(sink_t *s, const mrbc_value *v, bool inspect)
+{
+    const char *p = (const char *)mrbc_string_cstr(v);
+    size_t len = mrbc_string_size(v);
+
+    if (!inspect) {
+        return emit(s, p, len);
+    }
+
+    if (!emit_str(s, "\"")) return false;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)p[i];
+        char buf[8];
+        bool more;
+
+        switch (c) {
+        case '"':  more = emit_str(s, "\\\""); break;
+        case '\\': more = emit_str(s, "\\\\"); break;
+        case '\n': more = emit_str(s, "\\n"); break;
+        case '\t': more = emit_str(s, "\\t"); break;
+        case '\r': more = emit_str(s, "\\r"); break;
+        case 0x1b: more = emit_str(s, "\\e"); break;
+        default:
+            if (c < 0x20 || c == 0x7f) {
+                snprintf(buf, sizeof(buf), "\\x%02X", c);
+                more = emit_str(s, buf);
+            } else {
+                more = emit(s, (const char *)&p[i], 1);
+            }
+        }
+        if (!more) return false;
+    }
+    return emit_str(s, "\"");
+}
+
+static bool format_float(sink_t *s, mrbc_float_t d)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%g", (double)d);
+
+    // 1.0 rather than 1
+    if (strpbrk(buf, ".eni") == NULL) {
+        strcat(buf, ".0");
+    }
+    return emit_str(s, buf);
+}
+
+static bool format_class_name(sink_t *s, const mrbc_value *v)
+{
+    mrbc_class *cls = find_class_by_object(v);
+    return emit_str(s, cls ? mrbc_symid_to_str(cls->sym_id) : "?");
+}
+
+// Record a resume point for element i of the cached top-level container
+static void checkpoint(sink_t *s, uint16_t i)
+{
+    if (i % cache.step != 0) return;
+
+    uint16_t k = i / cache.step;
+    if (k == cache.count && k < INSPECT_CHECKPOINTS) {
+        cache.pos[k] = s->pos;
+        cache.count++;
+    }
+}
+
+// from > 0 resumes at a checkpoint (s->pos is already past its separator)
+static bool format_array(sink_t *s, const mrbc_value *v, int depth, bool top, uint16_t from)
+{
+    uint16_t n = v->array->n_stored;
+
+    if (from == 0 && !emit_str(s, "[")) return false;
+    if (depth >= INSPECT_MAX_DEPTH && n > 0) {
+        return emit_str(s, "...]");
+    }
+
+    for (uint16_t i = from; i < n; i++) {
+        if (i > from && !emit_str(s, ", ")) return false;
+        if (top) checkpoint(s, i);
+        if (!format_value(s, &v->array->data[i], true, depth + 1)) return false;
+    }
+    return emit_str(s, "]");
+}
+
+// Hash data is stored as key, value, key, value ...
+static bool format_hash(sink_t *s, const mrbc_value *v, int depth, bool top, uint16_t from)
+{
+    uint16_t n = v->hash->n_stored / 2;
+
+    if (from == 0 && !emit_str(s, "{")) return false;
+    if (depth >= INSPECT_MAX_DEPTH && n > 0) {
+        return emit_str(s, "...}");
+    }
+
+    for (uint16_t i = from; i < n; i++) {
+        if (i > from && !emit_str(s, ", ")) return false;
+        if (top) checkpoint(s, i);
+        if (!format_value(s, &v->hash->data[i * 2], true, depth + 1)) return false;
+        if (!emit_str(s, "=>")) return false;
+        if (!format_value(s, &v->hash->data[i * 2 + 1], true, depth + 1)) return false;
+    }
+    return emit_str(s, "}");
+}
+
+static bool format_value(sink_t *s, const mrbc_value *v, bool inspect, int depth)
+{
+    char buf[32];
+
+    switch (mrbc_type(*v)) {
+    case MRBC_TT_NIL:
+        return inspect ? emit_str(s, "nil") : true;
+    case MRBC_TT_FALSE:
+        return emit_str(s, "false");
+    case MRBC_TT_TRUE:
+        return emit_str(s, "true");
+    case MRBC_TT_INTEGER:
+        snprintf(buf, sizeof(buf), "%lld", (long long)v->i);
+        return emit_str(s, buf);
+    case MRBC_TT_FLOAT:
+        return format_float(s, v->d);
+    case MRBC_TT_SYMBOL:
+        if (inspect && !emit_str(s, ":")) return false;
+        return emit_str(s, mrbc_symid_to_str(v->sym_id));
+    case MRBC_TT_STRING:
+        return format_string(s, v, inspect);
+    case MRBC_TT_ARRAY:
+        return format_array(s, v, depth, false, 0);
+    case MRBC_TT_HASH:
+        return format_hash(s, v, depth, false, 0);
+    case MRBC_TT_RANGE:
+        if (!format_value(s, &v->range->first, true, depth + 1)) return false;
+        if (!emit_str(s, v->range->flag_exclude ? "..." : "..")) return false;
+        return format_value(s, &v->range->last, true, depth + 1);
+    case MRBC_TT_CLASS:
+    case MRBC_TT_MODULE:
+        return emit_str(s, mrbc_symid_to_str(v->cls->sym_id));
+    default:
+        if (!emit_str(s, "#<")) return false;
+        if (!format_class_name(s, v)) return false;
+        return emit_str(s, ">");
+    }
+}
+
+size_t inspect_window(const mrbc_value *value, uint32_t offset, char *out, size_t width, bool inspect)
+{
+    sink_t s = {
+        .pos = 0,
+        .start = offset,
+        .end = offset + width,
+        .out = out,
+    };
+
+    mrbc_vtype tt = mrbc_type(*value);
+    if (tt != MRBC_TT_ARRAY && tt != MRBC_TT_HASH) {
+        format_value(&s, value, inspect, 0);
+    } else {
+        const void *obj = (tt == MRBC_TT_ARRAY) ? (const void *)value->array : (const void *)value->hash;
+        uint16_t n = (tt == MRBC_TT_ARRAY) ? value->array->n_stored : value->hash->n_stored / 2;
+
+        if (offset == 0 || cache.obj != obj || cache.n != n) {
+            cache.obj = obj;
+            cache.n = n;
+            cache.step = (n + INSPECT_CHECKPOINTS - 1) / INSPECT_CHECKPOINTS;
+            if (cache.step < INSPECT_CHECKPOINT_STEP) {
+                cache.step = INSPECT_CHECKPOINT_STEP;
+            }
+            cache.count = 0;
+        }
+
+        // Resume at the last element known to start before the window
+        uint16_t from = 0;
+        for (int k = cache.count - 1; k > 0; k--) {
+            if (cache.pos[k] <= offset) {
+                from = k * cache.step;
+                s.pos = cache.pos[k];
+                break;
+            }
+        }
+
+        if (tt == MRBC_TT_ARRAY) {
+            format_array(&s, value, 0, true, from);
+        } else {
+            format_hash(&s, value, 0, true, from);
+        }
+    }
+
+    return s.pos > s.start ? (s.pos < s.end ? s.pos : s.end) - s.start : 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <mrubyc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Widest window Inspect.window returns
+#define INSPECT_WINDOW_MAX        256
+
+// Nested arrays / hashes deeper than this print as [...] / {...}
+#define INSPECT_MAX_DEPTH         16
+
+// Resume points kept for the top-level array or hash
+#define INSPECT_CHECKPOINTS       64
+#define INSPECT_CHECKPOINT_STEP   16  // minimum elements between two
+
+// Format value like to_s (or inspect when inspect is true) and copy
+// characters [offset, offset + width) into out, without building the
+// whole string. Returns the number of characters copied (0 past the end).
+// Top-level arrays and hashes resume from cached element positions;
+// offset 0 drops the cache, so draw a new value at offset 0 first.
+size_t inspect_window(const mrbc_value *value, uint32_t offset, char *out, size_t width, bool inspect);
+
+#ifdef __cplusplus
+}
+#endif
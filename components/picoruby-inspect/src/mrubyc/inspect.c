@@ -0,0 +1,9 @@
+/*
+ * Inspect mrubyc initialization stub
+ * Actual implementation is in ports/esp32/inspect_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/inspect_native.c */
+extern void mrbc_inspect_init(mrbc_vm *vm);
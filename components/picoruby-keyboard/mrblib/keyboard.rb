@@ -0,0 +1 @@
+# Keyboard class - implemented in C
@@ -0,0 +1,221 @@
+#include "keyboard_driver.h"
+#include "event_queue.h"
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/i2c_master.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "Keyboard";
+
+#define RING_MASK (KEYBOARD_RING_SIZE - 1)
+
+// I2C handles
+static i2c_master_bus_handle_t bus_handle = NULL;
+static i2c_master_dev_handle_t dev_handle = NULL;
+
+// Reader task
+static TaskHandle_t reader_task = NULL;
+
+// Lock-free single-producer (reader task) / single-consumer (VM) ring
+static keyboard_event_t ring[KEYBOARD_RING_SIZE];
+static atomic_uint ring_head = 0;  // next slot to write (producer only)
+static atomic_uint ring_tail = 0;  // next slot to read (consumer only)
+static atomic_uint dropped = 0;
+
+// Fallback poll stretched to KEYBOARD_IDLE_POLL_MS (set by the VM)
+static atomic_bool idle_poll = false;
+
+// Read times of the codes handed to the VM (consumer side only)
+static uint32_t handed_us[KEYBOARD_RING_SIZE];
+static size_t handed_count = 0;
+
+// Keyboard INT line: wake the reader task
+static void IRAM_ATTR keyboard_isr_handler(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(reader_task, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void ring_push(uint8_t code, uint32_t time_us)
+{
+    unsigned head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+
+    if (head - tail >= KEYBOARD_RING_SIZE) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    ring[head & RING_MASK].code = code;
+    ring[head & RING_MASK].time_us = time_us;
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+}
+
+// Read pending codes until the controller reports 0 (no key)
+static void drain_controller(void)
+{
+    int n = 0;
+    for (; n < KEYBOARD_DRAIN_MAX; n++) {
+        uint8_t code = 0;
+        esp_err_t ret = i2c_master_receive(dev_handle, &code, 1, 10);
+        if (ret != ESP_OK || code == 0) {
+            break;
+        }
+        ring_push(code, (uint32_t)esp_timer_get_time());
+    }
+
+    if (n > 0) {
+        event_post(EVENT_KEY);
+    }
+}
+
+static void keyboard_task(void *arg)
+{
+    for (;;) {
+        // Woken by INT edge, or poll in case the line is not wired
+        uint32_t poll_ms = KEYBOARD_POLL_MS;
+        if (atomic_load_explicit(&idle_poll, memory_order_relaxed)) {
+            poll_ms = KEYBOARD_IDLE_POLL_MS;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(poll_ms));
+        drain_controller();
+    }
+}
+
+bool keyboard_init(void)
+{
+    if (reader_task != NULL) {
+        return true;
+    }
+
+    i2c_master_bus_config_t bus_cfg = {
+        .i2c_port = -1,  // pick any free controller
+        .sda_io_num = KEYBOARD_SDA_PIN,
+        .scl_io_num = KEYBOARD_SCL_PIN,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
+    };
+    esp_err_t ret = i2c_new_master_bus(&bus_cfg, &bus_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2C bus: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = KEYBOARD_I2C_ADDR,
+        .scl_speed_hz = KEYBOARD_I2C_FREQ,
+    };
+    ret = i2c_master_bus_add_device(bus_handle, &dev_cfg, &dev_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add keyboard device: %s", esp_err_to_name(ret));
+        i2c_del_master_bus(bus_handle);
+        bus_handle = NULL;
+        return false;
+    }
+
+    if (xTaskCreatePinnedToCore(keyboard_task, "keyboard", 3072, NULL, 5, &reader_task, 1) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create keyboard task");
+        reader_task = NULL;
+        i2c_master_bus_rm_device(dev_handle);
+        dev_handle = NULL;
+        i2c_del_master_bus(bus_handle);
+        bus_handle = NULL;
+        return false;
+    }
+
+    // Keyboard controller pulls INT low when a key is pressed
+    gpio_config_t int_conf = {
+        .pin_bit_mask = (1ULL << KEYBOARD_INT_PIN),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    gpio_config(&int_conf);
+
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "No ISR service, polling only: %s", esp_err_to_name(ret));
+    } else {
+        gpio_isr_handler_add(KEYBOARD_INT_PIN, keyboard_isr_handler, NULL);
+    }
+
+    ESP_LOGI(TAG, "Keyboard initialized");
+    return true;
+}
+
+size_t keyboard_read(keyboard_event_t *out, size_t max)
+{
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    size_t n = 0;
+
+    while (tail != head && n < max) {
+        out[n] = ring[tail & RING_MASK];
+        if (handed_count < KEYBOARD_RING_SIZE) {
+            handed_us[handed_count++] = out[n].time_us;
+        }
+        n++;
+        tail++;
+    }
+    atomic_store_explicit(&ring_tail, tail, memory_order_release);
+
+    return n;
+}
+
+size_t keyboard_take_read_times(uint32_t *out, size_t max)
+{
+    size_t n = handed_count < max ? handed_count : max;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = handed_us[i];
+    }
+    handed_count = 0;
+    return n;
+}
+
+size_t keyboard_available(void)
+{
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    return head - tail;
+}
+
+uint32_t keyboard_dropped(void)
+{
+    return atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
+void keyboard_set_idle(bool idle)
+{
+    atomic_store_explicit(&idle_poll, idle, memory_order_relaxed);
+}
+
+bool keyboard_sleep_prepare(void)
+{
+    if (reader_task == NULL || gpio_get_level(KEYBOARD_INT_PIN) == 0) {
+        return false;
+    }
+    // A level interrupt would fire until the pin is set back
+    gpio_intr_disable(KEYBOARD_INT_PIN);
+    gpio_wakeup_enable(KEYBOARD_INT_PIN, GPIO_INTR_LOW_LEVEL);
+    return true;
+}
+
+void keyboard_sleep_resume(void)
+{
+    if (reader_task == NULL) {
+        return;
+    }
+    gpio_wakeup_disable(KEYBOARD_INT_PIN);
+    gpio_set_intr_type(KEYBOARD_INT_PIN, GPIO_INTR_NEGEDGE);
+    gpio_intr_enable(KEYBOARD_INT_PIN);
+    xTaskNotifyGive(reader_task);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// T-Deck Plus keyboard (ESP32-C3 controller on I2C)
+#define KEYBOARD_I2C_ADDR   0x55
+#define KEYBOARD_SDA_PIN    18
+#define KEYBOARD_SCL_PIN    8
+#define KEYBOARD_INT_PIN    46
+#define KEYBOARD_I2C_FREQ   200000
+
+// Fallback poll period when no interrupt arrives (ms)
+#define KEYBOARD_POLL_MS    10
+
+// Fallback poll period while the device is idle (ms)
+#define KEYBOARD_IDLE_POLL_MS  100
+
+// Max key codes drained per wake-up
+#define KEYBOARD_DRAIN_MAX  16
+
+// Ring buffer capacity (must be a power of two)
+#define KEYBOARD_RING_SIZE  64
+
+// Key event as captured by the keyboard task
+typedef struct {
+    uint8_t code;
+    uint32_t time_us;  // esp_timer time when the code was read (wraps)
+} keyboard_event_t;
+
+// Initialize I2C bus, interrupt line and reader task
+// Safe to call more than once
+bool keyboard_init(void);
+
+// Pop up to max events from the ring buffer (single consumer)
+// Returns the number of events copied to out
+size_t keyboard_read(keyboard_event_t *out, size_t max);
+
+// Read times of the codes handed out by keyboard_read since the last call
+// (up to max, the oldest first), then forget them
+size_t keyboard_take_read_times(uint32_t *out, size_t max);
+
+// Number of events waiting in the ring buffer
+size_t keyboard_available(void);
+
+// Number of events dropped because the ring buffer was full
+uint32_t keyboard_dropped(void);
+
+// Poll every KEYBOARD_IDLE_POLL_MS instead of KEYBOARD_POLL_MS
+// (the INT line still wakes the reader at once)
+void keyboard_set_idle(bool idle);
+
+// Light sleep: wake the chip when INT goes low (edges cannot wake it)
+// Returns false, and changes nothing, when INT is already low
+bool keyboard_sleep_prepare(void);
+
+// Back to the INT edge, and drain the controller: the edge that woke
+// the chip never reached the ISR, and a timer wake-up stands in for the poll
+void keyboard_sleep_resume(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Keyboard Native mrubyc bindings
+ */
+
+#include "keyboard_driver.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Keyboard = NULL;
+
+/* ==============================================
+ * Method: Keyboard.init
+ * Start the keyboard reader task
+ * Returns: true on success, false on failure
+ * ============================================== */
+static void c_keyboard_init(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (keyboard_init()) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Keyboard.read_all
+ * Drain every queued key code at once
+ * Returns: Array of Integer key codes (empty if none)
+ * ============================================== */
+static void c_keyboard_read_all(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    keyboard_event_t events[KEYBOARD_RING_SIZE];
+    size_t n = keyboard_read(events, KEYBOARD_RING_SIZE);
+
+    mrbc_value ary = mrbc_array_new(vm, n);
+    for (size_t i = 0; i < n; i++) {
+        mrbc_value code = mrbc_integer_value(events[i].code);
+        mrbc_array_push(&ary, &code);
+    }
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Method: Keyboard.available
+ * Returns: Number of queued key codes
+ * ============================================== */
+static void c_keyboard_available(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN(keyboard_available());
+}
+
+/* ==============================================
+ * Method: Keyboard.dropped
+ * Returns: Number of key codes lost to a full buffer
+ * ============================================== */
+static void c_keyboard_dropped(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN(keyboard_dropped());
+}
+
+/* ==============================================
+ * Initialize Keyboard class
+ * ============================================== */
+void mrbc_keyboard_init(mrbc_vm *vm)
+{
+    mrbc_class_Keyboard = mrbc_define_class(vm, "Keyboard", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Keyboard, "init", c_keyboard_init);
+    mrbc_define_method(vm, mrbc_class_Keyboard, "read_all", c_keyboard_read_all);
+    mrbc_define_method(vm, mrbc_class_Keyboard, "available", c_keyboard_available);
+    mrbc_define_method(vm, mrbc_class_Keyboard, "dropped", c_keyboard_dropped);
+}
@@ -0,0 +1,9 @@
+/*
+ * Keyboard mrubyc initialization stub
+ * Actual implementation is in ports/esp32/keyboard_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/keyboard_native.c */
+extern void mrbc_keyboard_init(mrbc_vm *vm);
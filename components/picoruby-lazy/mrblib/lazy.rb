@@ -0,0 +1,3 @@
+# Lazy class - implemented in C
+class Lazy
+end
@@ -0,0 +1,141 @@
+#include "lazy_loader.h"
+#include <string.h>
+#include <mrubyc.h>
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "Lazy";
+
+typedef struct {
+    const lazy_module_t *module;
+    bool loaded;
+    bool failed;
+    uint32_t heap_bytes;
+    uint32_t load_us;
+} lazy_entry_t;
+
+static lazy_entry_t entries[LAZY_MAX_MODULES];
+static int entry_count = 0;
+
+// Opened at the first load and never closed: the ireps of every module
+// are allocated under its VM id, and closing it would free them (so it
+// takes one of the MAX_VM_COUNT slots for good)
+static mrbc_vm *loader_vm = NULL;
+static bool loading = false;
+
+void lazy_register(const lazy_module_t *modules, int count)
+{
+    if (count > LAZY_MAX_MODULES) {
+        ESP_LOGW(TAG, "%d modules, only %d are kept", count, LAZY_MAX_MODULES);
+        count = LAZY_MAX_MODULES;
+    }
+    memset(entries, 0, sizeof(entries));
+    for (int i = 0; i < count; i++) {
+        entries[i].module = &modules[i];
+    }
+    entry_count = count;
+}
+
+static lazy_entry_t *find(const char *name)
+{
+    for (int i = 0; i < entry_count; i++) {
+        if (strcmp(entries[i].module->name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t heap_used(void)
+{
+    struct MRBC_ALLOC_STATISTICS stat;
+    mrbc_alloc_statistics(&stat);
+    return stat.used;
+}
+
+// Parse the bytecode and run its top level to the end
+static bool run(const uint8_t *mrb)
+{
+    if (loader_vm == NULL) {
+        loader_vm = mrbc_vm_open(NULL);
+        if (loader_vm == NULL) {
+            ESP_LOGE(TAG, "No VM to load modules on");
+            return false;
+        }
+    }
+
+    if (mrbc_load_mrb(loader_vm, mrb) != 0) {
+        ESP_LOGE(TAG, "Bad module bytecode");
+        return false;
+    }
+    mrbc_vm_begin(loader_vm);
+    mrbc_vm_run(loader_vm);
+
+    if (mrbc_type(loader_vm->exception) != MRBC_TT_NIL) {
+        mrbc_decref(&loader_vm->exception);
+        loader_vm->exception = mrbc_nil_value();
+        return false;
+    }
+    return true;
+}
+
+lazy_result_t lazy_load(const char *name)
+{
+    lazy_entry_t *e = find(name);
+    if (e == NULL) {
+        ESP_LOGW(TAG, "No module '%s'", name);
+        return LAZY_UNKNOWN;
+    }
+    if (e->loaded) {
+        return LAZY_ALREADY;
+    }
+    if (e->failed) {
+        return LAZY_FAILED;
+    }
+    if (loading) {
+        // The loader VM is busy with the module that asked
+        ESP_LOGE(TAG, "'%s' loaded from a module top level", name);
+        return LAZY_FAILED;
+    }
+
+    uint32_t before = heap_used();
+    int64_t start = esp_timer_get_time();
+    loading = true;
+    bool ok = run(e->module->mrb);
+    loading = false;
+
+    e->load_us = (uint32_t)(esp_timer_get_time() - start);
+    uint32_t after = heap_used();
+    e->heap_bytes = after > before ? after - before : 0;
+    if (!ok) {
+        ESP_LOGE(TAG, "Module '%s' failed to load", name);
+        e->failed = true;
+        return LAZY_FAILED;
+    }
+
+    e->loaded = true;
+    ESP_LOGI(TAG, "Loaded '%s': %u bytes in %u us", name, (unsigned)e->heap_bytes,
+             (unsigned)e->load_us);
+    return LAZY_LOADED;
+}
+
+bool lazy_loaded(const char *name)
+{
+    lazy_entry_t *e = find(name);
+    return e != NULL && e->loaded;
+}
+
+int lazy_get_stats(lazy_stats_t *out, int max)
+{
+    int n = entry_count < max ? entry_count : max;
+    for (int i = 0; i < n; i++) {
+        out[i] = (lazy_stats_t){
+            .name = entries[i].module->name,
+            .loaded = entries[i].loaded,
+            .failed = entries[i].failed,
+            .heap_bytes = entries[i].heap_bytes,
+            .load_us = entries[i].load_us,
+        };
+    }
+    return n;
+}
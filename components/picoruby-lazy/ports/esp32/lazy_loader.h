@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Most modules the firmware can register
+#define LAZY_MAX_MODULES    16
+
+// A bytecode module compiled from main/mrblib/lazy/<name>.rb
+typedef struct {
+    const char *name;
+    const uint8_t *mrb;
+} lazy_module_t;
+
+typedef enum {
+    LAZY_LOADED = 0,        // ran now
+    LAZY_ALREADY,           // ran before
+    LAZY_UNKNOWN,           // not registered
+    LAZY_FAILED,            // bad bytecode, no VM or raised (not retried)
+} lazy_result_t;
+
+// Register the modules Lazy.load can run (the table must outlive the VM)
+// Call before mrbc_run
+void lazy_register(const lazy_module_t *modules, int count);
+
+// Run a module's top level once: its methods, classes and constants are
+// shared with every VM, so they stay defined after the load
+// Only the VM task may load (modules are run on a VM of their own)
+lazy_result_t lazy_load(const char *name);
+
+bool lazy_loaded(const char *name);
+
+typedef struct {
+    const char *name;
+    bool loaded;
+    bool failed;
+    uint32_t heap_bytes;    // mruby/c heap in use after the load minus before
+    uint32_t load_us;       // bytecode parse and top level run
+} lazy_stats_t;
+
+// Registered modules in table order, returns how many were written
+int lazy_get_stats(lazy_stats_t *out, int max);
+
+#ifdef __cplusplus
+}
+#endif
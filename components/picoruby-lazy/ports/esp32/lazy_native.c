@@ -0,0 +1,99 @@
+/*
+ * Lazy Native mrubyc bindings
+ */
+
+#include "lazy_loader.h"
+#include "native_hash.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Lazy = NULL;
+
+// Module name from a Symbol or String argument, NULL otherwise
+static const char *name_arg(mrbc_value *v, int argc)
+{
+    if (argc < 1) {
+        return NULL;
+    }
+    if (mrbc_type(v[1]) == MRBC_TT_SYMBOL) {
+        return mrbc_symid_to_str(v[1].sym_id);
+    }
+    if (mrbc_type(v[1]) == MRBC_TT_STRING) {
+        return mrbc_string_cstr(&v[1]);
+    }
+    return NULL;
+}
+
+/* ==============================================
+ * Method: Lazy.load(name)
+ * Run the bytecode module name (Symbol or String) unless it already ran
+ * Returns: true if it ran now, false if it ran before,
+ *          nil if there is no such module or it failed to load
+ * ============================================== */
+static void c_lazy_load(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    const char *name = name_arg(v, argc);
+    if (name == NULL) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    switch (lazy_load(name)) {
+    case LAZY_LOADED:
+        SET_TRUE_RETURN();
+        break;
+    case LAZY_ALREADY:
+        SET_FALSE_RETURN();
+        break;
+    default:
+        SET_NIL_RETURN();
+        break;
+    }
+}
+
+/* ==============================================
+ * Method: Lazy.loaded?(name)
+ * Returns: true if the module has been loaded
+ * ============================================== */
+static void c_lazy_loaded(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    const char *name = name_arg(v, argc);
+    SET_BOOL_RETURN(name != NULL && lazy_loaded(name));
+}
+
+/* ==============================================
+ * Method: Lazy.stats
+ * Returns: [{name:, loaded:, bytes:, us:}, ...] for every module
+ *          (bytes = mruby/c heap the load kept, us = load time)
+ * ============================================== */
+static void c_lazy_stats(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    lazy_stats_t stats[LAZY_MAX_MODULES];
+    int n = lazy_get_stats(stats, LAZY_MAX_MODULES);
+    mrbc_value ary = mrbc_array_new(vm, n);
+
+    for (int i = 0; i < n; i++) {
+        mrbc_value hash = mrbc_hash_new(vm, 4);
+        mrbc_value k = mrbc_symbol_value(mrbc_str_to_symid("name"));
+        mrbc_value name = mrbc_string_new_cstr(vm, stats[i].name);
+        mrbc_hash_set(&hash, &k, &name);
+        hash_set_bool(&hash, "loaded", stats[i].loaded);
+        hash_set_int(&hash, "bytes", stats[i].heap_bytes);
+        hash_set_int(&hash, "us", stats[i].load_us);
+        mrbc_array_push(&ary, &hash);
+    }
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Initialize Lazy class
+ * ============================================== */
+void mrbc_lazy_init(mrbc_vm *vm)
+{
+    mrbc_class_Lazy = mrbc_define_class(vm, "Lazy", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Lazy, "load", c_lazy_load);
+    mrbc_define_method(vm, mrbc_class_Lazy, "loaded?", c_lazy_loaded);
+    mrbc_define_method(vm, mrbc_class_Lazy, "stats", c_lazy_stats);
+}
@@ -0,0 +1,9 @@
+/*
+ * Lazy mrubyc initialization stub
+ * Actual implementation is in ports/esp32/lazy_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/lazy_native.c */
+extern void mrbc_lazy_init(mrbc_vm *vm);
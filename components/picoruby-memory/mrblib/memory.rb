@@ -0,0 +1,3 @@
+# Memory class - implemented in C
+class Memory
+end
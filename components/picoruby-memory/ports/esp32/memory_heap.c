@@ -0,0 +1,304 @@
+#include "memory_heap.h"
+#include <string.h>
+#include <mrubyc.h>
+#include "sdkconfig.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char *TAG = "Memory";
+
+// mruby/c block header (alloc.c): the first word is the block size,
+// header included, with the low bits used as flags
+#define BLOCK_FLAGS     0x03u
+#define BLOCK_FREE      0x01u
+
+static uint8_t *heap_pool = NULL;
+static size_t heap_size = 0;
+static bool heap_in_psram = false;
+
+// Offset of the first block past the allocator's pool header, found by
+// memory_heap_largest_free (0 = not found yet)
+static size_t first_block = 0;
+static bool walk_failed = false;
+
+// Allocator calls from outside alloc.c come here (-Wl,--wrap in
+// CMakeLists.txt): counted for the bench, or sent to the system heap for
+// the side task (raw calls only)
+static uint32_t alloc_count = 0;
+static TaskHandle_t side_task = NULL;
+
+void *__real_mrbc_raw_alloc(unsigned int size);
+void *__real_mrbc_raw_calloc(unsigned int nmemb, unsigned int size);
+void *__real_mrbc_raw_realloc(void *ptr, unsigned int size);
+void __real_mrbc_raw_free(void *ptr);
+
+static bool on_side_task(void)
+{
+    return side_task != NULL && xTaskGetCurrentTaskHandle() == side_task;
+}
+
+static bool in_pool(const void *ptr)
+{
+    const uint8_t *p = ptr;
+    return p >= heap_pool && p < heap_pool + heap_size;
+}
+
+static void *side_alloc(size_t size)
+{
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p == NULL) {
+        p = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return p;
+}
+
+void *__wrap_mrbc_raw_alloc(unsigned int size)
+{
+    if (on_side_task()) {
+        return side_alloc(size);
+    }
+    alloc_count++;
+    return __real_mrbc_raw_alloc(size);
+}
+
+void *__wrap_mrbc_raw_calloc(unsigned int nmemb, unsigned int size)
+{
+    if (on_side_task()) {
+        void *p = side_alloc((size_t)nmemb * size);
+        if (p != NULL) {
+            memset(p, 0, (size_t)nmemb * size);
+        }
+        return p;
+    }
+    alloc_count++;
+    return __real_mrbc_raw_calloc(nmemb, size);
+}
+
+void *__wrap_mrbc_raw_realloc(void *ptr, unsigned int size)
+{
+    if (ptr != NULL && !in_pool(ptr)) {
+        return heap_caps_realloc(ptr, size, MALLOC_CAP_8BIT);
+    }
+    if (ptr == NULL && on_side_task()) {
+        return side_alloc(size);
+    }
+    alloc_count++;
+    return __real_mrbc_raw_realloc(ptr, size);
+}
+
+void __wrap_mrbc_raw_free(void *ptr)
+{
+    if (ptr != NULL && !in_pool(ptr)) {
+        heap_caps_free(ptr);
+        return;
+    }
+    __real_mrbc_raw_free(ptr);
+}
+
+// With MRBC_ALLOC_VMID, mrbc_alloc and friends are functions in alloc.c
+// and their raw allocator calls stay inside alloc.c, out of --wrap's
+// reach: count them here. Without it they are macros for the raw calls and
+// these wrappers are never linked in (hence the weak references)
+void *__real_mrbc_alloc(const struct VM *vm, unsigned int size) __attribute__((weak));
+void *__real_mrbc_calloc(const struct VM *vm, unsigned int nmemb, unsigned int size) __attribute__((weak));
+void *__real_mrbc_realloc(const struct VM *vm, void *ptr, unsigned int size) __attribute__((weak));
+
+void *__wrap_mrbc_alloc(const struct VM *vm, unsigned int size)
+{
+    if (!on_side_task()) {
+        alloc_count++;
+    }
+    return __real_mrbc_alloc(vm, size);
+}
+
+void *__wrap_mrbc_calloc(const struct VM *vm, unsigned int nmemb, unsigned int size)
+{
+    if (!on_side_task()) {
+        alloc_count++;
+    }
+    return __real_mrbc_calloc(vm, nmemb, size);
+}
+
+void *__wrap_mrbc_realloc(const struct VM *vm, void *ptr, unsigned int size)
+{
+    if (!on_side_task()) {
+        alloc_count++;
+    }
+    return __real_mrbc_realloc(vm, ptr, size);
+}
+
+void memory_heap_set_side_task(TaskHandle_t task)
+{
+    side_task = task;
+}
+
+uint32_t memory_heap_alloc_count(void)
+{
+    return alloc_count;
+}
+
+size_t memory_heap_boot_size(void)
+{
+    uint32_t kb = CONFIG_PICORUBY_HEAP_SIZE_KB;
+
+    nvs_handle_t nvs;
+    if (nvs_open(MEMORY_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        uint32_t stored = 0;
+        if (nvs_get_u32(nvs, MEMORY_NVS_KEY_HEAP_KB, &stored) == ESP_OK && stored > 0) {
+            kb = stored;
+        }
+        nvs_close(nvs);
+    }
+
+    return (size_t)kb * 1024;
+}
+
+void *memory_heap_alloc(size_t *size)
+{
+    size_t want = memory_heap_boot_size();
+    void *pool = NULL;
+
+#if CONFIG_PICORUBY_HEAP_IN_PSRAM
+    pool = heap_caps_malloc(want, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (pool != NULL) {
+        heap_pool = pool;
+        heap_size = want;
+        heap_in_psram = true;
+        *size = heap_size;
+        ESP_LOGI(TAG, "mruby/c heap: %u KB in PSRAM", (unsigned)(want / 1024));
+        return pool;
+    }
+    ESP_LOGW(TAG, "No PSRAM for %u KB heap, using internal RAM", (unsigned)(want / 1024));
+#endif
+
+    // Leave room in internal RAM for tasks and DMA buffers
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    size_t limit = largest > MEMORY_INTERNAL_RESERVE ? largest - MEMORY_INTERNAL_RESERVE : 0;
+    if (want > limit) {
+        ESP_LOGW(TAG, "Heap %u KB does not fit, shrinking to %u KB",
+                 (unsigned)(want / 1024), (unsigned)(limit / 1024));
+        want = limit;
+    }
+
+    while (want >= MEMORY_HEAP_MIN_SIZE) {
+        pool = heap_caps_malloc(want, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (pool != NULL) {
+            break;
+        }
+        want -= want / 8;
+    }
+
+    if (pool == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate mruby/c heap");
+        *size = 0;
+        return NULL;
+    }
+
+    heap_pool = pool;
+    heap_size = want;
+    heap_in_psram = false;
+    *size = heap_size;
+    ESP_LOGI(TAG, "mruby/c heap: %u KB in internal RAM", (unsigned)(want / 1024));
+    return pool;
+}
+
+size_t memory_heap_size(void)
+{
+    return heap_size;
+}
+
+bool memory_heap_in_psram(void)
+{
+    return heap_in_psram;
+}
+
+// Walk the blocks from offset to the end of the pool, like
+// mrbc_alloc_statistics does
+// Returns false when they do not line up with the pool
+static bool walk_pool(size_t offset, uint32_t *free_bytes, uint32_t *largest)
+{
+    *free_bytes = 0;
+    *largest = 0;
+
+    size_t pos = offset;
+    while (pos + sizeof(uint32_t) <= heap_size) {
+        uint32_t word;
+        memcpy(&word, heap_pool + pos, sizeof(word));
+        uint32_t size = word & ~BLOCK_FLAGS;
+        if (size == 0 && pos + MEMORY_POOL_SENTINEL_MAX >= heap_size) {
+            // End sentinel
+            return true;
+        }
+        if (size < sizeof(uint32_t) || size > heap_size - pos) {
+            return false;
+        }
+        if (word & BLOCK_FREE) {
+            *free_bytes += size;
+            if (size > *largest) {
+                *largest = size;
+            }
+        }
+        pos += size;
+    }
+    return pos == heap_size;
+}
+
+int32_t memory_heap_largest_free(void)
+{
+    if (heap_pool == NULL || walk_failed) {
+        return -1;
+    }
+
+    struct MRBC_ALLOC_STATISTICS stat;
+    mrbc_alloc_statistics(&stat);
+
+    uint32_t free_bytes;
+    uint32_t largest;
+    if (first_block > 0 && walk_pool(first_block, &free_bytes, &largest) &&
+        free_bytes == stat.free) {
+        return (int32_t)largest;
+    }
+
+    // The pool header size depends on how the allocator was built: take the
+    // first offset whose blocks tile the pool and add up to the free bytes
+    // the allocator itself reports
+    for (size_t offset = sizeof(uint32_t); offset <= MEMORY_POOL_HEADER_MAX;
+         offset += sizeof(uint32_t)) {
+        if (walk_pool(offset, &free_bytes, &largest) && free_bytes == stat.free) {
+            first_block = offset;
+            return (int32_t)largest;
+        }
+    }
+
+    ESP_LOGW(TAG, "Heap blocks not recognised, largest free block unknown");
+    walk_failed = true;
+    return -1;
+}
+
+bool memory_heap_set_boot_size(uint32_t kb)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(MEMORY_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    if (kb == 0) {
+        ret = nvs_erase_key(nvs, MEMORY_NVS_KEY_HEAP_KB);
+        if (ret == ESP_ERR_NVS_NOT_FOUND) {
+            ret = ESP_OK;
+        }
+    } else {
+        ret = nvs_set_u32(nvs, MEMORY_NVS_KEY_HEAP_KB, kb);
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+
+    return ret == ESP_OK;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// NVS location of the heap size override (KB, 0 = use Kconfig)
+#define MEMORY_NVS_NAMESPACE    "picoruby"
+#define MEMORY_NVS_KEY_HEAP_KB  "heap_kb"
+
+// Smallest heap we try before giving up
+#define MEMORY_HEAP_MIN_SIZE    (32 * 1024)
+
+// Internal RAM left for tasks, DMA buffers and drivers
+#define MEMORY_INTERNAL_RESERVE (64 * 1024)
+
+// Largest pool header memory_heap_largest_free looks past, and room
+// left for the allocator's end sentinel
+#define MEMORY_POOL_HEADER_MAX  2048
+#define MEMORY_POOL_SENTINEL_MAX 16
+
+// Heap size for this boot: NVS override, else CONFIG_PICORUBY_HEAP_SIZE_KB
+size_t memory_heap_boot_size(void);
+
+// Allocate the mruby/c heap (PSRAM if configured, else internal RAM)
+// Returns the pool and sets *size, NULL if nothing could be allocated
+void *memory_heap_alloc(size_t *size);
+
+// Size and placement of the allocated heap
+size_t memory_heap_size(void);
+bool memory_heap_in_psram(void);
+
+// Largest free block on the mruby/c heap, found by walking its blocks
+// without allocating (VM task only)
+// Returns -1 when the block layout is not recognised
+int32_t memory_heap_largest_free(void);
+
+// mruby/c heap allocations from task go to the system heap (PSRAM first)
+// instead, so it can run code that allocates (e.g. the parser) while the
+// VM uses the heap (NULL: none)
+// Pointers outside the pool are freed and resized on the system heap
+void memory_heap_set_side_task(TaskHandle_t task);
+
+// mruby/c heap allocations since boot (not counting the side task's)
+uint32_t memory_heap_alloc_count(void);
+
+// Store the heap size for the next boot (kb 0 clears the override)
+bool memory_heap_set_boot_size(uint32_t kb);
+
+#ifdef __cplusplus
+}
+#endif
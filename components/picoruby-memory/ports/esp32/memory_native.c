@@ -0,0 +1,108 @@
+/*
+ * Memory Native mrubyc bindings
+ */
+
+#include "memory_heap.h"
+#include "native_hash.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Memory = NULL;
+
+/* ==============================================
+ * Method: Memory.stats
+ * mruby/c heap statistics
+ * Returns: {total:, used:, free:, fragmentation:} in bytes
+ *          (fragmentation = number of free blocks)
+ * ============================================== */
+static void c_memory_stats(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    struct MRBC_ALLOC_STATISTICS stat;
+    mrbc_alloc_statistics(&stat);
+
+    mrbc_value hash = mrbc_hash_new(vm, 4);
+    hash_set_int(&hash, "total", stat.total);
+    hash_set_int(&hash, "used", stat.used);
+    hash_set_int(&hash, "free", stat.free);
+    hash_set_int(&hash, "fragmentation", stat.fragmentation);
+
+    SET_RETURN(hash);
+}
+
+/* ==============================================
+ * Method: Memory.used
+ * Bytes in use on the mruby/c heap (no allocation)
+ * ============================================== */
+static void c_memory_used(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    struct MRBC_ALLOC_STATISTICS stat;
+    mrbc_alloc_statistics(&stat);
+    SET_INT_RETURN(stat.used);
+}
+
+/* ==============================================
+ * Method: Memory.largest_free
+ * Largest free block on the mruby/c heap (no allocation)
+ * Returns: bytes, nil if the heap layout is not recognised
+ * ============================================== */
+static void c_memory_largest_free(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int32_t largest = memory_heap_largest_free();
+    if (largest < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+    SET_INT_RETURN(largest);
+}
+
+/* ==============================================
+ * Method: Memory.heap_info
+ * Where the mruby/c heap lives
+ * Returns: {size:, psram:, boot_size:} (boot_size applies next boot)
+ * ============================================== */
+static void c_memory_heap_info(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    mrbc_value hash = mrbc_hash_new(vm, 3);
+    hash_set_int(&hash, "size", memory_heap_size());
+
+    mrbc_value k = mrbc_symbol_value(mrbc_str_to_symid("psram"));
+    mrbc_value b = mrbc_bool_value(memory_heap_in_psram());
+    mrbc_hash_set(&hash, &k, &b);
+
+    hash_set_int(&hash, "boot_size", memory_heap_boot_size());
+
+    SET_RETURN(hash);
+}
+
+/* ==============================================
+ * Method: Memory.set_boot_heap(kb)
+ * Store the heap size for the next boot in NVS (0 = Kconfig default)
+ * Returns: true on success, false on failure
+ * ============================================== */
+static void c_memory_set_boot_heap(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_INTEGER || GET_INT_ARG(1) < 0) {
+        SET_FALSE_RETURN();
+        return;
+    }
+
+    if (memory_heap_set_boot_size((uint32_t)GET_INT_ARG(1))) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Initialize Memory class
+ * ============================================== */
+void mrbc_memory_init(mrbc_vm *vm)
+{
+    mrbc_class_Memory = mrbc_define_class(vm, "Memory", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Memory, "stats", c_memory_stats);
+    mrbc_define_method(vm, mrbc_class_Memory, "used", c_memory_used);
+    mrbc_define_method(vm, mrbc_class_Memory, "largest_free", c_memory_largest_free);
+    mrbc_define_method(vm, mrbc_class_Memory, "heap_info", c_memory_heap_info);
+    mrbc_define_method(vm, mrbc_class_Memory, "set_boot_heap", c_memory_set_boot_heap);
+}
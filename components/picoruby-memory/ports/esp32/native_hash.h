@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <mrubyc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Set hash[:key] = value, for the {key: ...} results of the natives
+static inline void hash_set_int(mrbc_value *hash, const char *key, int value)
+{
+    mrbc_value k = mrbc_symbol_value(mrbc_str_to_symid(key));
+    mrbc_value v = mrbc_integer_value(value);
+    mrbc_hash_set(hash, &k, &v);
+}
+
+static inline void hash_set_bool(mrbc_value *hash, const char *key, bool value)
+{
+    mrbc_value k = mrbc_symbol_value(mrbc_str_to_symid(key));
+    mrbc_value v = mrbc_bool_value(value);
+    mrbc_hash_set(hash, &k, &v);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,9 @@
+/*
+ * Memory mrubyc initialization stub
+ * Actual implementation is in ports/esp32/memory_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/memory_native.c */
+extern void mrbc_memory_init(mrbc_vm *vm);
@@ -0,0 +1,3 @@
+# Perf class - implemented in C
+class Perf
+end
@@ -0,0 +1,173 @@
+/*
+ * Perf Native mrubyc bindings
+ */
+
+#include "perf_stats.h"
+#include "native_hash.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Perf = NULL;
+
+static bool truthy_arg(mrbc_value *v, int argc, int i)
+{
+    return argc >= i && mrbc_type(v[i]) != MRBC_TT_NIL && mrbc_type(v[i]) != MRBC_TT_FALSE;
+}
+
+/* ==============================================
+ * Method: Perf.frame_begin
+ * Start of a main loop pass (call right after Keyboard.read_all)
+ * ============================================== */
+static void c_perf_frame_begin(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    perf_frame_begin();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Perf.redraw(full, newline, line)
+ * Count the redraw of the pass from the need_*_redraw flags
+ * (the first one set wins)
+ * ============================================== */
+static void c_perf_redraw(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    perf_redraw_t kind = PERF_REDRAW_NONE;
+    if (truthy_arg(v, argc, 1)) {
+        kind = PERF_REDRAW_FULL;
+    } else if (truthy_arg(v, argc, 2)) {
+        kind = PERF_REDRAW_NEWLINE;
+    } else if (truthy_arg(v, argc, 3)) {
+        kind = PERF_REDRAW_LINE;
+    }
+    perf_redraw(kind);
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Perf.frame_end
+ * End of the redraw: measure the keys read for the pass
+ * ============================================== */
+static void c_perf_frame_end(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    perf_frame_end();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Perf.stats
+ * Returns: {keys:, unseen:, frames:, full:, newline:, line:,
+ *           p50_us:, p99_us:, max_us:}
+ * ============================================== */
+static void c_perf_stats(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    perf_stats_t st;
+    perf_get_stats(&st);
+
+    mrbc_value hash = mrbc_hash_new(vm, 9);
+    hash_set_int(&hash, "keys", st.keys);
+    hash_set_int(&hash, "unseen", st.unseen);
+    hash_set_int(&hash, "frames", st.frames);
+    hash_set_int(&hash, "full", st.redraws[PERF_REDRAW_FULL]);
+    hash_set_int(&hash, "newline", st.redraws[PERF_REDRAW_NEWLINE]);
+    hash_set_int(&hash, "line", st.redraws[PERF_REDRAW_LINE]);
+    hash_set_int(&hash, "p50_us", perf_percentile(50));
+    hash_set_int(&hash, "p99_us", perf_percentile(99));
+    hash_set_int(&hash, "max_us", st.max_us);
+
+    SET_RETURN(hash);
+}
+
+/* ==============================================
+ * Method: Perf.fps
+ * Returns: frames per second x 10 since the last call
+ * ============================================== */
+static void c_perf_fps(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN(perf_fps_x10());
+}
+
+/* ==============================================
+ * Method: Perf.histogram
+ * Returns: [[low_us, count], ...] for the buckets that hold keys
+ * ============================================== */
+static void c_perf_histogram(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    const uint32_t *counts = perf_histogram();
+    mrbc_value ary = mrbc_array_new(vm, 8);
+
+    for (int i = 0; i < PERF_BUCKETS; i++) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        mrbc_value item = mrbc_array_new(vm, 2);
+        mrbc_value val = mrbc_integer_value(perf_bucket_low(i));
+        mrbc_array_push(&item, &val);
+        val = mrbc_integer_value(counts[i]);
+        mrbc_array_push(&item, &val);
+        mrbc_array_push(&ary, &item);
+    }
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Method: Perf.reset
+ * ============================================== */
+static void c_perf_reset(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    perf_reset();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Perf.boot_mark(name)
+ * Record that boot reached name (after the drawing so far is done)
+ * ============================================== */
+static void c_perf_boot_mark(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc >= 1 && mrbc_type(v[1]) == MRBC_TT_STRING && perf_boot_mark(mrbc_string_cstr(&v[1]))) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Perf.boot
+ * Returns: [[name, us], ...] boot marks in order (us since app start)
+ * ============================================== */
+static void c_perf_boot(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    const perf_boot_mark_t *marks;
+    int n = perf_boot_marks(&marks);
+    mrbc_value ary = mrbc_array_new(vm, n);
+
+    for (int i = 0; i < n; i++) {
+        mrbc_value item = mrbc_array_new(vm, 2);
+        mrbc_value val = mrbc_string_new_cstr(vm, marks[i].name);
+        mrbc_array_push(&item, &val);
+        val = mrbc_integer_value(marks[i].us);
+        mrbc_array_push(&item, &val);
+        mrbc_array_push(&ary, &item);
+    }
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Initialize Perf class
+ * ============================================== */
+void mrbc_perf_init(mrbc_vm *vm)
+{
+    mrbc_class_Perf = mrbc_define_class(vm, "Perf", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Perf, "frame_begin", c_perf_frame_begin);
+    mrbc_define_method(vm, mrbc_class_Perf, "redraw", c_perf_redraw);
+    mrbc_define_method(vm, mrbc_class_Perf, "frame_end", c_perf_frame_end);
+    mrbc_define_method(vm, mrbc_class_Perf, "stats", c_perf_stats);
+    mrbc_define_method(vm, mrbc_class_Perf, "fps", c_perf_fps);
+    mrbc_define_method(vm, mrbc_class_Perf, "histogram", c_perf_histogram);
+    mrbc_define_method(vm, mrbc_class_Perf, "reset", c_perf_reset);
+    mrbc_define_method(vm, mrbc_class_Perf, "boot_mark", c_perf_boot_mark);
+    mrbc_define_method(vm, mrbc_class_Perf, "boot", c_perf_boot);
+}
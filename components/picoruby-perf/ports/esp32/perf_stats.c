@@ -0,0 +1,190 @@
+#include "perf_stats.h"
+#include "keyboard_driver.h"
+#include "st7789_spi.h"
+#include "render_queue.h"
+#include <string.h>
+#include "esp_timer.h"
+
+// All of this runs on the VM, around the main loop passes
+static uint32_t histogram[PERF_BUCKETS];
+static perf_stats_t stats;
+
+static perf_boot_mark_t boot_marks[PERF_BOOT_MARKS];
+static int boot_mark_count = 0;
+
+// Passes whose drawing may still be queued: measured once the render
+// worker reaches the mark after them
+typedef struct {
+    uint32_t begin_mark;
+    uint32_t end_mark;
+    size_t keys;
+    uint32_t read_us[KEYBOARD_RING_SIZE];
+} pending_frame_t;
+
+static pending_frame_t pending[PERF_PENDING_FRAMES];
+static int pending_first = 0;
+static int pending_count = 0;
+static uint32_t begin_mark = 0;
+
+static uint32_t fps_frames = 0;
+static int64_t fps_start = 0;
+
+static int bucket_of(uint32_t us)
+{
+    if (us < PERF_SUB_BUCKETS) {
+        return (int)us;
+    }
+    int e = 31 - __builtin_clz(us);
+    int sub = (us >> (e - 2)) & (PERF_SUB_BUCKETS - 1);
+    return (e - 1) * PERF_SUB_BUCKETS + sub;
+}
+
+uint32_t perf_bucket_low(int bucket)
+{
+    if (bucket < PERF_SUB_BUCKETS) {
+        return (uint32_t)bucket;
+    }
+    int e = bucket / PERF_SUB_BUCKETS + 1;
+    int sub = bucket % PERF_SUB_BUCKETS;
+    return (uint32_t)(PERF_SUB_BUCKETS + sub) << (e - 2);
+}
+
+// Measure the passes the render worker has finished, oldest first
+static void collect_frames(void)
+{
+    while (pending_count > 0) {
+        pending_frame_t *f = &pending[pending_first];
+        render_stamp_t begin;
+        render_stamp_t end;
+        if (!render_mark_stamp(f->end_mark, &end)) {
+            return;
+        }
+        render_mark_stamp(f->begin_mark, &begin);
+        pending_first = (pending_first + 1) % PERF_PENDING_FRAMES;
+        pending_count--;
+
+        if (end.transfers == begin.transfers) {
+            stats.unseen += f->keys;
+            continue;
+        }
+        stats.frames++;
+        fps_frames++;
+
+        // Both times come from esp_timer truncated to 32 bits, so the
+        // difference is right across a wrap
+        for (size_t i = 0; i < f->keys; i++) {
+            uint32_t us = end.last_us - f->read_us[i];
+            histogram[bucket_of(us)]++;
+            stats.keys++;
+            if (us > stats.max_us) {
+                stats.max_us = us;
+            }
+        }
+    }
+}
+
+void perf_frame_begin(void)
+{
+    collect_frames();
+    begin_mark = render_mark();
+}
+
+void perf_redraw(perf_redraw_t kind)
+{
+    if (kind > PERF_REDRAW_NONE && kind < PERF_REDRAW_KINDS) {
+        stats.redraws[kind]++;
+    }
+}
+
+void perf_frame_end(void)
+{
+    collect_frames();
+    if (pending_count == PERF_PENDING_FRAMES) {
+        // The worker is that far behind: wait rather than drop a pass
+        render_fence();
+        collect_frames();
+    }
+
+    pending_frame_t *f = &pending[(pending_first + pending_count) % PERF_PENDING_FRAMES];
+    f->keys = keyboard_take_read_times(f->read_us, KEYBOARD_RING_SIZE);
+    f->begin_mark = begin_mark;
+    f->end_mark = render_mark();
+    pending_count++;
+}
+
+uint32_t perf_percentile(int pct)
+{
+    collect_frames();
+    if (stats.keys == 0) {
+        return 0;
+    }
+
+    uint64_t want = ((uint64_t)stats.keys * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < PERF_BUCKETS; i++) {
+        seen += histogram[i];
+        if (seen >= want && seen > 0) {
+            uint32_t high = i + 1 < PERF_BUCKETS ? perf_bucket_low(i + 1) - 1 : UINT32_MAX;
+            return high < stats.max_us ? high : stats.max_us;
+        }
+    }
+    return stats.max_us;
+}
+
+void perf_get_stats(perf_stats_t *st)
+{
+    collect_frames();
+    *st = stats;
+}
+
+const uint32_t *perf_histogram(void)
+{
+    collect_frames();
+    return histogram;
+}
+
+uint32_t perf_fps_x10(void)
+{
+    collect_frames();
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed = now - fps_start;
+    uint32_t fps = 0;
+    if (fps_start != 0 && elapsed > 0) {
+        fps = (uint32_t)(fps_frames * 10000000LL / elapsed);
+    }
+    fps_start = now;
+    fps_frames = 0;
+    return fps;
+}
+
+void perf_reset(void)
+{
+    uint32_t read_us[KEYBOARD_RING_SIZE];
+    keyboard_take_read_times(read_us, KEYBOARD_RING_SIZE);
+
+    memset(histogram, 0, sizeof(histogram));
+    memset(&stats, 0, sizeof(stats));
+    pending_count = 0;
+    fps_frames = 0;
+    fps_start = esp_timer_get_time();
+}
+
+bool perf_boot_mark(const char *name)
+{
+    if (boot_mark_count >= PERF_BOOT_MARKS) {
+        return false;
+    }
+    render_fence();
+
+    perf_boot_mark_t *mark = &boot_marks[boot_mark_count++];
+    strncpy(mark->name, name, PERF_BOOT_NAME_MAX);
+    mark->name[PERF_BOOT_NAME_MAX] = '\0';
+    mark->us = (uint32_t)esp_timer_get_time();
+    return true;
+}
+
+int perf_boot_marks(const perf_boot_mark_t **marks)
+{
+    *marks = boot_marks;
+    return boot_mark_count;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Log buckets: four per power of two, so a bucket is at most 25% wide
+// Values below 4 us get a bucket each, the last bucket ends at 2^32 us
+#define PERF_SUB_BUCKETS     4
+#define PERF_BUCKETS         124
+
+// Passes waiting for the render worker before perf_frame_end fences
+#define PERF_PENDING_FRAMES  8
+
+// Redraw kinds of a main loop pass (the first one needed wins)
+typedef enum {
+    PERF_REDRAW_NONE = 0,
+    PERF_REDRAW_FULL,
+    PERF_REDRAW_NEWLINE,
+    PERF_REDRAW_LINE,
+    PERF_REDRAW_KINDS,
+} perf_redraw_t;
+
+// Mark the start of a main loop pass (right after the keys are read)
+void perf_frame_begin(void);
+
+// Count the redraw kind of the pass
+void perf_redraw(perf_redraw_t kind);
+
+// Mark the end of its redraw: the keys read for the pass are measured
+// from their I2C read to the end of the last panel transfer since
+// perf_frame_begin (keys whose pass drew nothing are counted as unseen)
+// Neither waits: both queue a render mark, and a pass is measured once the
+// worker has reached the one after it (the results below catch up then)
+void perf_frame_end(void);
+
+// Smallest value (us) that falls in a bucket
+uint32_t perf_bucket_low(int bucket);
+
+// Latency (us) below which pct percent of the keys fall (bucket upper bound)
+uint32_t perf_percentile(int pct);
+
+typedef struct {
+    uint32_t keys;                        // keys measured
+    uint32_t unseen;                      // keys whose pass drew nothing
+    uint32_t frames;                      // passes that drew
+    uint32_t redraws[PERF_REDRAW_KINDS];  // passes by redraw kind
+    uint32_t max_us;
+} perf_stats_t;
+
+void perf_get_stats(perf_stats_t *st);
+
+// Key count of each bucket (PERF_BUCKETS entries)
+const uint32_t *perf_histogram(void);
+
+// Frames per second since the last call (x10, for one decimal)
+uint32_t perf_fps_x10(void);
+
+// Forget everything measured so far (and keys read before)
+void perf_reset(void);
+
+// Boot breakdown: named points app.rb reaches while starting up, with the
+// esp_timer time (from app start) once the drawing before them is done
+#define PERF_BOOT_MARKS      12
+#define PERF_BOOT_NAME_MAX   11
+
+typedef struct {
+    char name[PERF_BOOT_NAME_MAX + 1];
+    uint32_t us;
+} perf_boot_mark_t;
+
+// Record a mark (false once PERF_BOOT_MARKS are taken); not reset by perf_reset
+bool perf_boot_mark(const char *name);
+
+// Marks so far, in order
+int perf_boot_marks(const perf_boot_mark_t **marks);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,9 @@
+/*
+ * Perf mrubyc initialization stub
+ * Actual implementation is in ports/esp32/perf_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/perf_native.c */
+extern void mrbc_perf_init(mrbc_vm *vm);
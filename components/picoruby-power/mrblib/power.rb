@@ -0,0 +1,3 @@
+# Power class - implemented in C
+class Power
+end
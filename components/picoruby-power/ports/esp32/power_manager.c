@@ -0,0 +1,270 @@
+#include "power_manager.h"
+#include "event_queue.h"
+#include "keyboard_driver.h"
+#include "trackball_driver.h"
+#include "checker_task.h"
+#include "render_queue.h"
+#include "st7789_spi.h"
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#if CONFIG_PICORUBY_LIGHT_SLEEP
+#include "esp_sleep.h"
+#endif
+
+static const char *TAG = "Power";
+
+typedef enum {
+    SCREEN_ON = 0,
+    SCREEN_DIM,
+    SCREEN_OFF,
+} screen_t;
+
+static uint32_t dim_after_ms = POWER_DIM_AFTER_MS;
+static uint32_t off_after_ms = POWER_OFF_AFTER_MS;
+#if CONFIG_PICORUBY_LIGHT_SLEEP
+static bool sleep_on = true;
+#else
+static bool sleep_on = false;
+#endif
+
+// Backlight as power_wait left it, and the level input restores
+static screen_t screen = SCREEN_ON;
+static uint8_t active_level = ST7789_BACKLIGHT_LEVELS;
+
+static bool keyboard_idle = false;
+
+// When the last light sleep ended by a key or trackball move: input the
+// event queue has not seen yet
+static int64_t input_wake_us = 0;
+
+static uint32_t sleeps = 0;
+static uint64_t sleep_us = 0;
+static uint32_t input_wakes = 0;
+static uint32_t dims = 0;
+
+static uint32_t min_ms(uint32_t a, uint32_t b)
+{
+    return a < b ? a : b;
+}
+
+static uint32_t idle_ms(int64_t now)
+{
+    int64_t last = event_last_input_us();
+    if (input_wake_us > last) {
+        last = input_wake_us;
+    }
+    return (uint32_t)((now - last) / 1000);
+}
+
+// Through the render queue, so it stays in order with TFT.set_backlight
+static void push_backlight(uint8_t level)
+{
+    render_cmd_t cmd = { .op = RENDER_BACKLIGHT, .x = level };
+    render_push(&cmd);
+}
+
+static void set_keyboard_idle(bool idle)
+{
+    if (idle != keyboard_idle) {
+        keyboard_idle = idle;
+        keyboard_set_idle(idle);
+    }
+}
+
+static screen_t screen_for(uint32_t idle)
+{
+    if (off_after_ms > 0 && idle >= off_after_ms) {
+        return SCREEN_OFF;
+    }
+    if (dim_after_ms > 0 && idle >= dim_after_ms) {
+        return SCREEN_DIM;
+    }
+    return SCREEN_ON;
+}
+
+// Dim or turn off the backlight as the idle time grows
+// Returns the ms until the next step (EVENT_WAIT_FOREVER if none)
+static uint32_t step_screen(uint32_t idle)
+{
+    screen_t want = screen_for(idle);
+    if (want > screen) {
+        if (screen == SCREEN_ON) {
+            // Read the level once nothing queued can still change it
+            if (!render_idle()) {
+                return POWER_BUSY_MS;
+            }
+            active_level = st7789_get_backlight();
+        }
+        uint8_t level = 0;
+        if (want == SCREEN_DIM) {
+            level = active_level < POWER_DIM_LEVEL ? active_level : POWER_DIM_LEVEL;
+        }
+        push_backlight(level);
+        screen = want;
+        dims++;
+    }
+
+    uint32_t next = EVENT_WAIT_FOREVER;
+    if (screen < SCREEN_DIM && dim_after_ms > idle) {
+        next = dim_after_ms - idle;
+    }
+    if (screen < SCREEN_OFF && off_after_ms > idle) {
+        next = min_ms(next, off_after_ms - idle);
+    }
+    return next;
+}
+
+static void wake_screen(void)
+{
+    if (screen != SCREEN_ON) {
+        push_backlight(active_level);
+        screen = SCREEN_ON;
+    }
+}
+
+static uint32_t woken(uint32_t bits)
+{
+    if (bits & (EVENT_KEY | EVENT_TRACKBALL)) {
+        wake_screen();
+        set_keyboard_idle(false);
+    }
+    return bits;
+}
+
+// Light sleep up to ms, less when the event timer is due sooner
+// Returns false when it did not sleep
+#if CONFIG_PICORUBY_LIGHT_SLEEP
+static bool light_sleep(uint32_t ms)
+{
+    // The render worker and the checker run on the other core, which
+    // stops with this one
+    if (!render_idle() || checker_busy()) {
+        return false;
+    }
+
+    // Only the editor's own timers bound the sleep: the VM's 1 ms tick
+    // timer is always due within a millisecond, and catches up on the
+    // ticks it missed once the chip wakes. The session save is already
+    // in ms (the power_wait timeout).
+    int64_t start = esp_timer_get_time();
+    int64_t us = (int64_t)ms * 1000;
+    int64_t timer_us = event_next_timer_us() - start;
+    if (timer_us < us) {
+        us = timer_us;
+    }
+    if (us < POWER_SLEEP_MIN_US || !keyboard_sleep_prepare()) {
+        return false;
+    }
+    trackball_sleep_prepare();
+
+    esp_sleep_enable_timer_wakeup((uint64_t)us);
+    esp_sleep_enable_gpio_wakeup();
+    // Outputs would float while the chip sleeps: the backlight driver
+    // would turn off and lose its level
+    st7789_hold_pins(true);
+    esp_err_t err = esp_light_sleep_start();
+    st7789_hold_pins(false);
+
+    trackball_sleep_resume();
+    keyboard_sleep_resume();
+    if (err != ESP_OK) {
+        // Rejected when a wake-up source is already active
+        ESP_LOGD(TAG, "Light sleep not entered: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    int64_t end = esp_timer_get_time();
+    sleeps++;
+    sleep_us += (uint64_t)(end - start);
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) {
+        input_wakes++;
+        input_wake_us = end;
+        wake_screen();
+    }
+    return true;
+}
+#else
+static bool light_sleep(uint32_t ms)
+{
+    return false;
+}
+#endif
+
+uint32_t power_wait(uint32_t timeout_ms)
+{
+    if (timeout_ms == 0) {
+        return woken(event_wait(0));
+    }
+
+    int64_t start = esp_timer_get_time();
+    bool just_woke = false;
+
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        uint32_t left = EVENT_WAIT_FOREVER;
+        if (timeout_ms != EVENT_WAIT_FOREVER) {
+            uint32_t waited = (uint32_t)((now - start) / 1000);
+            if (waited >= timeout_ms) {
+                return 0;
+            }
+            left = timeout_ms - waited;
+        }
+
+        uint32_t idle = idle_ms(now);
+        uint32_t chunk = min_ms(left, step_screen(idle));
+        set_keyboard_idle(idle >= POWER_SLEEP_AFTER_MS);
+
+        if (just_woke) {
+            chunk = min_ms(chunk, POWER_WAKE_MS);
+        } else if (sleep_on && idle < POWER_SLEEP_AFTER_MS) {
+            chunk = min_ms(chunk, POWER_SLEEP_AFTER_MS - idle);
+        } else if (sleep_on) {
+            // Events that came in since the last wait go first
+            uint32_t bits = event_wait(0);
+            if (bits != 0) {
+                return woken(bits);
+            }
+            if (light_sleep(min_ms(chunk, POWER_SLEEP_MAX_MS))) {
+                just_woke = true;
+                continue;
+            }
+            chunk = min_ms(chunk, POWER_BUSY_MS);
+        }
+        just_woke = false;
+
+        uint32_t bits = event_wait(chunk);
+        if (bits != 0) {
+            return woken(bits);
+        }
+    }
+}
+
+void power_set_idle(uint32_t dim_ms, uint32_t off_ms)
+{
+    dim_after_ms = dim_ms;
+    off_after_ms = off_ms;
+    ESP_LOGI(TAG, "Dim after %u ms, off after %u ms", (unsigned)dim_ms, (unsigned)off_ms);
+}
+
+bool power_set_sleep(bool on)
+{
+#if CONFIG_PICORUBY_LIGHT_SLEEP
+    sleep_on = on;
+#endif
+    return sleep_on;
+}
+
+void power_get_stats(power_stats_t *st)
+{
+    *st = (power_stats_t){
+        .sleeps = sleeps,
+        .sleep_ms = (uint32_t)(sleep_us / 1000),
+        .input_wakes = input_wakes,
+        .dims = dims,
+        .idle_ms = idle_ms(esp_timer_get_time()),
+        .level = screen == SCREEN_ON ? st7789_get_backlight() : active_level,
+        .dimmed = screen != SCREEN_ON,
+        .sleep = sleep_on,
+    };
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Backlight steps after the last key or trackball event (ms, 0 = never)
+#define POWER_DIM_AFTER_MS      30000
+#define POWER_OFF_AFTER_MS      300000
+
+// Backlight level while dimmed (brighter user levels are restored on input)
+#define POWER_DIM_LEVEL         3
+
+// Light sleep between events once input stopped this long
+#define POWER_SLEEP_AFTER_MS    2000
+
+// Longest light sleep: the keyboard is drained at every wake-up, so keys
+// still arrive when its INT line does not wake the chip
+#define POWER_SLEEP_MAX_MS      100
+
+// Shorter sleeps are not worth entering (us)
+#define POWER_SLEEP_MIN_US      2000
+
+// Awake time after a wake-up, for the keyboard task to drain the controller
+#define POWER_WAKE_MS           5
+
+// Re-check period while the render worker or the checker keep the chip up
+#define POWER_BUSY_MS           10
+
+// Block the VM like event_wait (same bits and timeout), dimming the
+// backlight as input stays away and light sleeping between events when
+// CONFIG_PICORUBY_LIGHT_SLEEP is on; input restores the backlight
+uint32_t power_wait(uint32_t timeout_ms);
+
+// Idle times before dimming and turning the backlight off (ms, 0 = never)
+void power_set_idle(uint32_t dim_ms, uint32_t off_ms);
+
+// Allow light sleep (always false without CONFIG_PICORUBY_LIGHT_SLEEP)
+// Returns whether it is allowed now
+bool power_set_sleep(bool on);
+
+typedef struct {
+    uint32_t sleeps;        // light sleeps entered
+    uint32_t sleep_ms;      // time spent in them
+    uint32_t input_wakes;   // ended by the keyboard or trackball
+    uint32_t dims;          // times the backlight was dimmed or turned off
+    uint32_t idle_ms;       // since the last input
+    uint8_t level;          // backlight restored on input
+    bool dimmed;            // backlight is below that level now
+    bool sleep;             // light sleep allowed
+} power_stats_t;
+
+void power_get_stats(power_stats_t *st);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Power Native mrubyc bindings
+ */
+
+#include "power_manager.h"
+#include "event_queue.h"
+#include "native_hash.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Power = NULL;
+
+/* ==============================================
+ * Method: Power.wait or Power.wait(timeout_ms)
+ * Event.wait that saves power while no input arrives: dims and then
+ * turns off the backlight, and light sleeps between events
+ * (a key or trackball move brings the backlight back)
+ * Returns: Integer bitmask of Event::KEY etc. (0 on timeout)
+ * ============================================== */
+static void c_power_wait(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    uint32_t timeout_ms = EVENT_WAIT_FOREVER;
+
+    if (argc >= 1 && mrbc_type(v[1]) == MRBC_TT_INTEGER) {
+        mrbc_int_t ms = GET_INT_ARG(1);
+        timeout_ms = ms < 0 ? 0 : (uint32_t)ms;
+    }
+
+    SET_INT_RETURN(power_wait(timeout_ms));
+}
+
+/* ==============================================
+ * Method: Power.set_idle(dim_ms, off_ms)
+ * Idle time before the backlight dims and before it turns off
+ * (0 = never)
+ * ============================================== */
+static void c_power_set_idle(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc >= 2) {
+        mrbc_int_t dim_ms = GET_INT_ARG(1);
+        mrbc_int_t off_ms = GET_INT_ARG(2);
+        power_set_idle(dim_ms < 0 ? 0 : (uint32_t)dim_ms, off_ms < 0 ? 0 : (uint32_t)off_ms);
+    }
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Power.set_sleep(on)
+ * Allow light sleep between events (it stops the USB console)
+ * Returns: true if light sleep is allowed now (never without
+ *          CONFIG_PICORUBY_LIGHT_SLEEP)
+ * ============================================== */
+static void c_power_set_sleep(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bool on = argc >= 1 && mrbc_type(v[1]) != MRBC_TT_NIL && mrbc_type(v[1]) != MRBC_TT_FALSE;
+    SET_BOOL_RETURN(power_set_sleep(on));
+}
+
+/* ==============================================
+ * Method: Power.stats
+ * Returns: {sleeps:, sleep_ms:, input_wakes:, dims:, idle_ms:, level:,
+ *           dimmed:, sleep:}
+ *          (input_wakes = sleeps ended by the keyboard or trackball,
+ *           level = backlight shown when not dimmed)
+ * ============================================== */
+static void c_power_stats(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    power_stats_t st;
+    power_get_stats(&st);
+
+    mrbc_value hash = mrbc_hash_new(vm, 8);
+    hash_set_int(&hash, "sleeps", st.sleeps);
+    hash_set_int(&hash, "sleep_ms", st.sleep_ms);
+    hash_set_int(&hash, "input_wakes", st.input_wakes);
+    hash_set_int(&hash, "dims", st.dims);
+    hash_set_int(&hash, "idle_ms", st.idle_ms);
+    hash_set_int(&hash, "level", st.level);
+    hash_set_bool(&hash, "dimmed", st.dimmed);
+    hash_set_bool(&hash, "sleep", st.sleep);
+
+    SET_RETURN(hash);
+}
+
+/* ==============================================
+ * Initialize Power class
+ * ============================================== */
+void mrbc_power_init(mrbc_vm *vm)
+{
+    mrbc_class_Power = mrbc_define_class(vm, "Power", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Power, "wait", c_power_wait);
+    mrbc_define_method(vm, mrbc_class_Power, "set_idle", c_power_set_idle);
+    mrbc_define_method(vm, mrbc_class_Power, "set_sleep", c_power_set_sleep);
+    mrbc_define_method(vm, mrbc_class_Power, "stats", c_power_stats);
+}
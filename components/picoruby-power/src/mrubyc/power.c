@@ -0,0 +1,9 @@
+/*
+ * Power mrubyc initialization stub
+ * Actual implementation is in ports/esp32/power_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/power_native.c */
+extern void mrbc_power_init(mrbc_vm *vm);
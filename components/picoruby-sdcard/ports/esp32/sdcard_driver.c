@@ -1,4 +1,5 @@
 #include "sdcard_driver.h"
+#include "render_queue.h"
 #include <string.h>
 #include <stdlib.h>
 #include "esp_log.h"
@@ -15,6 +16,12 @@ static const char *TAG = "SDCard";
 
 // Calculate start sector for a given slot
 #define SLOT_SECTOR(slot) (SLOT_START_SECTOR + (slot) * SLOT_SIZE_SECTORS)
+#define MRB_SECTOR(slot) (MRB_START_SECTOR + (slot) * MRB_SIZE_SECTORS)
+
+// Card kept open by sdcard_session_open (closed when the last user closes)
+static sdmmc_card_t *session_card = NULL;
+static sdspi_dev_handle_t session_handle;
+static int session_refs = 0;
 
 // Set other SPI devices CS to HIGH before SD operation
 static void prepare_spi_for_sd(void)
@@ -23,16 +30,28 @@ static void prepare_spi_for_sd(void)
     gpio_set_level(RADIO_CS_PIN, 1);
 }
 
-// Initialize SD card for single operation, returns card handle
-static sdmmc_card_t* sdcard_begin(sdspi_dev_handle_t *out_handle)
+// Open the card; detach_tft takes the TFT CS pin away from the SPI
+// driver (the display must be resumed afterwards, see st7789_resume)
+static sdmmc_card_t* sdcard_open(sdspi_dev_handle_t *out_handle, bool detach_tft)
 {
     ESP_LOGI(TAG, "Opening SD card...");
 
+    // Let the render worker finish before the TFT CS pin is taken
+    if (detach_tft) {
+        render_fence();
+    }
+
     // Set CS pins as output and HIGH
-    gpio_set_direction(TFT_CS_PIN, GPIO_MODE_OUTPUT);
+    if (detach_tft) {
+        gpio_set_direction(TFT_CS_PIN, GPIO_MODE_OUTPUT);
+    }
     gpio_set_direction(RADIO_CS_PIN, GPIO_MODE_OUTPUT);
     gpio_set_direction(SDCARD_CS_PIN, GPIO_MODE_OUTPUT);
-    prepare_spi_for_sd();
+    if (detach_tft) {
+        prepare_spi_for_sd();
+    } else {
+        gpio_set_level(RADIO_CS_PIN, 1);
+    }
 
     // Allocate card structure
     sdmmc_card_t *card = (sdmmc_card_t *)malloc(sizeof(sdmmc_card_t));
@@ -73,8 +92,8 @@ static sdmmc_card_t* sdcard_begin(sdspi_dev_handle_t *out_handle)
     return card;
 }
 
-// Close SD card after operation
-static void sdcard_end(sdmmc_card_t *card, sdspi_dev_handle_t handle)
+// Close a card opened by sdcard_open
+static void sdcard_close(sdmmc_card_t *card, sdspi_dev_handle_t handle)
 {
     if (card != NULL) {
         free(card);
@@ -88,6 +107,25 @@ static void sdcard_end(sdmmc_card_t *card, sdspi_dev_handle_t handle)
     ESP_LOGI(TAG, "SD card closed");
 }
 
+// Initialize SD card for single operation, returns card handle
+static sdmmc_card_t* sdcard_begin(sdspi_dev_handle_t *out_handle)
+{
+    if (session_card != NULL) {
+        *out_handle = session_handle;
+        return session_card;
+    }
+    return sdcard_open(out_handle, true);
+}
+
+// Close SD card after operation (an open session stays open)
+static void sdcard_end(sdmmc_card_t *card, sdspi_dev_handle_t handle)
+{
+    if (card != NULL && card == session_card) {
+        return;
+    }
+    sdcard_close(card, handle);
+}
+
 bool sdcard_init(void)
 {
     // Just check if we can open the card
@@ -279,3 +317,186 @@ char* sdcard_read_slot(int slot, size_t *len)
     sdcard_end(card, handle);
     return content;
 }
+
+uint32_t sdcard_source_hash(const char *src, size_t len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)src[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool sdcard_write_slot_mrb(int slot, uint32_t hash, const uint8_t *mrb, size_t len)
+{
+    if (slot < 0 || slot >= MAX_SLOTS) {
+        ESP_LOGE(TAG, "Invalid slot number: %d (must be 0-%d)", slot, MAX_SLOTS - 1);
+        return false;
+    }
+    if (len > MAX_MRB_DATA_SIZE) {
+        ESP_LOGW(TAG, "Bytecode too large for slot %d: %zu bytes (max %d)", slot, len, MAX_MRB_DATA_SIZE);
+        return false;
+    }
+
+    sdspi_dev_handle_t handle;
+    sdmmc_card_t *card = sdcard_begin(&handle);
+    if (card == NULL) {
+        return false;
+    }
+
+    size_t sectors_needed = (len + 8 + 511) / 512;
+    uint8_t *buffer = (uint8_t *)heap_caps_malloc(sectors_needed * 512, MALLOC_CAP_DMA);
+    if (buffer == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate write buffer");
+        sdcard_end(card, handle);
+        return false;
+    }
+
+    memset(buffer, 0, sectors_needed * 512);
+
+    // Header: length, then source hash (little endian)
+    for (int i = 0; i < 4; i++) {
+        buffer[i] = (len >> (i * 8)) & 0xFF;
+        buffer[4 + i] = (hash >> (i * 8)) & 0xFF;
+    }
+    if (len > 0) {
+        memcpy(buffer + 8, mrb, len);
+    }
+
+    esp_err_t ret = sdmmc_write_sectors(card, buffer, MRB_SECTOR(slot), sectors_needed);
+    free(buffer);
+    sdcard_end(card, handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write bytecode for slot %d: %s", slot, esp_err_to_name(ret));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Wrote %zu bytes of bytecode for slot %d", len, slot);
+    return true;
+}
+
+uint8_t* sdcard_read_slot_mrb(int slot, uint32_t *hash, size_t *len)
+{
+    *len = 0;
+    *hash = 0;
+
+    if (slot < 0 || slot >= MAX_SLOTS) {
+        ESP_LOGE(TAG, "Invalid slot number: %d (must be 0-%d)", slot, MAX_SLOTS - 1);
+        return NULL;
+    }
+
+    sdspi_dev_handle_t handle;
+    sdmmc_card_t *card = sdcard_begin(&handle);
+    if (card == NULL) {
+        return NULL;
+    }
+
+    uint8_t *buffer = (uint8_t *)heap_caps_malloc(MRB_SIZE_SECTORS * 512, MALLOC_CAP_DMA);
+    if (buffer == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate read buffer");
+        sdcard_end(card, handle);
+        return NULL;
+    }
+
+    // Header sector first, the rest only when there is bytecode
+    esp_err_t ret = sdmmc_read_sectors(card, buffer, MRB_SECTOR(slot), 1);
+    size_t data_len = 0;
+    if (ret == ESP_OK) {
+        data_len = buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | (buffer[3] << 24);
+        if (data_len == 0 || data_len > MAX_MRB_DATA_SIZE) {
+            data_len = 0;
+        }
+    }
+
+    size_t sectors_needed = (data_len + 8 + 511) / 512;
+    if (data_len > 0 && sectors_needed > 1) {
+        ret = sdmmc_read_sectors(card, buffer + 512, MRB_SECTOR(slot) + 1, sectors_needed - 1);
+    }
+    sdcard_end(card, handle);
+
+    if (ret != ESP_OK || data_len == 0) {
+        free(buffer);
+        return NULL;
+    }
+
+    uint8_t *mrb = (uint8_t *)malloc(data_len);
+    if (mrb == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate bytecode buffer");
+        free(buffer);
+        return NULL;
+    }
+
+    memcpy(mrb, buffer + 8, data_len);
+    *hash = buffer[4] | (buffer[5] << 8) | (buffer[6] << 16) | ((uint32_t)buffer[7] << 24);
+    free(buffer);
+
+    *len = data_len;
+    ESP_LOGI(TAG, "Read %zu bytes of bytecode from slot %d", data_len, slot);
+    return mrb;
+}
+
+bool sdcard_session_open(void)
+{
+    if (session_card == NULL) {
+        session_card = sdcard_open(&session_handle, false);
+        if (session_card == NULL) {
+            return false;
+        }
+    }
+    session_refs++;
+    return true;
+}
+
+void sdcard_session_close(void)
+{
+    if (session_card == NULL || --session_refs > 0) {
+        return;
+    }
+    sdmmc_card_t *card = session_card;
+    session_card = NULL;
+    sdcard_close(card, session_handle);
+}
+
+bool sdcard_session_active(void)
+{
+    return session_card != NULL;
+}
+
+bool sdcard_read_sectors(uint32_t sector, void *buf, size_t count)
+{
+    bool one_shot = session_card == NULL;
+    if (one_shot && !sdcard_session_open()) {
+        return false;
+    }
+
+    esp_err_t ret = sdmmc_read_sectors(session_card, buf, sector, count);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read %zu sectors at %lu: %s", count, (unsigned long)sector, esp_err_to_name(ret));
+    }
+
+    if (one_shot) {
+        sdcard_session_close();
+    }
+    return ret == ESP_OK;
+}
+
+bool sdcard_write_sectors(uint32_t sector, const void *buf, size_t count)
+{
+    bool one_shot = session_card == NULL;
+    if (one_shot && !sdcard_session_open()) {
+        return false;
+    }
+
+    esp_err_t ret = sdmmc_write_sectors(session_card, buf, sector, count);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write %zu sectors at %lu: %s", count, (unsigned long)sector, esp_err_to_name(ret));
+    }
+
+    if (one_shot) {
+        sdcard_session_close();
+    }
+    return ret == ESP_OK;
+}
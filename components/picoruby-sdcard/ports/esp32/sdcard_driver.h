@@ -2,6 +2,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +46,40 @@ bool sdcard_write_slot(int slot, const char *data);
 // Sets *len to the number of bytes read
 char* sdcard_read_slot(int slot, size_t *len);
 
+// Compiled bytecode companions, one per slot, after the source slots
+#define MRB_START_SECTOR    (SLOT_START_SECTOR + MAX_SLOTS * SLOT_SIZE_SECTORS)
+#define MRB_SIZE_SECTORS    32      // 32 sectors = 16KB per slot
+#define MAX_MRB_DATA_SIZE   (MRB_SIZE_SECTORS * 512 - 8)  // Minus length + hash header
+
+// Hash used to key a slot's bytecode to the source it was compiled from
+uint32_t sdcard_source_hash(const char *src, size_t len);
+
+// Write RITE bytecode for a slot (0-7) tagged with the source hash
+// Returns true on success, false on failure
+bool sdcard_write_slot_mrb(int slot, uint32_t hash, const uint8_t *mrb, size_t len);
+
+// Read RITE bytecode of a slot (0-7)
+// Returns allocated buffer (caller must free) or NULL if missing
+// Sets *len to the bytecode size and *hash to the stored source hash
+uint8_t* sdcard_read_slot_mrb(int slot, uint32_t *hash, size_t *len);
+
+// First sector after the slot areas (used by the document store)
+#define SDCARD_FREE_START_SECTOR  (MRB_START_SECTOR + MAX_SLOTS * MRB_SIZE_SECTORS)
+
+// Raw session: keep the card initialized across many sector accesses
+// The TFT chip select is left to the SPI driver, so the display keeps
+// working while a session is open (no TFT.init needed afterwards)
+// Slot functions called during a session reuse the open card
+// Sessions nest: every successful open needs one close
+bool sdcard_session_open(void);
+void sdcard_session_close(void);
+bool sdcard_session_active(void);
+
+// Read / write whole sectors (buf should be DMA capable)
+// Opens a one-shot session when none is active
+bool sdcard_read_sectors(uint32_t sector, void *buf, size_t count);
+bool sdcard_write_sectors(uint32_t sector, const void *buf, size_t count);
+
 #ifdef __cplusplus
 }
 #endif
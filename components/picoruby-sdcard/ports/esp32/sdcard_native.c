@@ -3,8 +3,13 @@
  */
 
 #include "sdcard_driver.h"
+#include "event_queue.h"
 #include <mrubyc.h>
 #include <stdlib.h>
+#include "mrc_common.h"
+#include "mrc_ccontext.h"
+#include "mrc_compile.h"
+#include "mrc_dump.h"
 
 // mrubyc class pointer
 mrbc_class *mrbc_class_SDCard = NULL;
@@ -64,6 +69,7 @@ static void c_sdcard_save(mrbc_vm *vm, mrbc_value *v, int argc)
     }
 
     bool success = sdcard_write_slot(slot, code);
+    event_post(EVENT_SD);
 
     if (success) {
         SET_TRUE_RETURN();
@@ -95,6 +101,7 @@ static void c_sdcard_load(mrbc_vm *vm, mrbc_value *v, int argc)
 
     size_t len = 0;
     char *content = sdcard_read_slot(slot, &len);
+    event_post(EVENT_SD);
 
     if (content == NULL || len == 0) {
         SET_NIL_RETURN();
@@ -110,6 +117,100 @@ static void c_sdcard_load(mrbc_vm *vm, mrbc_value *v, int argc)
     SET_RETURN(str);
 }
 
+/* ==============================================
+ * Method: SDCard.source_hash(source)
+ * Hash that keys a slot's bytecode to its source
+ * Returns: Integer
+ * ============================================== */
+static void c_sdcard_source_hash(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_STRING) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    uint32_t hash = sdcard_source_hash((const char *)GET_STRING_ARG(1), mrbc_string_size(&v[1]));
+    SET_INT_RETURN((mrbc_int_t)(int32_t)hash);
+}
+
+/* ==============================================
+ * Method: SDCard.save_mrb(slot, source)
+ * Compile source to RITE bytecode and store it next to the slot,
+ * tagged with SDCard.source_hash(source)
+ * Returns: true on success, false on syntax error or failure
+ * ============================================== */
+static void c_sdcard_save_mrb(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 2 || mrbc_type(v[1]) != MRBC_TT_INTEGER || mrbc_type(v[2]) != MRBC_TT_STRING) {
+        SET_FALSE_RETURN();
+        return;
+    }
+
+    int slot = GET_INT_ARG(1);
+    const char *source = (const char *)GET_STRING_ARG(2);
+    size_t source_len = mrbc_string_size(&v[2]);
+    uint32_t hash = sdcard_source_hash(source, source_len);
+
+    // Same compiler the Sandbox uses, the image loads with exec_mrb
+    mrc_ccontext *cc = mrc_ccontext_new(NULL);
+    const uint8_t *script = (const uint8_t *)source;
+    mrc_irep *irep = mrc_load_string_cxt(cc, &script, source_len);
+
+    uint8_t *mrb = NULL;
+    size_t mrb_len = 0;
+    bool compiled = irep != NULL && mrc_dump_irep(cc, irep, 0, &mrb, &mrb_len) == MRC_DUMP_OK;
+    if (irep != NULL) {
+        mrc_irep_free(cc, irep);
+    }
+
+    // A zero-length record drops a stale image on syntax error
+    bool success = sdcard_write_slot_mrb(slot, hash, compiled ? mrb : NULL, compiled ? mrb_len : 0);
+    event_post(EVENT_SD);
+
+    if (mrb != NULL) {
+        mrc_free(cc, mrb);
+    }
+    mrc_ccontext_free(cc);
+
+    if (success && compiled) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: SDCard.load_mrb(slot)
+ * Load the bytecode stored by SDCard.save_mrb
+ * Returns: [source_hash, bytecode_string] or nil if none
+ * ============================================== */
+static void c_sdcard_load_mrb(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_INTEGER) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    uint32_t hash = 0;
+    size_t len = 0;
+    uint8_t *mrb = sdcard_read_slot_mrb(GET_INT_ARG(1), &hash, &len);
+    event_post(EVENT_SD);
+
+    if (mrb == NULL) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    mrbc_value ary = mrbc_array_new(vm, 2);
+    mrbc_value h = mrbc_integer_value((mrbc_int_t)(int32_t)hash);
+    mrbc_value str = mrbc_string_new(vm, mrb, len);
+    mrbc_array_push(&ary, &h);
+    mrbc_array_push(&ary, &str);
+    free(mrb);
+
+    SET_RETURN(ary);
+}
+
 /* ==============================================
  * Method: SDCard.mounted?
  * Check if SD card is mounted
@@ -135,4 +236,7 @@ void mrbc_sdcard_init(mrbc_vm *vm)
     mrbc_define_method(vm, mrbc_class_SDCard, "save", c_sdcard_save);
     mrbc_define_method(vm, mrbc_class_SDCard, "load", c_sdcard_load);
     mrbc_define_method(vm, mrbc_class_SDCard, "mounted?", c_sdcard_mounted);
+    mrbc_define_method(vm, mrbc_class_SDCard, "source_hash", c_sdcard_source_hash);
+    mrbc_define_method(vm, mrbc_class_SDCard, "save_mrb", c_sdcard_save_mrb);
+    mrbc_define_method(vm, mrbc_class_SDCard, "load_mrb", c_sdcard_load_mrb);
 }
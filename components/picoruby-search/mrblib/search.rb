@@ -0,0 +1,3 @@
+# Search class - implemented in C
+class Search
+end
@@ -0,0 +1,570 @@
+#include "search_engine.h"
+#include "sdcard_driver.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char *TAG = "Search";
+
+#define SLOT_SECTOR(slot) (SLOT_START_SECTOR + (slot) * SLOT_SIZE_SECTORS)
+
+// Literal pattern (Boyer-Moore-Horspool)
+static char pat[SEARCH_PATTERN_MAX];
+static size_t pat_len = 0;
+static uint8_t skip[256];
+
+// Regex: a sequence of character sets, each with a quantifier
+typedef struct {
+    uint8_t set[32];  // bitmap of matching bytes
+    char quant;       // 0, '*', '+' or '?'
+} re_atom_t;
+
+static re_atom_t atoms[SEARCH_PATTERN_MAX];
+static int atom_count = 0;
+static int quant_count = 0;     // atoms with * + or ?
+static bool anchor_start = false;
+static bool anchor_end = false;
+static bool use_regex = false;
+
+// (atom, position) pairs that failed to match in the current search_match
+// call: with several quantifiers the backtracking would otherwise grow
+// exponentially with the line length
+static uint8_t *memo = NULL;
+static size_t memo_cap = 0;     // bytes
+static size_t memo_stride = 0;  // bits per atom (line length + 1)
+static bool memo_on = false;
+
+static void set_add(uint8_t *set, uint8_t c)
+{
+    set[c >> 3] |= 1 << (c & 7);
+}
+
+static bool set_has(const uint8_t *set, uint8_t c)
+{
+    return (set[c >> 3] >> (c & 7)) & 1;
+}
+
+static void set_add_range(uint8_t *set, uint8_t from, uint8_t to)
+{
+    for (int c = from; c <= to; c++) {
+        set_add(set, (uint8_t)c);
+    }
+}
+
+// \d \w \s or an escaped literal
+static void set_add_escape(uint8_t *set, char c)
+{
+    switch (c) {
+    case 'd':
+        set_add_range(set, '0', '9');
+        break;
+    case 'w':
+        set_add_range(set, 'a', 'z');
+        set_add_range(set, 'A', 'Z');
+        set_add_range(set, '0', '9');
+        set_add(set, '_');
+        break;
+    case 's':
+        set_add(set, ' ');
+        set_add(set, '\t');
+        set_add(set, '\r');
+        break;
+    case 't':
+        set_add(set, '\t');
+        break;
+    default:
+        set_add(set, (uint8_t)c);
+        break;
+    }
+}
+
+static bool compile_regex(const char *p, size_t len)
+{
+    size_t i = 0;
+    atom_count = 0;
+    quant_count = 0;
+    anchor_start = len > 0 && p[0] == '^';
+    anchor_end = len > 0 && p[len - 1] == '$' && (len < 2 || p[len - 2] != '\\');
+    if (anchor_start) i++;
+    if (anchor_end) len--;
+
+    while (i < len) {
+        if (atom_count == SEARCH_PATTERN_MAX) {
+            return false;
+        }
+        re_atom_t *a = &atoms[atom_count];
+        memset(a, 0, sizeof(*a));
+        char c = p[i++];
+
+        if (c == '.') {
+            memset(a->set, 0xFF, sizeof(a->set));
+        } else if (c == '\\') {
+            if (i == len) return false;
+            set_add_escape(a->set, p[i++]);
+        } else if (c == '[') {
+            bool negate = i < len && p[i] == '^';
+            if (negate) i++;
+            bool first = true;
+            while (i < len && (p[i] != ']' || first)) {
+                first = false;
+                uint8_t from = (uint8_t)p[i++];
+                if (from == '\\' && i < len) {
+                    set_add_escape(a->set, p[i++]);
+                    continue;
+                }
+                if (i + 1 < len && p[i] == '-' && p[i + 1] != ']') {
+                    set_add_range(a->set, from, (uint8_t)p[i + 1]);
+                    i += 2;
+                } else {
+                    set_add(a->set, from);
+                }
+            }
+            if (i == len) return false;  // no closing ]
+            i++;
+            if (negate) {
+                for (int k = 0; k < 32; k++) {
+                    a->set[k] = ~a->set[k];
+                }
+            }
+        } else if (c == '*' || c == '+' || c == '?') {
+            return false;  // nothing to repeat
+        } else {
+            set_add(a->set, (uint8_t)c);
+        }
+
+        if (i < len && (p[i] == '*' || p[i] == '+' || p[i] == '?')) {
+            a->quant = p[i++];
+            quant_count++;
+        }
+        atom_count++;
+    }
+    return true;
+}
+
+bool search_compile(const char *pattern, size_t len, bool regex)
+{
+    pat_len = 0;
+    atom_count = 0;
+    use_regex = regex;
+
+    if (len == 0 || len > SEARCH_PATTERN_MAX) {
+        return false;
+    }
+
+    if (regex) {
+        return compile_regex(pattern, len);
+    }
+
+    memcpy(pat, pattern, len);
+    pat_len = len;
+    for (int c = 0; c < 256; c++) {
+        skip[c] = (uint8_t)len;
+    }
+    for (size_t k = 0; k + 1 < len; k++) {
+        skip[(uint8_t)pat[k]] = (uint8_t)(len - 1 - k);
+    }
+    return true;
+}
+
+// Clear the memo for a line of len bytes (only needed with two or more
+// quantifiers, one backtracks in linear time)
+static bool memo_begin(size_t len)
+{
+    memo_on = false;
+    if (quant_count < 2) {
+        return true;
+    }
+
+    size_t bytes = ((size_t)atom_count * (len + 1) + 7) / 8;
+    if (bytes > memo_cap) {
+        uint8_t *p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (p == NULL) {
+            p = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }
+        if (p == NULL) {
+            ESP_LOGE(TAG, "No memory to match a %u byte line", (unsigned)len);
+            return false;
+        }
+        heap_caps_free(memo);
+        memo = p;
+        memo_cap = bytes;
+    }
+    memset(memo, 0, bytes);
+    memo_stride = len + 1;
+    memo_on = true;
+    return true;
+}
+
+static int match_here(int i, const uint8_t *t, size_t pos, size_t len);
+
+// End of the match of atoms[i..] at pos, or -1 (greedy, backtracking)
+static int match_atom(int i, const uint8_t *t, size_t pos, size_t len)
+{
+    const re_atom_t *a = &atoms[i];
+    if (a->quant == 0) {
+        if (pos < len && set_has(a->set, t[pos])) {
+            return match_here(i + 1, t, pos + 1, len);
+        }
+        return -1;
+    }
+
+    size_t max = a->quant == '?' ? 1 : len - pos;
+    size_t min = a->quant == '+' ? 1 : 0;
+    size_t n = 0;
+    while (n < max && pos + n < len && set_has(a->set, t[pos + n])) {
+        n++;
+    }
+    for (;;) {
+        if (n < min) {
+            return -1;
+        }
+        int end = match_here(i + 1, t, pos + n, len);
+        if (end >= 0) {
+            return end;
+        }
+        if (n == 0) {
+            return -1;
+        }
+        n--;
+    }
+}
+
+static int match_here(int i, const uint8_t *t, size_t pos, size_t len)
+{
+    if (i == atom_count) {
+        return (!anchor_end || pos == len) ? (int)pos : -1;
+    }
+
+    size_t bit = (size_t)i * memo_stride + pos;
+    if (memo_on && ((memo[bit >> 3] >> (bit & 7)) & 1)) {
+        return -1;
+    }
+    int end = match_atom(i, t, pos, len);
+    if (end < 0 && memo_on) {
+        memo[bit >> 3] |= 1 << (bit & 7);
+    }
+    return end;
+}
+
+int search_match(const char *text, size_t len, size_t from, size_t *mlen)
+{
+    const uint8_t *t = (const uint8_t *)text;
+
+    if (use_regex) {
+        if (atom_count == 0 && !anchor_start && !anchor_end) {
+            return -1;
+        }
+        // Callers resume after a hit with from > 0: ^ only matches at 0
+        if (anchor_start && from > 0) {
+            return -1;
+        }
+        if (!memo_begin(len)) {
+            return -1;
+        }
+        for (size_t start = from; start <= len; start++) {
+            int end = match_here(0, t, start, len);
+            if (end >= 0) {
+                *mlen = end - start;
+                return (int)start;
+            }
+            if (anchor_start) {
+                break;
+            }
+        }
+        return -1;
+    }
+
+    if (pat_len == 0) {
+        return -1;
+    }
+
+    size_t last = pat_len - 1;
+    size_t i = from;
+    while (i + pat_len <= len) {
+        uint8_t c = t[i + last];
+        if (c == (uint8_t)pat[last] && memcmp(t + i, pat, last) == 0) {
+            *mlen = pat_len;
+            return (int)i;
+        }
+        i += skip[c];
+    }
+    return -1;
+}
+
+// Slot streaming state
+static struct {
+    bool active;
+    int slot;              // slot being read, MAX_SLOTS when done
+    uint32_t sector;       // next sector in the slot
+    uint32_t remaining;    // data bytes of the slot not read yet
+    uint32_t line;
+    char buf[SEARCH_LINE_MAX];
+    size_t buf_len;
+    bool line_ready;       // buf holds a whole line
+    size_t resume;         // match offset to continue from in buf
+    uint8_t *sector_buf;
+    size_t sec_pos;
+    size_t sec_len;
+} st;
+
+bool search_slots_begin(void)
+{
+    search_slots_end();
+
+    st.sector_buf = heap_caps_malloc(512, MALLOC_CAP_DMA);
+    if (st.sector_buf == NULL) {
+        return false;
+    }
+    if (!sdcard_session_open()) {
+        free(st.sector_buf);
+        st.sector_buf = NULL;
+        return false;
+    }
+
+    st.active = true;
+    st.slot = -1;
+    st.remaining = 0;
+    st.buf_len = 0;
+    st.line_ready = false;
+    st.resume = 0;
+    st.sec_pos = 0;
+    st.sec_len = 0;
+    return true;
+}
+
+void search_slots_end(void)
+{
+    if (!st.active) {
+        return;
+    }
+    st.active = false;
+    free(st.sector_buf);
+    st.sector_buf = NULL;
+    sdcard_session_close();
+}
+
+// Move to the next slot and read its header sector
+static bool next_slot(void)
+{
+    st.slot++;
+    st.line = 0;
+    st.remaining = 0;
+    st.sec_pos = 0;
+    st.sec_len = 0;
+    if (st.slot >= MAX_SLOTS) {
+        return false;
+    }
+
+    if (!sdcard_read_sectors(SLOT_SECTOR(st.slot), st.sector_buf, 1)) {
+        return true;  // unreadable slot: skip it
+    }
+
+    uint8_t *h = st.sector_buf;
+    uint32_t data_len = h[0] | (h[1] << 8) | (h[2] << 16) | ((uint32_t)h[3] << 24);
+    if (data_len == 0 || data_len > MAX_SLOT_DATA_SIZE) {
+        return true;  // empty slot
+    }
+
+    st.sector = 1;
+    st.sec_pos = 4;
+    st.sec_len = data_len + 4 < 512 ? data_len + 4 : 512;
+    st.remaining = data_len - (st.sec_len - 4);
+    return true;
+}
+
+int search_slots_step(int max_sectors, search_hit_t *hits, int max_hits)
+{
+    if (!st.active) {
+        return -1;
+    }
+
+    int count = 0;
+    int sectors = 0;
+
+    for (;;) {
+        if (st.line_ready) {
+            size_t len = st.buf_len;
+            if (len > 0 && st.buf[len - 1] == '\r') {
+                len--;
+            }
+
+            size_t mlen;
+            int at;
+            while (st.resume <= len && (at = search_match(st.buf, len, st.resume, &mlen)) >= 0) {
+                if (count == max_hits) {
+                    st.resume = at;
+                    return count;
+                }
+                search_hit_t *hit = &hits[count++];
+                hit->slot = st.slot;
+                hit->line = st.line;
+                hit->col = (uint16_t)at;
+                hit->len = (uint16_t)mlen;
+                hit->text_len = (uint16_t)len;
+                memcpy(hit->text, st.buf, len);
+                st.resume = at + (mlen > 0 ? mlen : 1);
+            }
+
+            st.line_ready = false;
+            st.buf_len = 0;
+            st.resume = 0;
+            st.line++;
+        }
+
+        // Collect the next line from the sector buffer
+        if (st.sec_pos < st.sec_len) {
+            while (st.sec_pos < st.sec_len) {
+                char c = (char)st.sector_buf[st.sec_pos++];
+                if (c == '\n') {
+                    st.line_ready = true;
+                    break;
+                }
+                if (st.buf_len < SEARCH_LINE_MAX) {
+                    st.buf[st.buf_len++] = c;
+                }
+            }
+            continue;
+        }
+
+        if (st.remaining == 0) {
+            // Last line of the slot has no newline
+            if (st.buf_len > 0) {
+                st.line_ready = true;
+                continue;
+            }
+            if (sectors == max_sectors) {
+                return count;
+            }
+            sectors++;
+            if (!next_slot()) {
+                search_slots_end();
+                return count > 0 ? count : -1;
+            }
+            continue;
+        }
+
+        if (sectors == max_sectors) {
+            return count;
+        }
+        sectors++;
+        if (!sdcard_read_sectors(SLOT_SECTOR(st.slot) + st.sector, st.sector_buf, 1)) {
+            ESP_LOGW(TAG, "Skipping rest of slot %d", st.slot);
+            st.remaining = 0;
+            continue;
+        }
+        st.sector++;
+        st.sec_pos = 0;
+        st.sec_len = st.remaining < 512 ? st.remaining : 512;
+        st.remaining -= st.sec_len;
+    }
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} out_buf_t;
+
+static bool out_put(out_buf_t *o, const char *s, size_t n)
+{
+    if (o->len + n + 1 > o->cap) {
+        size_t cap = o->cap ? o->cap : 64;
+        while (o->len + n + 1 > cap) {
+            cap *= 2;
+        }
+        char *p = realloc(o->data, cap);
+        if (p == NULL) {
+            return false;
+        }
+        o->data = p;
+        o->cap = cap;
+    }
+    memcpy(o->data + o->len, s, n);
+    o->len += n;
+    o->data[o->len] = '\0';
+    return true;
+}
+
+char *search_replace(const char *text, size_t len, const char *rep, size_t rep_len,
+                     size_t *out_len, int *count)
+{
+    out_buf_t o = { NULL, 0, 0 };
+    bool ok = out_put(&o, "", 0);
+    *count = 0;
+
+    // Match line by line so ^ $ and . behave as in the search
+    size_t line = 0;
+    while (ok && line <= len) {
+        const char *nl = memchr(text + line, '\n', len - line);
+        size_t end = nl ? (size_t)(nl - text) : len;
+
+        size_t pos = 0;
+        size_t line_len = end - line;
+        size_t mlen;
+        int at;
+        while (ok && pos <= line_len && (at = search_match(text + line, line_len, pos, &mlen)) >= 0) {
+            ok = out_put(&o, text + line + pos, at - pos) && out_put(&o, rep, rep_len);
+            (*count)++;
+            pos = at + mlen;
+            if (mlen == 0) {
+                // Empty match: keep the next byte and move on
+                if (pos < line_len) {
+                    ok = ok && out_put(&o, text + line + pos, 1);
+                }
+                pos++;
+            }
+        }
+        if (ok && pos < line_len) {
+            ok = out_put(&o, text + line + pos, line_len - pos);
+        }
+        if (ok && nl != NULL) {
+            ok = out_put(&o, "\n", 1);
+        }
+        if (nl == NULL) {
+            break;
+        }
+        line = end + 1;
+    }
+
+    if (!ok) {
+        free(o.data);
+        return NULL;
+    }
+    *out_len = o.len;
+    return o.data;
+}
+
+int search_replace_slot(int slot, const char *rep, size_t rep_len)
+{
+    // Keep the display attached while the slot is rewritten
+    if (!sdcard_session_open()) {
+        return -1;
+    }
+
+    size_t len;
+    char *data = sdcard_read_slot(slot, &len);
+    if (data == NULL) {
+        sdcard_session_close();
+        return 0;  // empty slot
+    }
+
+    size_t out_len;
+    int count;
+    char *out = search_replace(data, len, rep, rep_len, &out_len, &count);
+    free(data);
+
+    int result = count;
+    if (out == NULL) {
+        result = -1;
+    } else if (count > 0) {
+        if (out_len > MAX_SLOT_DATA_SIZE || !sdcard_write_slot(slot, out)) {
+            ESP_LOGE(TAG, "Failed to write slot %d after replace", slot);
+            result = -1;
+        }
+    }
+
+    free(out);
+    sdcard_session_close();
+    return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Longest pattern (bytes, or regex atoms)
+#define SEARCH_PATTERN_MAX   64
+
+// Lines are matched one at a time; longer lines are cut here
+#define SEARCH_LINE_MAX      256
+
+// Set the pattern for the following calls
+// Literal patterns use Boyer-Moore-Horspool; regex supports
+// . [] [^] * + ? ^ $ and \d \w \s (plus \ to escape)
+// Returns false for an empty or invalid pattern
+bool search_compile(const char *pattern, size_t len, bool regex);
+
+// First match in text at or after from
+// Returns the match offset and sets *mlen, or -1 if there is none
+int search_match(const char *text, size_t len, size_t from, size_t *mlen);
+
+typedef struct {
+    int slot;
+    uint32_t line;                 // 0-based line in the slot
+    uint16_t col;
+    uint16_t len;                  // match length
+    uint16_t text_len;
+    char text[SEARCH_LINE_MAX];    // the matching line
+} search_hit_t;
+
+// Stream all SD slots sector by sector (one sector buffer, one line buffer)
+bool search_slots_begin(void);
+
+// Read up to max_sectors more sectors and return their hits
+// Returns the number of hits stored, or -1 when every slot is done
+// Lines with more hits than fit are finished on the next call
+int search_slots_step(int max_sectors, search_hit_t *hits, int max_hits);
+
+void search_slots_end(void);
+
+// Replace every match in text
+// Returns a malloc'd string (caller frees) and the count, or NULL on error
+char *search_replace(const char *text, size_t len, const char *rep, size_t rep_len,
+                     size_t *out_len, int *count);
+
+// Replace every match in a slot and write it back
+// Returns the number of replacements, or -1 on error
+int search_replace_slot(int slot, const char *rep, size_t rep_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,215 @@
+/*
+ * Search Native mrubyc bindings
+ */
+
+#include "search_engine.h"
+#include <stdlib.h>
+#include <string.h>
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Search = NULL;
+
+// Hits returned by one Search.scan / Search.step call
+#define SEARCH_SCAN_MAX_HITS  256
+#define SEARCH_STEP_MAX_HITS  8
+
+static search_hit_t step_hits[SEARCH_STEP_MAX_HITS];
+
+/* ==============================================
+ * Method: Search.start(pattern, regex = false)
+ * Set the pattern for scan / step / replace
+ * Returns: false if the pattern is empty or invalid
+ * ============================================== */
+static void c_search_start(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_STRING) {
+        SET_FALSE_RETURN();
+        return;
+    }
+
+    bool regex = argc >= 2 && mrbc_type(v[2]) == MRBC_TT_TRUE;
+    if (search_compile((const char *)GET_STRING_ARG(1), mrbc_string_size(&v[1]), regex)) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Search.scan(text)
+ * Find matches in an in-memory text, line by line
+ * Returns: [[line, col, len], ...] (at most 256)
+ * ============================================== */
+static void c_search_scan(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    mrbc_value ary = mrbc_array_new(vm, 0);
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_STRING) {
+        SET_RETURN(ary);
+        return;
+    }
+
+    const char *text = (const char *)GET_STRING_ARG(1);
+    size_t len = mrbc_string_size(&v[1]);
+    int hits = 0;
+    uint32_t line = 0;
+    size_t start = 0;
+
+    while (start <= len && hits < SEARCH_SCAN_MAX_HITS) {
+        const char *nl = memchr(text + start, '\n', len - start);
+        size_t line_len = (nl ? (size_t)(nl - text) : len) - start;
+
+        size_t pos = 0;
+        size_t mlen;
+        int at;
+        while (hits < SEARCH_SCAN_MAX_HITS && pos <= line_len &&
+               (at = search_match(text + start, line_len, pos, &mlen)) >= 0) {
+            mrbc_value hit = mrbc_array_new(vm, 3);
+            mrbc_value n = mrbc_integer_value(line);
+            mrbc_array_push(&hit, &n);
+            n = mrbc_integer_value(at);
+            mrbc_array_push(&hit, &n);
+            n = mrbc_integer_value(mlen);
+            mrbc_array_push(&hit, &n);
+            mrbc_array_push(&ary, &hit);
+            hits++;
+            pos = at + (mlen > 0 ? mlen : 1);
+        }
+
+        if (nl == NULL) {
+            break;
+        }
+        start += line_len + 1;
+        line++;
+    }
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Method: Search.slots
+ * Start streaming the SD slots (results come from Search.step)
+ * Returns: true on success
+ * ============================================== */
+static void c_search_slots(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (search_slots_begin()) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Search.step(max_sectors = 4)
+ * Read a few more slot sectors
+ * Returns: [[slot, line, col, text], ...] (may be empty),
+ *          or nil when every slot has been searched
+ * ============================================== */
+static void c_search_step(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int max_sectors = 4;
+    if (argc >= 1 && mrbc_type(v[1]) == MRBC_TT_INTEGER && GET_INT_ARG(1) > 0) {
+        max_sectors = GET_INT_ARG(1);
+    }
+
+    int n = search_slots_step(max_sectors, step_hits, SEARCH_STEP_MAX_HITS);
+    if (n < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    mrbc_value ary = mrbc_array_new(vm, n);
+    for (int i = 0; i < n; i++) {
+        search_hit_t *h = &step_hits[i];
+        mrbc_value hit = mrbc_array_new(vm, 4);
+        mrbc_value val = mrbc_integer_value(h->slot);
+        mrbc_array_push(&hit, &val);
+        val = mrbc_integer_value(h->line);
+        mrbc_array_push(&hit, &val);
+        val = mrbc_integer_value(h->col);
+        mrbc_array_push(&hit, &val);
+        val = mrbc_string_new(vm, h->text, h->text_len);
+        mrbc_array_push(&hit, &val);
+        mrbc_array_push(&ary, &hit);
+    }
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Method: Search.stop
+ * Stop streaming the SD slots
+ * ============================================== */
+static void c_search_stop(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    search_slots_end();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Search.replace(text, replacement)
+ * Returns: [new_text, count] or nil on error
+ * ============================================== */
+static void c_search_replace(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 2 || mrbc_type(v[1]) != MRBC_TT_STRING || mrbc_type(v[2]) != MRBC_TT_STRING) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    size_t out_len;
+    int count;
+    char *out = search_replace((const char *)GET_STRING_ARG(1), mrbc_string_size(&v[1]),
+                               (const char *)GET_STRING_ARG(2), mrbc_string_size(&v[2]),
+                               &out_len, &count);
+    if (out == NULL) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    mrbc_value ary = mrbc_array_new(vm, 2);
+    mrbc_value str = mrbc_string_new(vm, out, out_len);
+    mrbc_value n = mrbc_integer_value(count);
+    mrbc_array_push(&ary, &str);
+    mrbc_array_push(&ary, &n);
+    free(out);
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Method: Search.replace_slot(slot, replacement)
+ * Replace in a saved slot without loading it into the VM
+ * Returns: number of replacements, or nil on error
+ * ============================================== */
+static void c_search_replace_slot(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 2 || mrbc_type(v[1]) != MRBC_TT_INTEGER || mrbc_type(v[2]) != MRBC_TT_STRING) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    int count = search_replace_slot(GET_INT_ARG(1), (const char *)GET_STRING_ARG(2), mrbc_string_size(&v[2]));
+    if (count < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+    SET_INT_RETURN(count);
+}
+
+/* ==============================================
+ * Initialize Search class
+ * ============================================== */
+void mrbc_search_init(mrbc_vm *vm)
+{
+    mrbc_class_Search = mrbc_define_class(vm, "Search", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Search, "start", c_search_start);
+    mrbc_define_method(vm, mrbc_class_Search, "scan", c_search_scan);
+    mrbc_define_method(vm, mrbc_class_Search, "slots", c_search_slots);
+    mrbc_define_method(vm, mrbc_class_Search, "step", c_search_step);
+    mrbc_define_method(vm, mrbc_class_Search, "stop", c_search_stop);
+    mrbc_define_method(vm, mrbc_class_Search, "replace", c_search_replace);
+    mrbc_define_method(vm, mrbc_class_Search, "replace_slot", c_search_replace_slot);
+}
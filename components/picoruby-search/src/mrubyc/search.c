@@ -0,0 +1,9 @@
+/*
+ * Search mrubyc initialization stub
+ * Actual implementation is in ports/esp32/search_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/search_native.c */
+extern void mrbc_search_init(mrbc_vm *vm);
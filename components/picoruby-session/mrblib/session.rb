@@ -0,0 +1,3 @@
+# Session class - implemented in C
+class Session
+end
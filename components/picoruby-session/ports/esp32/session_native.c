@@ -0,0 +1,356 @@
+/*
+ * Session Native mrubyc bindings
+ */
+
+#include "session_store.h"
+#include <string.h>
+#include "esp_heap_caps.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Session = NULL;
+
+// Payload layout, little endian:
+//   u8 version
+//   u16 count, then per string:  u16 len, bytes
+//   u16 count, then per integer: i32 (SESSION_NIL = nil)
+//   u16 count, then per line:    u8 indent, u16 len, bytes
+//   u16 count, then per word:    u8 len, bytes
+#define SESSION_VERSION   1
+#define SESSION_NIL       INT32_MIN
+
+// Counts the bytes when buf is NULL
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+} writer_t;
+
+typedef struct {
+    const uint8_t *p;
+    size_t left;
+    bool bad;
+} reader_t;
+
+static void put_bytes(writer_t *w, const void *src, size_t len)
+{
+    if (w->buf != NULL) {
+        memcpy(w->buf + w->len, src, len);
+    }
+    w->len += len;
+}
+
+static void put_u8(writer_t *w, uint8_t n)
+{
+    put_bytes(w, &n, 1);
+}
+
+static void put_u16(writer_t *w, uint16_t n)
+{
+    uint8_t b[2] = { n & 0xFF, n >> 8 };
+    put_bytes(w, b, 2);
+}
+
+static void put_i32(writer_t *w, int32_t n)
+{
+    uint32_t u = (uint32_t)n;
+    uint8_t b[4] = { u & 0xFF, (u >> 8) & 0xFF, (u >> 16) & 0xFF, u >> 24 };
+    put_bytes(w, b, 4);
+}
+
+static const uint8_t *get_bytes(reader_t *r, size_t len)
+{
+    if (r->bad || r->left < len) {
+        r->bad = true;
+        return NULL;
+    }
+    const uint8_t *p = r->p;
+    r->p += len;
+    r->left -= len;
+    return p;
+}
+
+static uint8_t get_u8(reader_t *r)
+{
+    const uint8_t *p = get_bytes(r, 1);
+    return p != NULL ? p[0] : 0;
+}
+
+static uint16_t get_u16(reader_t *r)
+{
+    const uint8_t *p = get_bytes(r, 2);
+    return p != NULL ? p[0] | p[1] << 8 : 0;
+}
+
+static int32_t get_i32(reader_t *r)
+{
+    const uint8_t *p = get_bytes(r, 4);
+    return p != NULL ? (int32_t)(p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24) : 0;
+}
+
+static bool is_string(mrbc_value val, size_t max)
+{
+    return mrbc_type(val) == MRBC_TT_STRING && mrbc_string_size(&val) <= max;
+}
+
+// {text:, indent:} entry of a code_lines style array
+static bool line_at(const mrbc_value *ary, int i, int *indent, mrbc_value *text)
+{
+    mrbc_value line = mrbc_array_get(ary, i);
+    if (mrbc_type(line) != MRBC_TT_HASH) {
+        return false;
+    }
+
+    mrbc_value key = mrbc_symbol_value(mrbc_str_to_symid("text"));
+    *text = mrbc_hash_get(&line, &key);
+    key = mrbc_symbol_value(mrbc_str_to_symid("indent"));
+    mrbc_value ind = mrbc_hash_get(&line, &key);
+
+    *indent = mrbc_type(ind) == MRBC_TT_INTEGER ? (int)ind.i : 0;
+    return is_string(*text, UINT16_MAX) && *indent >= 0 && *indent <= UINT8_MAX;
+}
+
+// Returns false if an argument does not fit the layout
+static bool encode(writer_t *w, mrbc_value *lines, mrbc_value *strings, mrbc_value *ints,
+                   mrbc_value *words)
+{
+    put_u8(w, SESSION_VERSION);
+
+    put_u16(w, mrbc_array_size(strings));
+    for (int i = 0; i < mrbc_array_size(strings); i++) {
+        mrbc_value s = mrbc_array_get(strings, i);
+        if (!is_string(s, UINT16_MAX)) {
+            return false;
+        }
+        put_u16(w, mrbc_string_size(&s));
+        put_bytes(w, mrbc_string_cstr(&s), mrbc_string_size(&s));
+    }
+
+    put_u16(w, mrbc_array_size(ints));
+    for (int i = 0; i < mrbc_array_size(ints); i++) {
+        mrbc_value n = mrbc_array_get(ints, i);
+        if (mrbc_type(n) == MRBC_TT_NIL) {
+            put_i32(w, SESSION_NIL);
+        } else if (mrbc_type(n) == MRBC_TT_INTEGER && n.i > SESSION_NIL && n.i <= INT32_MAX) {
+            put_i32(w, (int32_t)n.i);
+        } else {
+            return false;
+        }
+    }
+
+    put_u16(w, mrbc_array_size(lines));
+    for (int i = 0; i < mrbc_array_size(lines); i++) {
+        int indent;
+        mrbc_value text;
+        if (!line_at(lines, i, &indent, &text)) {
+            return false;
+        }
+        put_u8(w, indent);
+        put_u16(w, mrbc_string_size(&text));
+        put_bytes(w, mrbc_string_cstr(&text), mrbc_string_size(&text));
+    }
+
+    // Words that do not fit a u8 length are left out of the dictionary
+    int count = 0;
+    for (int i = 0; i < mrbc_array_size(words); i++) {
+        count += is_string(mrbc_array_get(words, i), UINT8_MAX);
+    }
+    put_u16(w, count);
+    for (int i = 0; i < mrbc_array_size(words); i++) {
+        mrbc_value s = mrbc_array_get(words, i);
+        if (is_string(s, UINT8_MAX)) {
+            put_u8(w, mrbc_string_size(&s));
+            put_bytes(w, mrbc_string_cstr(&s), mrbc_string_size(&s));
+        }
+    }
+    return true;
+}
+
+static mrbc_value get_string(mrbc_vm *vm, reader_t *r, size_t len)
+{
+    const uint8_t *p = get_bytes(r, len);
+    return mrbc_string_new(vm, p != NULL ? (const char *)p : "", p != NULL ? len : 0);
+}
+
+static bool decode(mrbc_vm *vm, reader_t *r, mrbc_value *out)
+{
+    if (get_u8(r) != SESSION_VERSION) {
+        return false;
+    }
+
+    int n = get_u16(r);
+    mrbc_value strings = mrbc_array_new(vm, n);
+    for (int i = 0; i < n && !r->bad; i++) {
+        mrbc_value s = get_string(vm, r, get_u16(r));
+        mrbc_array_push(&strings, &s);
+    }
+
+    n = get_u16(r);
+    mrbc_value ints = mrbc_array_new(vm, n);
+    for (int i = 0; i < n && !r->bad; i++) {
+        int32_t i32 = get_i32(r);
+        mrbc_value val = i32 == SESSION_NIL ? mrbc_nil_value() : mrbc_integer_value(i32);
+        mrbc_array_push(&ints, &val);
+    }
+
+    n = get_u16(r);
+    mrbc_value lines = mrbc_array_new(vm, n);
+    for (int i = 0; i < n && !r->bad; i++) {
+        int indent = get_u8(r);
+        mrbc_value line = mrbc_hash_new(vm, 2);
+        mrbc_value k = mrbc_symbol_value(mrbc_str_to_symid("text"));
+        mrbc_value s = get_string(vm, r, get_u16(r));
+        mrbc_hash_set(&line, &k, &s);
+        k = mrbc_symbol_value(mrbc_str_to_symid("indent"));
+        mrbc_value ind = mrbc_integer_value(indent);
+        mrbc_hash_set(&line, &k, &ind);
+        mrbc_array_push(&lines, &line);
+    }
+
+    n = get_u16(r);
+    mrbc_value words = mrbc_array_new(vm, n);
+    for (int i = 0; i < n && !r->bad; i++) {
+        mrbc_value s = get_string(vm, r, get_u8(r));
+        mrbc_array_push(&words, &s);
+    }
+
+    *out = mrbc_array_new(vm, 4);
+    mrbc_array_push(out, &lines);
+    mrbc_array_push(out, &strings);
+    mrbc_array_push(out, &ints);
+    mrbc_array_push(out, &words);
+    if (r->bad) {
+        mrbc_decref(out);
+        return false;
+    }
+    return true;
+}
+
+/* ==============================================
+ * Method: Session.save(code_lines, strings, ints, words)
+ * Write a snapshot: code_lines ([{text:, indent:}, ...]), strings,
+ * integers (or nil) and completion words
+ * Returns: true if it was written
+ * ============================================== */
+static void c_session_save(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 4 || mrbc_type(v[1]) != MRBC_TT_ARRAY || mrbc_type(v[2]) != MRBC_TT_ARRAY ||
+        mrbc_type(v[3]) != MRBC_TT_ARRAY || mrbc_type(v[4]) != MRBC_TT_ARRAY ||
+        mrbc_array_size(&v[1]) > UINT16_MAX || mrbc_array_size(&v[2]) > UINT16_MAX ||
+        mrbc_array_size(&v[3]) > UINT16_MAX || mrbc_array_size(&v[4]) > UINT16_MAX) {
+        SET_FALSE_RETURN();
+        return;
+    }
+
+    // Measure, then encode into a buffer of that size
+    writer_t w = { 0 };
+    if (!encode(&w, &v[1], &v[2], &v[3], &v[4])) {
+        SET_FALSE_RETURN();
+        return;
+    }
+    w.buf = heap_caps_malloc(w.len, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (w.buf == NULL) {
+        SET_FALSE_RETURN();
+        return;
+    }
+    w.len = 0;
+    encode(&w, &v[1], &v[2], &v[3], &v[4]);
+
+    bool ok = session_store_save(w.buf, w.len);
+    heap_caps_free(w.buf);
+    if (ok) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Session.load
+ * Returns: [code_lines, strings, ints, words] from the newest snapshot,
+ *          or nil
+ * ============================================== */
+static void c_session_load(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    uint8_t *data;
+    size_t len;
+    if (!session_store_load(&data, &len)) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    reader_t r = { .p = data, .left = len };
+    mrbc_value snapshot;
+    bool ok = decode(vm, &r, &snapshot);
+    heap_caps_free(data);
+    if (ok) {
+        SET_RETURN(snapshot);
+    } else {
+        SET_NIL_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Session.touch
+ * Something changed: save SESSION_QUIET_MS after the last touch
+ * ============================================== */
+static void c_session_touch(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    session_touch();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Session.wait_ms
+ * Returns: ms until a snapshot is due (0 = save now), nil if unchanged
+ * ============================================== */
+static void c_session_wait_ms(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int32_t ms = session_wait_ms();
+    if (ms < 0) {
+        SET_NIL_RETURN();
+    } else {
+        SET_INT_RETURN(ms);
+    }
+}
+
+/* ==============================================
+ * Method: Session.warm_boot?
+ * Returns: true after a restart, panic or watchdog reset (held pins
+ *          and the peripherals they power stayed up)
+ * ============================================== */
+static void c_session_warm_boot(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (session_warm_boot()) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Session.hold_pin(pin)
+ * Keep the pin's current level through warm resets
+ * ============================================== */
+static void c_session_hold_pin(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc >= 1 && mrbc_type(v[1]) == MRBC_TT_INTEGER && session_hold_pin(GET_INT_ARG(1))) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Initialize Session class
+ * ============================================== */
+void mrbc_session_init(mrbc_vm *vm)
+{
+    mrbc_class_Session = mrbc_define_class(vm, "Session", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Session, "save", c_session_save);
+    mrbc_define_method(vm, mrbc_class_Session, "load", c_session_load);
+    mrbc_define_method(vm, mrbc_class_Session, "touch", c_session_touch);
+    mrbc_define_method(vm, mrbc_class_Session, "wait_ms", c_session_wait_ms);
+    mrbc_define_method(vm, mrbc_class_Session, "warm_boot?", c_session_warm_boot);
+    mrbc_define_method(vm, mrbc_class_Session, "hold_pin", c_session_hold_pin);
+}
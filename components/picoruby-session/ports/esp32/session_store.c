@@ -0,0 +1,235 @@
+#include "session_store.h"
+#include <string.h>
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "Session";
+
+#define SECTOR_SIZE     4096
+#define SESSION_MAGIC   0x314E5353u   // "SSN1"
+#define CRASH_MAGIC     0x43524153u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;       // higher = newer
+    uint32_t len;       // payload bytes after the header
+    uint32_t sum;       // FNV-1a of the payload
+} session_header_t;
+
+static const esp_partition_t *part = NULL;
+static uint32_t part_sectors = 0;
+
+// Log position, from the newest header found at boot
+static bool scanned = false;
+static uint32_t last_seq = 0;
+static uint32_t next_sector = 0;
+
+static bool dirty = false;
+static int64_t touched_us = 0;
+
+// Survives resets that keep the chip powered
+static RTC_NOINIT_ATTR uint32_t crash_magic;
+static RTC_NOINIT_ATTR uint32_t crash_count;
+
+static uint32_t checksum(const uint8_t *p, size_t len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t sectors_for(size_t len)
+{
+    return (sizeof(session_header_t) + len + SECTOR_SIZE - 1) / SECTOR_SIZE;
+}
+
+static bool open_partition(void)
+{
+    if (part != NULL) {
+        return true;
+    }
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                    SESSION_PARTITION);
+    if (part == NULL || part->size < SECTOR_SIZE * 2 * sectors_for(SESSION_MAX_SIZE)) {
+        ESP_LOGE(TAG, "No '%s' partition for snapshots", SESSION_PARTITION);
+        part = NULL;
+        return false;
+    }
+    part_sectors = part->size / SECTOR_SIZE;
+    return true;
+}
+
+// Header at the start of sector s, if it looks like one
+static bool read_header(uint32_t s, session_header_t *h)
+{
+    return esp_partition_read(part, s * SECTOR_SIZE, h, sizeof(*h)) == ESP_OK &&
+           h->magic == SESSION_MAGIC && h->len <= SESSION_MAX_SIZE &&
+           s + sectors_for(h->len) <= part_sectors;
+}
+
+// Sector of the newest header with seq below `below`, or -1
+static int find_newest(uint32_t below, session_header_t *out)
+{
+    int found = -1;
+    for (uint32_t s = 0; s < part_sectors; s++) {
+        session_header_t h;
+        if (read_header(s, &h) && h.seq < below && (found < 0 || h.seq > out->seq)) {
+            *out = h;
+            found = (int)s;
+        }
+    }
+    return found;
+}
+
+// The next snapshot goes after the newest one, whether or not it is intact
+static void scan(void)
+{
+    session_header_t h;
+    int s = find_newest(UINT32_MAX, &h);
+    if (s >= 0) {
+        last_seq = h.seq;
+        next_sector = s + sectors_for(h.len);
+    }
+    scanned = true;
+}
+
+static bool crash_reset(void)
+{
+    switch (esp_reset_reason()) {
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool session_store_load(uint8_t **data, size_t *len)
+{
+    if (crash_magic != CRASH_MAGIC) {
+        crash_magic = CRASH_MAGIC;
+        crash_count = 0;
+    }
+    crash_count = crash_reset() ? crash_count + 1 : 0;
+
+    if (!open_partition()) {
+        return false;
+    }
+    scan();
+    if (crash_count > SESSION_CRASH_LIMIT) {
+        ESP_LOGW(TAG, "%u crash resets in a row, not restoring", (unsigned)crash_count);
+        return false;
+    }
+
+    // Fall back to older snapshots if the newest one is damaged
+    uint32_t below = UINT32_MAX;
+    session_header_t h;
+    int s;
+    while ((s = find_newest(below, &h)) >= 0) {
+        uint8_t *buf = heap_caps_malloc(h.len + 1, MALLOC_CAP_8BIT);
+        if (buf == NULL) {
+            ESP_LOGE(TAG, "No memory for a %u byte snapshot", (unsigned)h.len);
+            return false;
+        }
+        if (esp_partition_read(part, s * SECTOR_SIZE + sizeof(h), buf, h.len) == ESP_OK &&
+            checksum(buf, h.len) == h.sum) {
+            ESP_LOGI(TAG, "Restored snapshot %u (%u bytes)", (unsigned)h.seq, (unsigned)h.len);
+            *data = buf;
+            *len = h.len;
+            return true;
+        }
+        ESP_LOGW(TAG, "Snapshot %u is damaged", (unsigned)h.seq);
+        heap_caps_free(buf);
+        below = h.seq;
+    }
+    return false;
+}
+
+bool session_store_save(const uint8_t *data, size_t len)
+{
+    dirty = false;
+    if (len > SESSION_MAX_SIZE) {
+        ESP_LOGW(TAG, "Snapshot of %u bytes is too large", (unsigned)len);
+        return false;
+    }
+    if (!open_partition()) {
+        return false;
+    }
+    if (!scanned) {
+        scan();
+    }
+
+    uint32_t n = sectors_for(len);
+    uint32_t s = next_sector + n <= part_sectors ? next_sector : 0;
+    session_header_t h = {
+        .magic = SESSION_MAGIC,
+        .seq = last_seq + 1,
+        .len = len,
+        .sum = checksum(data, len),
+    };
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = esp_partition_erase_range(part, s * SECTOR_SIZE, n * SECTOR_SIZE);
+    if (err == ESP_OK) {
+        err = esp_partition_write(part, s * SECTOR_SIZE + sizeof(h), data, len);
+    }
+    if (err == ESP_OK) {
+        err = esp_partition_write(part, s * SECTOR_SIZE, &h, sizeof(h));
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Snapshot write failed: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    last_seq = h.seq;
+    next_sector = s + n;
+    crash_count = 0;
+    ESP_LOGI(TAG, "Snapshot %u: %u bytes at sector %u in %d ms", (unsigned)h.seq, (unsigned)len,
+             (unsigned)s, (int)((esp_timer_get_time() - start) / 1000));
+    return true;
+}
+
+void session_touch(void)
+{
+    dirty = true;
+    touched_us = esp_timer_get_time();
+}
+
+int32_t session_wait_ms(void)
+{
+    if (!dirty) {
+        return -1;
+    }
+    int64_t left = SESSION_QUIET_MS - (esp_timer_get_time() - touched_us) / 1000;
+    return left > 0 ? (int32_t)left : 0;
+}
+
+bool session_warm_boot(void)
+{
+    switch (esp_reset_reason()) {
+    case ESP_RST_SW:
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool session_hold_pin(int pin)
+{
+    return gpio_hold_en((gpio_num_t)pin) == ESP_OK;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Snapshots go to the data partition with this label (partitions.csv)
+#define SESSION_PARTITION     "storage"
+
+// Largest snapshot payload in bytes
+#define SESSION_MAX_SIZE      (32 * 1024)
+
+// A snapshot is due once nothing has changed for this long
+#define SESSION_QUIET_MS      2000
+
+// Crash resets in a row that still restore the snapshot (a buffer that
+// crashes the editor is not restored a third time)
+#define SESSION_CRASH_LIMIT   2
+
+// Snapshots are appended to a log that wraps around the partition, so
+// each sector is erased once every (partition size / snapshot size) saves
+// A snapshot is a 16 byte header in front of the payload, the header
+// being written last: a save cut short by a reset leaves the previous
+// snapshot in place
+
+// Read the newest intact snapshot into a malloc'd buffer (caller frees)
+// Returns false if there is none, or after too many crash resets
+bool session_store_load(uint8_t **data, size_t *len);
+
+// Append a snapshot (erases and writes flash, about 50 ms per 4 KB)
+bool session_store_save(const uint8_t *data, size_t len);
+
+// Something changed: the snapshot is due SESSION_QUIET_MS from now
+void session_touch(void);
+
+// Milliseconds until the snapshot is due (0 = now), or -1 if unchanged
+int32_t session_wait_ms(void);
+
+// The last reset kept the chip powered (restart, panic, watchdog)
+// Shared with the panel init, which skips its resets then
+bool session_warm_boot(void);
+
+// Keep a pin's level through resets other than power-on (GPIO 10, the
+// board power, from app.rb and the panel init)
+bool session_hold_pin(int pin);
+
+#ifdef __cplusplus
+}
+#endif
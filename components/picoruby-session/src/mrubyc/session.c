@@ -0,0 +1,9 @@
+/*
+ * Session mrubyc initialization stub
+ * Actual implementation is in ports/esp32/session_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/session_native.c */
+extern void mrbc_session_init(mrbc_vm *vm);
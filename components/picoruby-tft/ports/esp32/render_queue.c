@@ -0,0 +1,254 @@
+#include "render_queue.h"
+#include "st7789_spi.h"
+#include <stdatomic.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "Render";
+
+#define RING_MASK (RENDER_RING_SIZE - 1)
+
+// Worker task, and the semaphore it gives after each command while the
+// VM waits for it (ring full or fence)
+static TaskHandle_t worker_task = NULL;
+static SemaphoreHandle_t progress = NULL;
+
+// Lock-free single-producer (VM) / single-consumer (worker) ring
+// The tail moves once a command is drawn, so head == tail means idle
+static render_cmd_t ring[RENDER_RING_SIZE];
+static atomic_uint ring_head = 0;  // next slot to write (producer only)
+static atomic_uint ring_tail = 0;  // next slot to draw (consumer only)
+
+// Sleep / wait handshakes: each side stores its flag and then loads the
+// other side's index (both seq_cst), so one of them always sees the other
+static atomic_bool worker_sleeping = false;
+static atomic_bool vm_waiting = false;
+
+// Producer side only
+static render_stats_t stats;
+static uint32_t marks_queued = 0;
+
+// Written by whoever draws, then published through marks_drawn
+static render_stamp_t stamps[RENDER_MARKS];
+static atomic_uint marks_drawn = 0;
+
+static void stamp_mark(void)
+{
+    unsigned n = atomic_load_explicit(&marks_drawn, memory_order_relaxed);
+    stamps[n & (RENDER_MARKS - 1)] = (render_stamp_t){
+        .transfers = st7789_transfer_count(),
+        .last_us = st7789_last_transfer_us(),
+    };
+    atomic_store(&marks_drawn, n + 1);
+}
+
+static void draw(const render_cmd_t *c)
+{
+    switch (c->op) {
+    case RENDER_FILL_SCREEN:
+        st7789_fill_screen(c->color);
+        break;
+    case RENDER_PIXEL:
+        st7789_draw_pixel(c->x, c->y, c->color);
+        break;
+    case RENDER_FILL_RECT:
+        st7789_fill_rect(c->x, c->y, c->w, c->h, c->color);
+        break;
+    case RENDER_H_LINE:
+        st7789_draw_fast_h_line(c->x, c->y, c->w, c->color);
+        break;
+    case RENDER_V_LINE:
+        st7789_draw_fast_v_line(c->x, c->y, c->h, c->color);
+        break;
+    case RENDER_RECT:
+        st7789_draw_rect(c->x, c->y, c->w, c->h, c->color);
+        break;
+    case RENDER_ROUND_RECT:
+        st7789_draw_round_rect(c->x, c->y, c->w, c->h, c->r, c->color);
+        break;
+    case RENDER_FILL_ROUND_RECT:
+        st7789_fill_round_rect(c->x, c->y, c->w, c->h, c->r, c->color);
+        break;
+    case RENDER_CURSOR:
+        st7789_set_cursor(c->x, c->y);
+        break;
+    case RENDER_TEXT_COLOR:
+        st7789_set_text_color(c->color);
+        break;
+    case RENDER_TEXT_SIZE:
+        st7789_set_text_size((uint8_t)c->x);
+        break;
+    case RENDER_TEXT_WRAP:
+        st7789_set_text_wrap(c->x != 0);
+        break;
+    case RENDER_PRINT: {
+        char text[RENDER_TEXT_MAX + 1];
+        memcpy(text, c->text, c->len);
+        text[c->len] = '\0';
+        st7789_print(text);
+        break;
+    }
+    case RENDER_ROTATION:
+        st7789_set_rotation((uint8_t)c->x);
+        break;
+    case RENDER_BACKLIGHT:
+        st7789_set_backlight((uint8_t)c->x);
+        break;
+    case RENDER_OVERLAY_BEGIN:
+        st7789_overlay_begin();
+        break;
+    case RENDER_OVERLAY_END:
+        st7789_overlay_end();
+        break;
+    case RENDER_MARK:
+        stamp_mark();
+        break;
+    default:
+        break;
+    }
+}
+
+static void render_loop(void *arg)
+{
+    for (;;) {
+        unsigned tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+        unsigned head = atomic_load_explicit(&ring_head, memory_order_acquire);
+
+        if (tail == head) {
+            atomic_store(&worker_sleeping, true);
+            if (atomic_load(&ring_head) == tail) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            }
+            atomic_store(&worker_sleeping, false);
+            continue;
+        }
+
+        draw(&ring[tail & RING_MASK]);
+        atomic_store(&ring_tail, tail + 1);
+        if (atomic_load(&vm_waiting)) {
+            xSemaphoreGive(progress);
+        }
+    }
+}
+
+bool render_start(void)
+{
+#if CONFIG_PICORUBY_RENDER_WORKER
+    if (worker_task != NULL) {
+        return true;
+    }
+
+    if (progress == NULL) {
+        progress = xSemaphoreCreateBinary();
+    }
+    if (progress == NULL ||
+        xTaskCreatePinnedToCore(render_loop, "render", RENDER_STACK_SIZE, NULL,
+                                RENDER_PRIORITY, &worker_task, RENDER_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create render task, drawing on the VM");
+        worker_task = NULL;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool render_idle(void)
+{
+    return atomic_load(&ring_tail) == atomic_load(&ring_head);
+}
+
+static bool ring_has_room(void)
+{
+    return atomic_load_explicit(&ring_head, memory_order_relaxed) - atomic_load(&ring_tail) <
+           RENDER_RING_SIZE;
+}
+
+// Block the VM until done() holds, woken by the worker after each command
+static void wait_for_worker(bool (*done)(void))
+{
+    atomic_store(&vm_waiting, true);
+    while (!done()) {
+        xSemaphoreTake(progress, portMAX_DELAY);
+    }
+    atomic_store(&vm_waiting, false);
+}
+
+void render_push(const render_cmd_t *cmd)
+{
+    if (worker_task == NULL) {
+        draw(cmd);
+        return;
+    }
+
+    if (!ring_has_room()) {
+        stats.full_waits++;
+        wait_for_worker(ring_has_room);
+    }
+
+    unsigned head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    ring[head & RING_MASK] = *cmd;
+    atomic_store(&ring_head, head + 1);
+
+    stats.commands++;
+    unsigned depth = head + 1 - atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    if (depth > stats.max_depth) {
+        stats.max_depth = depth;
+    }
+
+    if (atomic_load(&worker_sleeping)) {
+        xTaskNotifyGive(worker_task);
+    }
+}
+
+void render_print(const char *text)
+{
+    size_t len = strlen(text);
+    while (len > 0) {
+        render_cmd_t cmd = { .op = RENDER_PRINT };
+        cmd.len = len < RENDER_TEXT_MAX ? len : RENDER_TEXT_MAX;
+        memcpy(cmd.text, text, cmd.len);
+        render_push(&cmd);
+        text += cmd.len;
+        len -= cmd.len;
+    }
+}
+
+void render_fence(void)
+{
+    if (worker_task == NULL || render_idle()) {
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    wait_for_worker(render_idle);
+    stats.fences++;
+    stats.fence_us += (uint32_t)(esp_timer_get_time() - start);
+}
+
+uint32_t render_mark(void)
+{
+    render_cmd_t cmd = { .op = RENDER_MARK };
+    render_push(&cmd);
+    return marks_queued++;
+}
+
+bool render_mark_stamp(uint32_t n, render_stamp_t *out)
+{
+    if ((int32_t)(atomic_load(&marks_drawn) - n) <= 0) {
+        return false;
+    }
+    *out = stamps[n & (RENDER_MARKS - 1)];
+    return true;
+}
+
+void render_get_stats(render_stats_t *st)
+{
+    *st = stats;
+}
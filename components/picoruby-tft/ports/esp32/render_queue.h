@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The VM runs on core 0, the render worker on the other core between
+// the keyboard (5) and the checker (1)
+#define RENDER_CORE           1
+#define RENDER_PRIORITY       4
+#define RENDER_STACK_SIZE     4096
+
+// Ring buffer capacity in commands (must be a power of two)
+#define RENDER_RING_SIZE      256
+
+// Text bytes carried by one command (longer prints take several)
+#define RENDER_TEXT_MAX       18
+
+// Mark stamps kept (must be a power of two)
+#define RENDER_MARKS          32
+
+typedef enum {
+    RENDER_FILL_SCREEN = 1,
+    RENDER_PIXEL,
+    RENDER_FILL_RECT,
+    RENDER_H_LINE,
+    RENDER_V_LINE,
+    RENDER_RECT,
+    RENDER_ROUND_RECT,
+    RENDER_FILL_ROUND_RECT,
+    RENDER_CURSOR,
+    RENDER_TEXT_COLOR,
+    RENDER_TEXT_SIZE,
+    RENDER_TEXT_WRAP,
+    RENDER_PRINT,
+    RENDER_ROTATION,
+    RENDER_BACKLIGHT,
+    RENDER_OVERLAY_BEGIN,
+    RENDER_OVERLAY_END,
+    RENDER_MARK,
+} render_op_t;
+
+// One draw call, 32 bytes (fields not used by the op are ignored)
+typedef struct {
+    uint8_t op;
+    uint8_t len;                 // text bytes (RENDER_PRINT)
+    uint16_t color;              // RGB565
+    int16_t x;                   // also size / rotation / level / wrap
+    int16_t y;
+    int16_t w;
+    int16_t h;
+    int16_t r;
+    char text[RENDER_TEXT_MAX];
+} render_cmd_t;
+
+// Start the worker task (safe to call more than once)
+// Without it, or with CONFIG_PICORUBY_RENDER_WORKER off, commands are
+// drawn by the caller right away
+bool render_start(void);
+
+// Queue a draw call (single producer: the VM)
+// Waits for the worker when the ring is full
+void render_push(const render_cmd_t *cmd);
+
+// Queue a print, split into RENDER_TEXT_MAX byte commands
+void render_print(const char *text);
+
+// Wait until everything queued is on the panel; call before reading
+// anything the drawing changes (rotation, shadow, transfer times) or
+// using the SPI bus another way
+void render_fence(void);
+
+// Nothing queued or being drawn (any task may ask)
+bool render_idle(void);
+
+// Panel transfers when the worker reached a mark
+typedef struct {
+    uint32_t transfers;     // st7789_transfer_count
+    uint32_t last_us;       // st7789_last_transfer_us
+} render_stamp_t;
+
+// Queue a mark: the worker stamps it when it gets there, so the VM can
+// tell when the drawing before it reached the panel without a fence
+// Returns the mark's number
+uint32_t render_mark(void);
+
+// Stamp of mark n (only the last RENDER_MARKS are kept)
+// Returns false while the worker has not reached it
+bool render_mark_stamp(uint32_t n, render_stamp_t *out);
+
+typedef struct {
+    uint32_t commands;      // commands queued
+    uint32_t full_waits;    // pushes that waited for room
+    uint32_t fences;        // fences that had to wait
+    uint32_t fence_us;      // time the VM spent waiting in those
+    uint32_t max_depth;     // most commands queued at once
+} render_stats_t;
+
+void render_get_stats(render_stats_t *st);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,15 +3,21 @@
  */
 
 #include "st7789_spi.h"
+#include "session_store.h"
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 
 static const char* TAG = "ST7789";
 
 // SPI handle
 static spi_device_handle_t spi_handle = NULL;
+static int spi_clock_hz = ST7789_SPI_CLOCK_HZ;
 
 // Display state
 static int16_t _width = ST7789_WIDTH;
@@ -23,10 +29,44 @@ static uint16_t _text_color = COLOR_WHITE;
 static uint8_t _text_size = 1;
 static bool _text_wrap = true;
 
+// Shadow framebuffer, pixels in panel byte order (big endian)
+#define BLIT_BUF_SIZE 2048
+static uint16_t *_shadow = NULL;
+static bool _shadow_valid = false;  // false after a rotation change
+static bool _overlay = false;
+
+// Backlight level, and when the line went low for off
+static uint8_t _backlight = 0;
+static int64_t _backlight_off_us = 0;
+static portMUX_TYPE _backlight_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Transfers so far and when the last one finished (for latency stats)
+static uint32_t _xfer_count = 0;
+static uint32_t _xfer_end_us = 0;
+
+static inline uint16_t panel_order(uint16_t color)
+{
+    return (uint16_t)((color >> 8) | (color << 8));
+}
+
+// Mirror a clipped fill into the shadow (base layer only)
+static void shadow_fill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    if (_shadow == NULL || _overlay) return;
+
+    uint16_t px = panel_order(color);
+    for (int16_t row = 0; row < h; row++) {
+        uint16_t *dst = _shadow + (y + row) * _width + x;
+        for (int16_t col = 0; col < w; col++) {
+            dst[col] = px;
+        }
+    }
+}
+
 // Pre/post transaction callbacks for DC pin
 static void IRAM_ATTR spi_pre_transfer_callback(spi_transaction_t *t)
 {
-    int dc = (int)t->user;
+    int dc = (int)(intptr_t)t->user;
     gpio_set_level(TDECK_TFT_DC, dc);
 }
 
@@ -39,6 +79,8 @@ static void st7789_cmd(uint8_t cmd)
         .user = (void*)0,  // DC = 0 for command
     };
     esp_err_t ret = spi_device_polling_transmit(spi_handle, &t);
+    _xfer_count++;
+    _xfer_end_us = (uint32_t)esp_timer_get_time();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to send command 0x%02x", cmd);
     }
@@ -54,6 +96,8 @@ static void st7789_data(const uint8_t *data, size_t len)
         .user = (void*)1,  // DC = 1 for data
     };
     esp_err_t ret = spi_device_polling_transmit(spi_handle, &t);
+    _xfer_count++;
+    _xfer_end_us = (uint32_t)esp_timer_get_time();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to send data");
     }
@@ -87,63 +131,147 @@ static void st7789_set_addr_window(int16_t x0, int16_t y0, int16_t x1, int16_t y
     st7789_cmd(ST7789_RAMWR);
 }
 
-bool st7789_init(void)
+static bool add_spi_device(int clock_hz)
 {
-    // Already initialized - just re-add SPI device if needed
-    if (spi_handle != NULL) {
-        ESP_LOGI(TAG, "ST7789 already initialized, re-adding SPI device");
-        spi_bus_remove_device(spi_handle);
+    spi_device_interface_config_t dev_cfg = {
+        .clock_speed_hz = clock_hz,
+        .mode = 0,
+        .spics_io_num = TDECK_TFT_CS,
+        .queue_size = ST7789_SPI_QUEUE_SIZE,
+        .pre_cb = spi_pre_transfer_callback,
+    };
+
+    esp_err_t ret = spi_bus_add_device(SPI2_HOST, &dev_cfg, &spi_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add SPI device: %s", esp_err_to_name(ret));
         spi_handle = NULL;
+        return false;
     }
+    spi_clock_hz = clock_hz;
+    return true;
+}
 
-    ESP_LOGI(TAG, "Initializing ST7789 display...");
+// Panel init sequences: each step is a command, its parameters and the
+// time the panel needs before the next command (datasheet timings)
+typedef struct {
+    uint8_t cmd;
+    uint8_t len;
+    uint8_t data[3];
+    uint8_t delay_ms;
+    uint8_t awake_ms;   // instead of delay_ms when the panel was in sleep out
+} st7789_init_step_t;
+
+#define ST7789_COLMOD_RGB565  0x55
+#define ST7789_MADCTL_INIT    (ST7789_MADCTL_MX | ST7789_MADCTL_MV | ST7789_MADCTL_RGB)
+
+// SWRESET takes 5 ms from sleep in (after power-on), but SLPOUT must wait
+// 120 ms when it was sent in sleep out; SLPOUT takes 5 ms (its 120 ms
+// only holds before a SLPIN)
+static const st7789_init_step_t cold_init[] = {
+    { ST7789_SWRESET, 0, { 0 }, 5, 120 },
+    { ST7789_SLPOUT, 0, { 0 }, 5, 0 },
+    { ST7789_COLMOD, 1, { ST7789_COLMOD_RGB565 }, 0, 0 },
+    { ST7789_MADCTL, 1, { ST7789_MADCTL_INIT }, 0, 0 },   // landscape
+    { ST7789_INVON, 0, { 0 }, 0, 0 },                     // T-Deck panel
+    { ST7789_NORON, 0, { 0 }, 0, 0 },
+    { ST7789_DISPON, 0, { 0 }, 0, 0 },
+};
 
-    // Initialize power pin
-    gpio_config_t pwr_conf = {
-        .pin_bit_mask = (1ULL << TDECK_POWERON),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
+// MADCTL in effect (rotation)
+static uint8_t _madctl = ST7789_MADCTL_INIT;
+
+// Set once the panel is awake and its power pin held, so it stays awake
+// through resets that keep the chip powered
+#define PANEL_AWAKE_MAGIC 0x50414E4Cu
+static RTC_NOINIT_ATTR uint32_t _panel_awake;
+
+// Time taken by the last init, and whether it was a cold one
+static uint32_t _init_us = 0;
+static bool _init_cold = false;
+
+static void run_steps(const st7789_init_step_t *steps, size_t count, bool awake)
+{
+    for (size_t i = 0; i < count; i++) {
+        const st7789_init_step_t *step = &steps[i];
+        st7789_cmd(step->cmd);
+        st7789_data(step->data, step->len);
+
+        // One tick more: a delay ends on a tick, so it may fall short by one
+        int ms = awake && step->awake_ms > 0 ? step->awake_ms : step->delay_ms;
+        if (ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(ms) + 1);
+        }
+    }
+}
+
+// Colors and orientation are all a panel that stayed awake may have lost
+static void resume_steps(void)
+{
+    const st7789_init_step_t steps[] = {
+        { ST7789_COLMOD, 1, { ST7789_COLMOD_RGB565 }, 0, 0 },
+        { ST7789_MADCTL, 1, { _madctl }, 0, 0 },
     };
-    gpio_config(&pwr_conf);
-    gpio_set_level(TDECK_POWERON, 1);
-    ESP_LOGI(TAG, "Power ON");
+    run_steps(steps, sizeof(steps) / sizeof(steps[0]), true);
+}
 
-    // Initialize CS pins for all SPI devices (keep high)
-    gpio_config_t cs_conf = {
-        .pin_bit_mask = (1ULL << TDECK_TFT_CS) | (1ULL << TDECK_SDCARD_CS) | (1ULL << TDECK_RADIO_CS),
+static void output_pins(uint64_t mask)
+{
+    gpio_config_t conf = {
+        .pin_bit_mask = mask,
         .mode = GPIO_MODE_OUTPUT,
         .pull_up_en = GPIO_PULLUP_DISABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
         .intr_type = GPIO_INTR_DISABLE,
     };
-    gpio_config(&cs_conf);
+    gpio_config(&conf);
+}
+
+bool st7789_resume(void)
+{
+    if (spi_handle == NULL) {
+        return false;
+    }
+
+    // Re-adding the device takes the CS pin back from other bus users
+    int64_t start = esp_timer_get_time();
+    spi_bus_remove_device(spi_handle);
+    spi_handle = NULL;
+    if (!add_spi_device(spi_clock_hz)) {
+        return false;
+    }
+    resume_steps();
+
+    _init_us = (uint32_t)(esp_timer_get_time() - start);
+    _init_cold = false;
+    ESP_LOGI(TAG, "ST7789 resumed in %u us", (unsigned)_init_us);
+    return true;
+}
+
+bool st7789_init(void)
+{
+    // Already initialized: the panel is awake, only the bus needs it back
+    if (spi_handle != NULL) {
+        return st7789_resume();
+    }
+
+    ESP_LOGI(TAG, "Initializing ST7789 display...");
+    int64_t start = esp_timer_get_time();
+
+    // Power pin, held so the panel stays powered (and awake) through resets
+    output_pins(1ULL << TDECK_POWERON);
+    gpio_set_level(TDECK_POWERON, 1);
+    session_hold_pin(TDECK_POWERON);
+
+    // CS pins of all SPI devices (kept high), DC and backlight (off)
+    output_pins((1ULL << TDECK_TFT_CS) | (1ULL << TDECK_SDCARD_CS) | (1ULL << TDECK_RADIO_CS) |
+                (1ULL << TDECK_TFT_DC) | (1ULL << TDECK_TFT_BL));
     gpio_set_level(TDECK_SDCARD_CS, 1);
     gpio_set_level(TDECK_RADIO_CS, 1);
     gpio_set_level(TDECK_TFT_CS, 1);
-
-    // Initialize DC pin
-    gpio_config_t dc_conf = {
-        .pin_bit_mask = (1ULL << TDECK_TFT_DC),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-    gpio_config(&dc_conf);
     gpio_set_level(TDECK_TFT_DC, 1);
-
-    // Initialize backlight pin
-    gpio_config_t bl_conf = {
-        .pin_bit_mask = (1ULL << TDECK_TFT_BL),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-    gpio_config(&bl_conf);
-    gpio_set_level(TDECK_TFT_BL, 0);  // Start with backlight off
+    gpio_set_level(TDECK_TFT_BL, 0);
+    _backlight = 0;
+    _backlight_off_us = esp_timer_get_time();
 
     // Configure SPI bus
     spi_bus_config_t bus_cfg = {
@@ -166,67 +294,65 @@ bool st7789_init(void)
         ESP_LOGI(TAG, "SPI bus initialized");
     }
 
-    // Configure SPI device
-    spi_device_interface_config_t dev_cfg = {
-        .clock_speed_hz = 40 * 1000 * 1000,  // 40 MHz
-        .mode = 0,
-        .spics_io_num = TDECK_TFT_CS,
-        .queue_size = 7,
-        .pre_cb = spi_pre_transfer_callback,
-    };
-
-    ret = spi_bus_add_device(SPI2_HOST, &dev_cfg, &spi_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to add SPI device: %s", esp_err_to_name(ret));
+    if (!add_spi_device(spi_clock_hz)) {
         return false;
     }
     ESP_LOGI(TAG, "SPI device added");
 
-    // Software reset
-    st7789_cmd(ST7789_SWRESET);
-    vTaskDelay(pdMS_TO_TICKS(150));
-
-    // Exit sleep mode
-    st7789_cmd(ST7789_SLPOUT);
-    vTaskDelay(pdMS_TO_TICKS(120));
-
-    // Set color mode to 16-bit (RGB565)
-    st7789_cmd(ST7789_COLMOD);
-    st7789_data8(0x55);  // 16-bit color
-    vTaskDelay(pdMS_TO_TICKS(10));
-
-    // Memory Data Access Control (rotation)
-    st7789_cmd(ST7789_MADCTL);
-    st7789_data8(ST7789_MADCTL_MX | ST7789_MADCTL_MV | ST7789_MADCTL_RGB);  // Rotation 1 (landscape)
-
-    // Inversion on (for T-Deck display)
-    st7789_cmd(ST7789_INVON);
-    vTaskDelay(pdMS_TO_TICKS(10));
-
-    // Normal display mode
-    st7789_cmd(ST7789_NORON);
-    vTaskDelay(pdMS_TO_TICKS(10));
-
-    // Display on
-    st7789_cmd(ST7789_DISPON);
-    vTaskDelay(pdMS_TO_TICKS(10));
+    // After a restart or crash the panel is still awake: skip the resets
+    // The power-on state of RTC memory is random, hence the reset reason
+    bool warm = session_warm_boot();
+    _madctl = ST7789_MADCTL_INIT;
+    if (warm && _panel_awake == PANEL_AWAKE_MAGIC) {
+        resume_steps();
+        _init_cold = false;
+    } else {
+        run_steps(cold_init, sizeof(cold_init) / sizeof(cold_init[0]), warm);
+        _panel_awake = PANEL_AWAKE_MAGIC;
+        _init_cold = true;
+    }
 
-    // Set initial rotation (landscape)
+    // Landscape, as set by ST7789_MADCTL_INIT
     _rotation = 1;
     _width = ST7789_HEIGHT;  // 320
     _height = ST7789_WIDTH;  // 240
 
-    ESP_LOGI(TAG, "ST7789 initialized successfully (%dx%d)", _width, _height);
+    // Shadow framebuffer in PSRAM (overlays work without it, but
+    // then restore_rect fails and callers redraw instead)
+    if (_shadow == NULL) {
+        _shadow = heap_caps_malloc(ST7789_WIDTH * ST7789_HEIGHT * 2, MALLOC_CAP_SPIRAM);
+        if (_shadow == NULL) {
+            ESP_LOGW(TAG, "No PSRAM for shadow framebuffer");
+        }
+    }
+    _shadow_valid = false;
+    _overlay = false;
 
     // Turn on backlight
     st7789_set_backlight(16);
 
+    _init_us = (uint32_t)(esp_timer_get_time() - start);
+    ESP_LOGI(TAG, "ST7789 initialized %s in %u us (%dx%d)", _init_cold ? "cold" : "warm",
+             (unsigned)_init_us, _width, _height);
     return true;
 }
 
+uint32_t st7789_init_us(bool *cold)
+{
+    if (cold != NULL) {
+        *cold = _init_cold;
+    }
+    return _init_us;
+}
+
 void st7789_fill_screen(uint16_t color)
 {
     st7789_fill_rect(0, 0, _width, _height, color);
+
+    // The whole base layer is known again
+    if (!_overlay) {
+        _shadow_valid = true;
+    }
 }
 
 void st7789_draw_pixel(int16_t x, int16_t y, uint16_t color)
@@ -236,6 +362,10 @@ void st7789_draw_pixel(int16_t x, int16_t y, uint16_t color)
     st7789_set_addr_window(x, y, x, y);
     uint8_t data[2] = { (color >> 8) & 0xFF, color & 0xFF };
     st7789_data(data, 2);
+
+    if (_shadow != NULL && !_overlay) {
+        _shadow[y * _width + x] = panel_order(color);
+    }
 }
 
 void st7789_fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
@@ -246,6 +376,7 @@ void st7789_fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color
     if (x + w > _width) w = _width - x;
     if (y + h > _height) h = _height - y;
 
+    shadow_fill(x, y, w, h, color);
     st7789_set_addr_window(x, y, x + w - 1, y + h - 1);
 
     uint32_t total_pixels = w * h;
@@ -253,16 +384,15 @@ void st7789_fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color
     uint8_t color_lo = color & 0xFF;
 
     // Use a buffer for faster transfer
-    #define FILL_BUF_SIZE 512
-    uint8_t buf[FILL_BUF_SIZE];
-    for (int i = 0; i < FILL_BUF_SIZE; i += 2) {
+    uint8_t buf[ST7789_FILL_CHUNK];
+    for (int i = 0; i < ST7789_FILL_CHUNK; i += 2) {
         buf[i] = color_hi;
         buf[i + 1] = color_lo;
     }
 
     uint32_t bytes_remaining = total_pixels * 2;
     while (bytes_remaining > 0) {
-        uint32_t chunk = (bytes_remaining > FILL_BUF_SIZE) ? FILL_BUF_SIZE : bytes_remaining;
+        uint32_t chunk = (bytes_remaining > ST7789_FILL_CHUNK) ? ST7789_FILL_CHUNK : bytes_remaining;
         st7789_data(buf, chunk);
         bytes_remaining -= chunk;
     }
@@ -296,8 +426,12 @@ void st7789_set_rotation(uint8_t rotation)
             break;
     }
 
+    _madctl = madctl;
     st7789_cmd(ST7789_MADCTL);
     st7789_data8(madctl);
+
+    // Shadow layout follows the rotation, contents are stale until fill_screen
+    _shadow_valid = false;
 }
 
 int16_t st7789_width(void)
@@ -490,12 +624,62 @@ uint16_t rgb888_to_rgb565(uint32_t rgb888)
 
 void st7789_set_backlight(uint8_t level)
 {
-    // T-Deck backlight has 16 levels (0-15)
-    // Simple on/off for now
-    if (level > 0) {
+    if (level > ST7789_BACKLIGHT_LEVELS) {
+        level = ST7789_BACKLIGHT_LEVELS;
+    }
+    if (level == _backlight) {
+        return;
+    }
+
+    if (level == 0) {
+        gpio_set_level(TDECK_TFT_BL, 0);
+        _backlight = 0;
+        _backlight_off_us = esp_timer_get_time();
+        return;
+    }
+
+    if (_backlight == 0) {
+        // The driver only restarts after a full off time, and comes up
+        // at the brightest level
+        int64_t off_us = esp_timer_get_time() - _backlight_off_us;
+        if (off_us < ST7789_BACKLIGHT_OFF_US) {
+            esp_rom_delay_us((uint32_t)(ST7789_BACKLIGHT_OFF_US - off_us));
+        }
         gpio_set_level(TDECK_TFT_BL, 1);
-    } else {
+        esp_rom_delay_us(ST7789_BACKLIGHT_ON_US);
+        _backlight = ST7789_BACKLIGHT_LEVELS;
+    }
+
+    // Each pulse is one level dimmer, from 1 it wraps to the brightest;
+    // a preempted low pulse could be taken for off
+    int pulses = (_backlight - level + ST7789_BACKLIGHT_LEVELS) % ST7789_BACKLIGHT_LEVELS;
+    portENTER_CRITICAL(&_backlight_mux);
+    for (int i = 0; i < pulses; i++) {
         gpio_set_level(TDECK_TFT_BL, 0);
+        esp_rom_delay_us(1);
+        gpio_set_level(TDECK_TFT_BL, 1);
+        esp_rom_delay_us(1);
+    }
+    portEXIT_CRITICAL(&_backlight_mux);
+    _backlight = level;
+}
+
+uint8_t st7789_get_backlight(void)
+{
+    return _backlight;
+}
+
+void st7789_hold_pins(bool hold)
+{
+    static const gpio_num_t pins[] = {
+        TDECK_TFT_BL, TDECK_TFT_DC, TDECK_TFT_CS, TDECK_SDCARD_CS, TDECK_RADIO_CS,
+    };
+    for (size_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++) {
+        if (hold) {
+            gpio_hold_en(pins[i]);
+        } else {
+            gpio_hold_dis(pins[i]);
+        }
     }
 }
 
@@ -507,19 +691,20 @@ void st7789_draw_fast_h_line(int16_t x, int16_t y, int16_t w, uint16_t color)
     if (x + w > _width) w = _width - x;
     if (w <= 0) return;
 
+    shadow_fill(x, y, w, 1, color);
     st7789_set_addr_window(x, y, x + w - 1, y);
 
     uint8_t color_hi = (color >> 8) & 0xFF;
     uint8_t color_lo = color & 0xFF;
-    uint8_t buf[64];
-    for (int i = 0; i < 64; i += 2) {
+    uint8_t buf[ST7789_LINE_CHUNK];
+    for (int i = 0; i < ST7789_LINE_CHUNK; i += 2) {
         buf[i] = color_hi;
         buf[i + 1] = color_lo;
     }
 
     int remaining = w;
     while (remaining > 0) {
-        int chunk = (remaining > 32) ? 32 : remaining;
+        int chunk = (remaining > ST7789_LINE_CHUNK / 2) ? ST7789_LINE_CHUNK / 2 : remaining;
         st7789_data(buf, chunk * 2);
         remaining -= chunk;
     }
@@ -533,19 +718,20 @@ void st7789_draw_fast_v_line(int16_t x, int16_t y, int16_t h, uint16_t color)
     if (y + h > _height) h = _height - y;
     if (h <= 0) return;
 
+    shadow_fill(x, y, 1, h, color);
     st7789_set_addr_window(x, y, x, y + h - 1);
 
     uint8_t color_hi = (color >> 8) & 0xFF;
     uint8_t color_lo = color & 0xFF;
-    uint8_t buf[64];
-    for (int i = 0; i < 64; i += 2) {
+    uint8_t buf[ST7789_LINE_CHUNK];
+    for (int i = 0; i < ST7789_LINE_CHUNK; i += 2) {
         buf[i] = color_hi;
         buf[i + 1] = color_lo;
     }
 
     int remaining = h;
     while (remaining > 0) {
-        int chunk = (remaining > 32) ? 32 : remaining;
+        int chunk = (remaining > ST7789_LINE_CHUNK / 2) ? ST7789_LINE_CHUNK / 2 : remaining;
         st7789_data(buf, chunk * 2);
         remaining -= chunk;
     }
@@ -664,3 +850,100 @@ void st7789_fill_round_rect(int16_t x, int16_t y, int16_t w, int16_t h,
     st7789_fill_circle_helper(x + w - r - 1, y + r, r, 1, h - 2 * r - 1, color);
     st7789_fill_circle_helper(x + r, y + r, r, 2, h - 2 * r - 1, color);
 }
+
+spi_device_handle_t st7789_spi_device(void)
+{
+    return spi_handle;
+}
+
+int st7789_spi_clock(void)
+{
+    return spi_clock_hz;
+}
+
+bool st7789_set_spi_clock(int clock_hz)
+{
+    if (spi_handle == NULL) return false;
+    if (clock_hz == spi_clock_hz) return true;
+
+    int old_hz = spi_clock_hz;
+    spi_bus_remove_device(spi_handle);
+    spi_handle = NULL;
+    if (add_spi_device(clock_hz)) return true;
+
+    // Put back the clock that worked
+    add_spi_device(old_hz);
+    return false;
+}
+
+void st7789_begin_write(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+{
+    // Raw data bypasses the shadow (valid again after a fill_screen)
+    _shadow_valid = false;
+    st7789_set_addr_window(x0, y0, x1, y1);
+}
+
+uint32_t st7789_transfer_count(void)
+{
+    return _xfer_count;
+}
+
+uint32_t st7789_last_transfer_us(void)
+{
+    return _xfer_end_us;
+}
+
+bool st7789_has_shadow(void)
+{
+    return _shadow != NULL && _shadow_valid;
+}
+
+void st7789_overlay_begin(void)
+{
+    _overlay = true;
+}
+
+void st7789_overlay_end(void)
+{
+    _overlay = false;
+}
+
+// Copy a rectangle of the base layer back to the panel in one window
+bool st7789_restore_rect(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    if (!st7789_has_shadow()) return false;
+
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > _width) w = _width - x;
+    if (y + h > _height) h = _height - y;
+    if (w <= 0 || h <= 0) return true;
+
+    st7789_set_addr_window(x, y, x + w - 1, y + h - 1);
+
+    // Pack rows into a DMA-capable buffer (the shadow lives in PSRAM)
+    static uint8_t buf[BLIT_BUF_SIZE];
+    size_t row_bytes = w * 2;
+    size_t used = 0;
+
+    for (int16_t row = 0; row < h; row++) {
+        const uint8_t *src = (const uint8_t *)(_shadow + (y + row) * _width + x);
+        size_t done = 0;
+        while (done < row_bytes) {
+            size_t n = row_bytes - done;
+            if (n > BLIT_BUF_SIZE - used) n = BLIT_BUF_SIZE - used;
+            memcpy(buf + used, src + done, n);
+            used += n;
+            done += n;
+            if (used == BLIT_BUF_SIZE) {
+                st7789_data(buf, used);
+                used = 0;
+            }
+        }
+    }
+    if (used > 0) {
+        st7789_data(buf, used);
+    }
+
+    return true;
+}
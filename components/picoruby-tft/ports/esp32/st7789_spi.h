@@ -27,6 +27,18 @@ extern "C" {
 #define TDECK_SDCARD_CS 39
 #define TDECK_RADIO_CS  9
 
+// SPI settings (compare others with `:bench spi`)
+#define ST7789_SPI_CLOCK_HZ   (40 * 1000 * 1000)
+#define ST7789_SPI_QUEUE_SIZE 7
+#define ST7789_FILL_CHUNK     512     // bytes per transfer in fill_rect
+#define ST7789_LINE_CHUNK     64      // bytes per transfer in h / v lines
+
+// Backlight driver on TDECK_TFT_BL: pulses step it one level dimmer,
+// holding the line low longer turns it off
+#define ST7789_BACKLIGHT_LEVELS   16
+#define ST7789_BACKLIGHT_ON_US    30      // high after off before the first pulse
+#define ST7789_BACKLIGHT_OFF_US   3000    // low before it counts as off
+
 // Display dimensions
 #define ST7789_WIDTH    240
 #define ST7789_HEIGHT   320
@@ -66,8 +78,17 @@ extern "C" {
 #define COLOR_BLUE    0x001F
 
 // Initialize ST7789 display
+// The first call (cold) runs the whole init sequence, unless the panel
+// stayed awake through a restart or crash; later calls only resume
 bool st7789_init(void);
 
+// Take the bus back after other users (SD card) and re-assert the color
+// mode and rotation; the panel contents and the shadow are kept
+bool st7789_resume(void);
+
+// Time taken by the last init or resume, cold = full init sequence
+uint32_t st7789_init_us(bool *cold);
+
 // Basic drawing functions
 void st7789_fill_screen(uint16_t color);
 void st7789_draw_pixel(int16_t x, int16_t y, uint16_t color);
@@ -91,8 +112,14 @@ void st7789_print(const char* text);
 // Color conversion
 uint16_t rgb888_to_rgb565(uint32_t rgb888);
 
-// Backlight control
+// Backlight control: 0 is off, 1 to ST7789_BACKLIGHT_LEVELS the brightest
+// (larger values are clamped); the driver keeps its level without a clock
 void st7789_set_backlight(uint8_t level);
+uint8_t st7789_get_backlight(void);
+
+// Hold the backlight, DC and chip select lines at their levels (through
+// light sleep), or release them
+void st7789_hold_pins(bool hold);
 
 // Line drawing functions
 void st7789_draw_fast_h_line(int16_t x, int16_t y, int16_t w, uint16_t color);
@@ -103,6 +130,29 @@ void st7789_draw_rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color
 void st7789_draw_round_rect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color);
 void st7789_fill_round_rect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color);
 
+// Panel transfers so far, and the esp_timer time (wraps) when the last
+// one finished; transfers are synchronous, so that is when the pixels
+// of the last draw reached the panel
+uint32_t st7789_transfer_count(void);
+uint32_t st7789_last_transfer_us(void);
+
+// Raw panel access for the SPI benchmark: the device handle (transfers
+// with user = (void *)1 are sent as data), the clock it was added with,
+// re-adding it at another clock, and opening a window for RAMWR data
+spi_device_handle_t st7789_spi_device(void);
+int st7789_spi_clock(void);
+bool st7789_set_spi_clock(int clock_hz);
+void st7789_begin_write(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+
+// Shadow framebuffer (PSRAM copy of the base layer)
+// Drawing updates the panel and the shadow; between overlay_begin and
+// overlay_end only the panel is drawn, so restore_rect can put the
+// base layer back under a popup with one blit
+bool st7789_has_shadow(void);
+void st7789_overlay_begin(void);
+void st7789_overlay_end(void);
+bool st7789_restore_rect(int16_t x, int16_t y, int16_t w, int16_t h);
+
 #ifdef __cplusplus
 }
 #endif
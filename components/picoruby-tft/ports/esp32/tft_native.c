@@ -4,19 +4,45 @@
  */
 
 #include "st7789_spi.h"
+#include "render_queue.h"
+#include "native_hash.h"
 #include <mrubyc.h>
 
 // mrubyc class pointer
 mrbc_class *mrbc_class_TFT = NULL;
 
+static void push_color(render_op_t op, int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+                       uint32_t rgb888)
+{
+    render_cmd_t cmd = {
+        .op = op,
+        .color = rgb888_to_rgb565(rgb888),
+        .x = x,
+        .y = y,
+        .w = w,
+        .h = h,
+        .r = r,
+    };
+    render_push(&cmd);
+}
+
+static void push_arg(render_op_t op, int16_t x, int16_t y)
+{
+    render_cmd_t cmd = { .op = op, .x = x, .y = y };
+    render_push(&cmd);
+}
+
 /* ==============================================
  * Method: TFT.init
+ * Drawing after this goes through the render worker
  * ============================================== */
 static void c_tft_init(mrbc_vm *vm, mrbc_value *v, int argc)
 {
+    render_fence();
     bool success = st7789_init();
     if (success) {
-        st7789_fill_screen(COLOR_BLACK);
+        render_start();
+        push_color(RENDER_FILL_SCREEN, 0, 0, 0, 0, 0, 0x000000);
     }
     SET_NIL_RETURN();
 }
@@ -29,11 +55,28 @@ static void c_tft_begin(mrbc_vm *vm, mrbc_value *v, int argc)
     c_tft_init(vm, v, argc);
 }
 
+/* ==============================================
+ * Method: TFT.resume
+ * Take the display back after SD Card access, keeping what is on it
+ * (TFT.init does the same, then clears the screen)
+ * Returns: true if the display was initialized
+ * ============================================== */
+static void c_tft_resume(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    render_fence();
+    if (st7789_resume()) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
 /* ==============================================
  * Method: TFT.width
  * ============================================== */
 static void c_tft_width(mrbc_vm *vm, mrbc_value *v, int argc)
 {
+    render_fence();
     SET_INT_RETURN(st7789_width());
 }
 
@@ -42,6 +85,7 @@ static void c_tft_width(mrbc_vm *vm, mrbc_value *v, int argc)
  * ============================================== */
 static void c_tft_height(mrbc_vm *vm, mrbc_value *v, int argc)
 {
+    render_fence();
     SET_INT_RETURN(st7789_height());
 }
 
@@ -51,8 +95,7 @@ static void c_tft_height(mrbc_vm *vm, mrbc_value *v, int argc)
 static void c_tft_set_rotation(mrbc_vm *vm, mrbc_value *v, int argc)
 {
     if (argc >= 1) {
-        uint8_t rotation = (uint8_t)GET_INT_ARG(1);
-        st7789_set_rotation(rotation);
+        push_arg(RENDER_ROTATION, (int16_t)GET_INT_ARG(1), 0);
     }
     SET_NIL_RETURN();
 }
@@ -62,6 +105,7 @@ static void c_tft_set_rotation(mrbc_vm *vm, mrbc_value *v, int argc)
  * ============================================== */
 static void c_tft_get_rotation(mrbc_vm *vm, mrbc_value *v, int argc)
 {
+    render_fence();
     SET_INT_RETURN(st7789_get_rotation());
 }
 
@@ -70,12 +114,11 @@ static void c_tft_get_rotation(mrbc_vm *vm, mrbc_value *v, int argc)
  * ============================================== */
 static void c_tft_fill_screen(mrbc_vm *vm, mrbc_value *v, int argc)
 {
-    uint16_t color = COLOR_BLACK;
+    uint32_t rgb888 = 0x000000;
     if (argc >= 1) {
-        uint32_t rgb888 = (uint32_t)GET_INT_ARG(1);
-        color = rgb888_to_rgb565(rgb888);
+        rgb888 = (uint32_t)GET_INT_ARG(1);
     }
-    st7789_fill_screen(color);
+    push_color(RENDER_FILL_SCREEN, 0, 0, 0, 0, 0, rgb888);
     SET_NIL_RETURN();
 }
 
@@ -88,8 +131,7 @@ static void c_tft_draw_pixel(mrbc_vm *vm, mrbc_value *v, int argc)
         int16_t x = (int16_t)GET_INT_ARG(1);
         int16_t y = (int16_t)GET_INT_ARG(2);
         uint32_t rgb888 = (uint32_t)GET_INT_ARG(3);
-        uint16_t color = rgb888_to_rgb565(rgb888);
-        st7789_draw_pixel(x, y, color);
+        push_color(RENDER_PIXEL, x, y, 0, 0, 0, rgb888);
     }
     SET_NIL_RETURN();
 }
@@ -105,8 +147,7 @@ static void c_tft_fill_rect(mrbc_vm *vm, mrbc_value *v, int argc)
         int16_t w = (int16_t)GET_INT_ARG(3);
         int16_t h = (int16_t)GET_INT_ARG(4);
         uint32_t rgb888 = (uint32_t)GET_INT_ARG(5);
-        uint16_t color = rgb888_to_rgb565(rgb888);
-        st7789_fill_rect(x, y, w, h, color);
+        push_color(RENDER_FILL_RECT, x, y, w, h, 0, rgb888);
     }
     SET_NIL_RETURN();
 }
@@ -119,7 +160,7 @@ static void c_tft_set_cursor(mrbc_vm *vm, mrbc_value *v, int argc)
     if (argc >= 2) {
         int16_t x = (int16_t)GET_INT_ARG(1);
         int16_t y = (int16_t)GET_INT_ARG(2);
-        st7789_set_cursor(x, y);
+        push_arg(RENDER_CURSOR, x, y);
     }
     SET_NIL_RETURN();
 }
@@ -131,8 +172,7 @@ static void c_tft_set_text_color(mrbc_vm *vm, mrbc_value *v, int argc)
 {
     if (argc >= 1) {
         uint32_t rgb888 = (uint32_t)GET_INT_ARG(1);
-        uint16_t color = rgb888_to_rgb565(rgb888);
-        st7789_set_text_color(color);
+        push_color(RENDER_TEXT_COLOR, 0, 0, 0, 0, 0, rgb888);
     }
     SET_NIL_RETURN();
 }
@@ -144,7 +184,7 @@ static void c_tft_set_text_size(mrbc_vm *vm, mrbc_value *v, int argc)
 {
     if (argc >= 1) {
         uint8_t size = (uint8_t)GET_INT_ARG(1);
-        st7789_set_text_size(size);
+        push_arg(RENDER_TEXT_SIZE, size, 0);
     }
     SET_NIL_RETURN();
 }
@@ -156,7 +196,7 @@ static void c_tft_set_text_wrap(mrbc_vm *vm, mrbc_value *v, int argc)
 {
     if (argc >= 1) {
         bool wrap = mrbc_type(v[1]) == MRBC_TT_TRUE;
-        st7789_set_text_wrap(wrap);
+        push_arg(RENDER_TEXT_WRAP, wrap, 0);
     }
     SET_NIL_RETURN();
 }
@@ -168,13 +208,14 @@ static void c_tft_print(mrbc_vm *vm, mrbc_value *v, int argc)
 {
     if (argc >= 1) {
         const char* text = (const char*)GET_STRING_ARG(1);
-        st7789_print(text);
+        render_print(text);
     }
     SET_NIL_RETURN();
 }
 
 /* ==============================================
  * Method: TFT.set_backlight(level)
+ * 0 is off, 1 the dimmest, 16 (the default) the brightest
  * ============================================== */
 static void c_tft_set_backlight(mrbc_vm *vm, mrbc_value *v, int argc)
 {
@@ -182,7 +223,7 @@ static void c_tft_set_backlight(mrbc_vm *vm, mrbc_value *v, int argc)
     if (argc >= 1) {
         level = (uint8_t)GET_INT_ARG(1);
     }
-    st7789_set_backlight(level);
+    push_arg(RENDER_BACKLIGHT, level, 0);
     SET_NIL_RETURN();
 }
 
@@ -196,8 +237,7 @@ static void c_tft_draw_fast_h_line(mrbc_vm *vm, mrbc_value *v, int argc)
         int16_t y = (int16_t)GET_INT_ARG(2);
         int16_t w = (int16_t)GET_INT_ARG(3);
         uint32_t rgb888 = (uint32_t)GET_INT_ARG(4);
-        uint16_t color = rgb888_to_rgb565(rgb888);
-        st7789_draw_fast_h_line(x, y, w, color);
+        push_color(RENDER_H_LINE, x, y, w, 0, 0, rgb888);
     }
     SET_NIL_RETURN();
 }
@@ -212,8 +252,7 @@ static void c_tft_draw_fast_v_line(mrbc_vm *vm, mrbc_value *v, int argc)
         int16_t y = (int16_t)GET_INT_ARG(2);
         int16_t h = (int16_t)GET_INT_ARG(3);
         uint32_t rgb888 = (uint32_t)GET_INT_ARG(4);
-        uint16_t color = rgb888_to_rgb565(rgb888);
-        st7789_draw_fast_v_line(x, y, h, color);
+        push_color(RENDER_V_LINE, x, y, 0, h, 0, rgb888);
     }
     SET_NIL_RETURN();
 }
@@ -229,8 +268,7 @@ static void c_tft_draw_rect(mrbc_vm *vm, mrbc_value *v, int argc)
         int16_t w = (int16_t)GET_INT_ARG(3);
         int16_t h = (int16_t)GET_INT_ARG(4);
         uint32_t rgb888 = (uint32_t)GET_INT_ARG(5);
-        uint16_t color = rgb888_to_rgb565(rgb888);
-        st7789_draw_rect(x, y, w, h, color);
+        push_color(RENDER_RECT, x, y, w, h, 0, rgb888);
     }
     SET_NIL_RETURN();
 }
@@ -247,8 +285,7 @@ static void c_tft_draw_round_rect(mrbc_vm *vm, mrbc_value *v, int argc)
         int16_t h = (int16_t)GET_INT_ARG(4);
         int16_t r = (int16_t)GET_INT_ARG(5);
         uint32_t rgb888 = (uint32_t)GET_INT_ARG(6);
-        uint16_t color = rgb888_to_rgb565(rgb888);
-        st7789_draw_round_rect(x, y, w, h, r, color);
+        push_color(RENDER_ROUND_RECT, x, y, w, h, r, rgb888);
     }
     SET_NIL_RETURN();
 }
@@ -265,12 +302,93 @@ static void c_tft_fill_round_rect(mrbc_vm *vm, mrbc_value *v, int argc)
         int16_t h = (int16_t)GET_INT_ARG(4);
         int16_t r = (int16_t)GET_INT_ARG(5);
         uint32_t rgb888 = (uint32_t)GET_INT_ARG(6);
-        uint16_t color = rgb888_to_rgb565(rgb888);
-        st7789_fill_round_rect(x, y, w, h, r, color);
+        push_color(RENDER_FILL_ROUND_RECT, x, y, w, h, r, rgb888);
+    }
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: TFT.shadow?
+ * ============================================== */
+static void c_tft_shadow_p(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    render_fence();
+    if (st7789_has_shadow()) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
     }
+}
+
+/* ==============================================
+ * Method: TFT.overlay_begin
+ * Following drawing skips the shadow framebuffer
+ * ============================================== */
+static void c_tft_overlay_begin(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    push_arg(RENDER_OVERLAY_BEGIN, 0, 0);
     SET_NIL_RETURN();
 }
 
+/* ==============================================
+ * Method: TFT.overlay_end
+ * ============================================== */
+static void c_tft_overlay_end(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    push_arg(RENDER_OVERLAY_END, 0, 0);
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: TFT.restore_rect(x, y, w, h)
+ * Returns false when there is no valid shadow
+ * ============================================== */
+static void c_tft_restore_rect(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc >= 4) {
+        int16_t x = (int16_t)GET_INT_ARG(1);
+        int16_t y = (int16_t)GET_INT_ARG(2);
+        int16_t w = (int16_t)GET_INT_ARG(3);
+        int16_t h = (int16_t)GET_INT_ARG(4);
+        // Blits from the shadow, which the worker keeps: wait for it
+        render_fence();
+        if (st7789_restore_rect(x, y, w, h)) {
+            SET_TRUE_RETURN();
+            return;
+        }
+    }
+    SET_FALSE_RETURN();
+}
+
+/* ==============================================
+ * Method: TFT.fence
+ * Wait until everything drawn so far is on the panel
+ * ============================================== */
+static void c_tft_fence(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    render_fence();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: TFT.render_stats
+ * Returns: {commands:, full_waits:, fences:, fence_us:, max_depth:}
+ * ============================================== */
+static void c_tft_render_stats(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    render_stats_t st;
+    render_get_stats(&st);
+
+    mrbc_value hash = mrbc_hash_new(vm, 5);
+    hash_set_int(&hash, "commands", st.commands);
+    hash_set_int(&hash, "full_waits", st.full_waits);
+    hash_set_int(&hash, "fences", st.fences);
+    hash_set_int(&hash, "fence_us", st.fence_us);
+    hash_set_int(&hash, "max_depth", st.max_depth);
+
+    SET_RETURN(hash);
+}
+
 /* ==============================================
  * Initialize TFT class
  * ============================================== */
@@ -280,6 +398,7 @@ void mrbc_tft_init(mrbc_vm *vm)
 
     mrbc_define_method(vm, mrbc_class_TFT, "init", c_tft_init);
     mrbc_define_method(vm, mrbc_class_TFT, "begin", c_tft_begin);
+    mrbc_define_method(vm, mrbc_class_TFT, "resume", c_tft_resume);
     mrbc_define_method(vm, mrbc_class_TFT, "width", c_tft_width);
     mrbc_define_method(vm, mrbc_class_TFT, "height", c_tft_height);
     mrbc_define_method(vm, mrbc_class_TFT, "set_rotation", c_tft_set_rotation);
@@ -298,4 +417,10 @@ void mrbc_tft_init(mrbc_vm *vm)
     mrbc_define_method(vm, mrbc_class_TFT, "draw_rect", c_tft_draw_rect);
     mrbc_define_method(vm, mrbc_class_TFT, "draw_round_rect", c_tft_draw_round_rect);
     mrbc_define_method(vm, mrbc_class_TFT, "fill_round_rect", c_tft_fill_round_rect);
+    mrbc_define_method(vm, mrbc_class_TFT, "shadow?", c_tft_shadow_p);
+    mrbc_define_method(vm, mrbc_class_TFT, "overlay_begin", c_tft_overlay_begin);
+    mrbc_define_method(vm, mrbc_class_TFT, "overlay_end", c_tft_overlay_end);
+    mrbc_define_method(vm, mrbc_class_TFT, "restore_rect", c_tft_restore_rect);
+    mrbc_define_method(vm, mrbc_class_TFT, "fence", c_tft_fence);
+    mrbc_define_method(vm, mrbc_class_TFT, "render_stats", c_tft_render_stats);
 }
@@ -0,0 +1,3 @@
+# Trace class - implemented in C
+class Trace
+end
@@ -0,0 +1,373 @@
+#include "trace_log.h"
+#include "sdcard_driver.h"
+#include "document_store.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "Trace";
+
+#define TRACE_MAGIC          0x31435254u  // "TRC1"
+#define TRACE_SLOT_SECTORS   (1 + TRACE_EVENT_SECTORS)
+#define TRACE_HEADER_SECTOR(slot) (DOC_END_SECTOR + (slot) * TRACE_SLOT_SECTORS)
+
+// Bounce buffer for card transfers (events live in PSRAM)
+#define TRACE_STREAM_SIZE    4096
+
+// Header sector: magic, event count, duration, last replay result
+#define HDR_MAGIC            0
+#define HDR_COUNT            4
+#define HDR_DURATION         8
+#define HDR_RESULT           12
+
+static trace_state_t state = TRACE_IDLE;
+static int cur_slot = 0;
+static bool realtime = false;
+
+static trace_event_t *events = NULL;
+static uint32_t count = 0;
+static uint32_t pos = 0;
+static int64_t start_us = 0;
+static bool skip_pass = false;
+
+// Replay timing
+static uint32_t *pass_us = NULL;
+static uint32_t passes = 0;
+static uint32_t keys = 0;
+static bool pass_open = false;
+static int64_t pass_start = 0;
+static uint64_t handle_us = 0;
+static int64_t redraw_start = 0;
+static uint64_t redraw_us = 0;
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (v >> (i * 8)) & 0xFF;
+    }
+}
+
+static void *alloc_big(size_t size)
+{
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p == NULL) {
+        p = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return p;
+}
+
+static bool ensure_buffers(void)
+{
+    if (events == NULL) {
+        events = alloc_big(TRACE_MAX_EVENTS * sizeof(trace_event_t));
+    }
+    if (pass_us == NULL) {
+        pass_us = alloc_big(TRACE_MAX_EVENTS * sizeof(uint32_t));
+    }
+    if (events == NULL || pass_us == NULL) {
+        ESP_LOGE(TAG, "No memory for a trace");
+        return false;
+    }
+    return true;
+}
+
+static void get_result(const uint8_t *p, trace_result_t *res)
+{
+    uint32_t *f = (uint32_t *)res;
+    for (size_t i = 0; i < sizeof(*res) / 4; i++) {
+        f[i] = get_le32(p + i * 4);
+    }
+}
+
+static void put_result(uint8_t *p, const trace_result_t *res)
+{
+    const uint32_t *f = (const uint32_t *)res;
+    for (size_t i = 0; i < sizeof(*res) / 4; i++) {
+        put_le32(p + i * 4, f[i]);
+    }
+}
+
+trace_state_t trace_state(void)
+{
+    return state;
+}
+
+bool trace_record_start(int slot)
+{
+    if (slot < 0 || slot >= TRACE_SLOTS || !ensure_buffers()) {
+        return false;
+    }
+
+    state = TRACE_RECORDING;
+    cur_slot = slot;
+    count = 0;
+    start_us = esp_timer_get_time();
+    skip_pass = true;
+    return true;
+}
+
+static bool add_event(uint8_t kind, uint8_t code, int dx, int dy, bool same_pass)
+{
+    if (count >= TRACE_MAX_EVENTS) {
+        return false;
+    }
+
+    events[count++] = (trace_event_t){
+        .at_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000),
+        .kind = kind | (same_pass ? TRACE_SAME_PASS : 0),
+        .code = code,
+        .dx = (int8_t)(dx < INT8_MIN ? INT8_MIN : dx > INT8_MAX ? INT8_MAX : dx),
+        .dy = (int8_t)(dy < INT8_MIN ? INT8_MIN : dy > INT8_MAX ? INT8_MAX : dy),
+    };
+    return true;
+}
+
+bool trace_record_pass(const uint8_t *codes, size_t n, int dx, int dy)
+{
+    if (state != TRACE_RECORDING) {
+        return false;
+    }
+    if (skip_pass) {
+        skip_pass = false;
+        return true;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < n && ok; i++) {
+        ok = add_event(TRACE_KEY, codes[i], 0, 0, i > 0);
+    }
+    if (ok && (dx != 0 || dy != 0)) {
+        ok = add_event(TRACE_BALL, 0, dx, dy, n > 0);
+    }
+    return ok;
+}
+
+int trace_record_stop(void)
+{
+    if (state != TRACE_RECORDING) {
+        return -1;
+    }
+    state = TRACE_IDLE;
+
+    for (uint32_t i = count; i > 0; i--) {
+        const trace_event_t *e = &events[i - 1];
+        if ((e->kind & ~TRACE_SAME_PASS) == TRACE_KEY && e->code == ':') {
+            count = i - 1;
+            break;
+        }
+    }
+
+    uint8_t *buf = heap_caps_malloc(TRACE_STREAM_SIZE, MALLOC_CAP_DMA);
+    if (buf == NULL) {
+        return -1;
+    }
+
+    bool ok = sdcard_session_open();
+    uint32_t sector = TRACE_HEADER_SECTOR(cur_slot) + 1;
+    const uint8_t *src = (const uint8_t *)events;
+    size_t left = count * sizeof(trace_event_t);
+    while (ok && left > 0) {
+        size_t n = left < TRACE_STREAM_SIZE ? left : TRACE_STREAM_SIZE;
+        memset(buf, 0, TRACE_STREAM_SIZE);
+        memcpy(buf, src, n);
+        size_t sectors = (n + 511) / 512;
+        ok = sdcard_write_sectors(sector, buf, sectors);
+        sector += sectors;
+        src += n;
+        left -= n;
+    }
+
+    // The header goes last, so a failed save leaves no half trace behind
+    if (ok) {
+        memset(buf, 0, 512);
+        put_le32(buf + HDR_MAGIC, TRACE_MAGIC);
+        put_le32(buf + HDR_COUNT, count);
+        put_le32(buf + HDR_DURATION, count > 0 ? events[count - 1].at_ms : 0);
+        ok = sdcard_write_sectors(TRACE_HEADER_SECTOR(cur_slot), buf, 1);
+    }
+    sdcard_session_close();
+    heap_caps_free(buf);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to save trace %d", cur_slot);
+        return -1;
+    }
+    ESP_LOGI(TAG, "Saved %u events to trace %d", (unsigned)count, cur_slot);
+    return (int)count;
+}
+
+bool trace_play_start(int slot, bool at_recorded_timing)
+{
+    if (slot < 0 || slot >= TRACE_SLOTS || state != TRACE_IDLE || !ensure_buffers()) {
+        return false;
+    }
+
+    uint8_t *buf = heap_caps_malloc(TRACE_STREAM_SIZE, MALLOC_CAP_DMA);
+    if (buf == NULL) {
+        return false;
+    }
+
+    bool ok = sdcard_session_open() && sdcard_read_sectors(TRACE_HEADER_SECTOR(slot), buf, 1) &&
+              get_le32(buf + HDR_MAGIC) == TRACE_MAGIC;
+    uint32_t n = ok ? get_le32(buf + HDR_COUNT) : 0;
+    ok = ok && n > 0 && n <= TRACE_MAX_EVENTS;
+
+    uint32_t sector = TRACE_HEADER_SECTOR(slot) + 1;
+    uint8_t *dst = (uint8_t *)events;
+    size_t left = n * sizeof(trace_event_t);
+    while (ok && left > 0) {
+        size_t chunk = left < TRACE_STREAM_SIZE ? left : TRACE_STREAM_SIZE;
+        size_t sectors = (chunk + 511) / 512;
+        ok = sdcard_read_sectors(sector, buf, sectors);
+        memcpy(dst, buf, chunk);
+        sector += sectors;
+        dst += chunk;
+        left -= chunk;
+    }
+    sdcard_session_close();
+    heap_caps_free(buf);
+
+    if (!ok) {
+        return false;
+    }
+
+    state = TRACE_PLAYING;
+    cur_slot = slot;
+    realtime = at_recorded_timing;
+    count = n;
+    pos = 0;
+    passes = 0;
+    keys = 0;
+    pass_open = false;
+    handle_us = 0;
+    redraw_us = 0;
+    start_us = esp_timer_get_time();
+    return true;
+}
+
+static void end_pass(void)
+{
+    if (!pass_open) {
+        return;
+    }
+    uint32_t us = (uint32_t)(esp_timer_get_time() - pass_start);
+    pass_us[passes++] = us;
+    handle_us += us;
+    pass_open = false;
+}
+
+int trace_play_next(trace_event_t *out, int max)
+{
+    if (state != TRACE_PLAYING) {
+        return -1;
+    }
+    end_pass();
+    if (pos >= count) {
+        return -1;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (realtime && now - start_us < (int64_t)events[pos].at_ms * 1000) {
+        return 0;
+    }
+
+    int n = 0;
+    do {
+        if (n < max) {
+            out[n++] = events[pos];
+        }
+        if ((events[pos].kind & ~TRACE_SAME_PASS) == TRACE_KEY) {
+            keys++;
+        }
+        pos++;
+    } while (pos < count && (events[pos].kind & TRACE_SAME_PASS));
+
+    pass_open = true;
+    pass_start = now;
+    return n;
+}
+
+uint32_t trace_play_wait_ms(void)
+{
+    if (state != TRACE_PLAYING) {
+        return 0;
+    }
+    end_pass();
+    if (!realtime || pos >= count) {
+        return 0;
+    }
+
+    int64_t due = start_us + (int64_t)events[pos].at_ms * 1000;
+    int64_t now = esp_timer_get_time();
+    return due > now ? (uint32_t)((due - now + 999) / 1000) : 0;
+}
+
+void trace_redraw_begin(void)
+{
+    redraw_start = esp_timer_get_time();
+}
+
+void trace_redraw_end(void)
+{
+    if (state == TRACE_PLAYING) {
+        redraw_us += (uint64_t)(esp_timer_get_time() - redraw_start);
+    }
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+bool trace_play_finish(trace_result_t *res, trace_result_t *prev)
+{
+    memset(res, 0, sizeof(*res));
+    memset(prev, 0, sizeof(*prev));
+    if (state != TRACE_PLAYING) {
+        return false;
+    }
+    end_pass();
+    state = TRACE_IDLE;
+    if (passes == 0) {
+        return false;
+    }
+
+    qsort(pass_us, passes, sizeof(uint32_t), compare_u32);
+    res->passes = passes;
+    res->keys = keys;
+    res->wall_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    res->handle_ms = (uint32_t)(handle_us / 1000);
+    res->redraw_ms = (uint32_t)(redraw_us / 1000);
+    res->p50_us = pass_us[passes / 2];
+    res->p99_us = pass_us[(passes * 99) / 100];
+    res->max_us = pass_us[passes - 1];
+
+    // Keep the result next to the trace so the next build can compare
+    uint8_t *buf = heap_caps_malloc(512, MALLOC_CAP_DMA);
+    if (buf == NULL) {
+        return true;
+    }
+    if (sdcard_read_sectors(TRACE_HEADER_SECTOR(cur_slot), buf, 1) &&
+        get_le32(buf + HDR_MAGIC) == TRACE_MAGIC) {
+        get_result(buf + HDR_RESULT, prev);
+        put_result(buf + HDR_RESULT, res);
+        sdcard_write_sectors(TRACE_HEADER_SECTOR(cur_slot), buf, 1);
+    }
+    heap_caps_free(buf);
+    return true;
+}
+
+void trace_cancel(void)
+{
+    state = TRACE_IDLE;
+    pass_open = false;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Traces live in raw SD sectors after the documents:
+//   one header sector per slot, then the events
+#define TRACE_SLOTS          4
+#define TRACE_MAX_EVENTS     8192
+#define TRACE_EVENT_SECTORS  (TRACE_MAX_EVENTS * 8 / 512)
+
+// Event kinds; TRACE_SAME_PASS marks an event read in the same main loop
+// pass as the one before it (replayed together)
+#define TRACE_KEY            0
+#define TRACE_BALL           1
+#define TRACE_SAME_PASS      0x80
+
+typedef struct {
+    uint32_t at_ms;     // since the recording started
+    uint8_t kind;
+    uint8_t code;       // TRACE_KEY: key code
+    int8_t dx;          // TRACE_BALL: trackball delta
+    int8_t dy;
+} trace_event_t;
+
+typedef enum {
+    TRACE_IDLE = 0,
+    TRACE_RECORDING,
+    TRACE_PLAYING,
+} trace_state_t;
+
+trace_state_t trace_state(void);
+
+// Start recording (the pass that starts it is not recorded)
+// Returns false if there is no memory for the events
+bool trace_record_start(int slot);
+
+// Record one main loop pass (keys read and trackball delta)
+// Returns false once the trace is full
+bool trace_record_pass(const uint8_t *keys, size_t count, int dx, int dy);
+
+// Stop recording and save the trace to its slot
+// Events from the last ':' key on (the command that stopped it) are dropped
+// Returns the number of events saved, or -1 on a card error
+int trace_record_stop(void);
+
+// Start replaying a slot, at full speed or at the recorded timing
+// Returns false if the slot holds no trace
+bool trace_play_start(int slot, bool realtime);
+
+// Events of the next pass to replay, up to max
+// Returns the count, 0 when the next pass is not due yet, -1 at the end
+// Also ends the timing of the pass handed out before
+int trace_play_next(trace_event_t *out, int max);
+
+// Milliseconds until the next pass is due (0 at full speed)
+// Ends the timing of the pass handed out before
+uint32_t trace_play_wait_ms(void);
+
+// Time the redraw part of a replayed pass
+void trace_redraw_begin(void);
+void trace_redraw_end(void);
+
+typedef struct {
+    uint32_t passes;      // passes replayed
+    uint32_t keys;        // key events replayed
+    uint32_t wall_ms;     // replay start to end
+    uint32_t handle_ms;   // sum of the pass handling times
+    uint32_t redraw_ms;   // sum of the redraw times
+    uint32_t p50_us;      // pass handling time percentiles
+    uint32_t p99_us;
+    uint32_t max_us;
+} trace_result_t;
+
+// Stop replaying, compute the result and keep it in the slot header
+// prev gets the result kept from the replay before (zeroed if none)
+// Returns false if nothing was replayed
+bool trace_play_finish(trace_result_t *res, trace_result_t *prev);
+
+// Drop a recording or a replay without saving
+void trace_cancel(void);
+
+#ifdef __cplusplus
+}
+#endif
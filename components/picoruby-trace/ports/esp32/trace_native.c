@@ -0,0 +1,209 @@
+/*
+ * Trace Native mrubyc bindings
+ */
+
+#include "trace_log.h"
+#include "native_hash.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Trace = NULL;
+
+static void set_bool_return(mrbc_value *v, bool ok)
+{
+    if (ok) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+static bool slot_arg(mrbc_value *v, int argc)
+{
+    return argc >= 1 && mrbc_type(v[1]) == MRBC_TT_INTEGER &&
+           GET_INT_ARG(1) >= 0 && GET_INT_ARG(1) < TRACE_SLOTS;
+}
+
+/* ==============================================
+ * Method: Trace.record(slot)
+ * Start recording the main loop input into a trace slot (0-3)
+ * Returns: true if recording started
+ * ============================================== */
+static void c_trace_record(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    set_bool_return(v, slot_arg(v, argc) && trace_state() == TRACE_IDLE &&
+                       trace_record_start(GET_INT_ARG(1)));
+}
+
+/* ==============================================
+ * Method: Trace.pass(keys, dx, dy)
+ * Record one main loop pass: the key codes read and the trackball delta
+ * Returns: false once the trace is full
+ * ============================================== */
+static void c_trace_pass(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 3 || mrbc_type(v[1]) != MRBC_TT_ARRAY ||
+        mrbc_type(v[2]) != MRBC_TT_INTEGER || mrbc_type(v[3]) != MRBC_TT_INTEGER) {
+        SET_FALSE_RETURN();
+        return;
+    }
+
+    uint8_t codes[32];
+    int n = 0;
+    for (int i = 0; i < mrbc_array_size(&v[1]) && n < (int)sizeof(codes); i++) {
+        mrbc_value key = mrbc_array_get(&v[1], i);
+        if (mrbc_type(key) == MRBC_TT_INTEGER) {
+            codes[n++] = (uint8_t)key.i;
+        }
+    }
+    set_bool_return(v, trace_record_pass(codes, n, GET_INT_ARG(2), GET_INT_ARG(3)));
+}
+
+/* ==============================================
+ * Method: Trace.stop
+ * Stop recording and save the trace (the command typed to stop
+ * it is dropped), or drop a replay
+ * Returns: events saved, or nil
+ * ============================================== */
+static void c_trace_stop(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (trace_state() != TRACE_RECORDING) {
+        trace_cancel();
+        SET_NIL_RETURN();
+        return;
+    }
+
+    int saved = trace_record_stop();
+    if (saved < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+    SET_INT_RETURN(saved);
+}
+
+/* ==============================================
+ * Method: Trace.play(slot, realtime = false)
+ * Replay a trace slot at full speed, or at the recorded timing
+ * Returns: true if the slot holds a trace
+ * ============================================== */
+static void c_trace_play(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bool realtime = argc >= 2 && mrbc_type(v[2]) == MRBC_TT_TRUE;
+    set_bool_return(v, slot_arg(v, argc) && trace_play_start(GET_INT_ARG(1), realtime));
+}
+
+/* ==============================================
+ * Method: Trace.next
+ * Input of the next replayed pass
+ * Returns: [keys, dx, dy] ([[], 0, 0] if it is not due yet), nil at the end
+ * ============================================== */
+static void c_trace_next(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    trace_event_t ev[32];
+    int n = trace_play_next(ev, 32);
+    if (n < 0) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    mrbc_value key_list = mrbc_array_new(vm, n > 0 ? n : 1);
+    int dx = 0;
+    int dy = 0;
+    for (int i = 0; i < n; i++) {
+        if ((ev[i].kind & ~TRACE_SAME_PASS) == TRACE_KEY) {
+            mrbc_value code = mrbc_integer_value(ev[i].code);
+            mrbc_array_push(&key_list, &code);
+        } else {
+            dx += ev[i].dx;
+            dy += ev[i].dy;
+        }
+    }
+
+    mrbc_value ary = mrbc_array_new(vm, 3);
+    mrbc_array_push(&ary, &key_list);
+    mrbc_value val = mrbc_integer_value(dx);
+    mrbc_array_push(&ary, &val);
+    val = mrbc_integer_value(dy);
+    mrbc_array_push(&ary, &val);
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Method: Trace.wait_ms
+ * Ends the timing of the replayed pass (call before Event.wait)
+ * Returns: ms until the next pass is due (0 at full speed)
+ * ============================================== */
+static void c_trace_wait_ms(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN(trace_play_wait_ms());
+}
+
+/* ==============================================
+ * Method: Trace.redraw_begin
+ * Method: Trace.redraw_end
+ * Time the redraw of a replayed pass
+ * ============================================== */
+static void c_trace_redraw_begin(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    trace_redraw_begin();
+    SET_NIL_RETURN();
+}
+
+static void c_trace_redraw_end(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    trace_redraw_end();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Trace.finish
+ * End the replay and keep its result in the slot
+ * Returns: {passes:, keys:, wall_ms:, handle_ms:, redraw_ms:,
+ *           p50_us:, p99_us:, max_us:, prev_wall_ms:, prev_handle_ms:,
+ *           prev_redraw_ms:, prev_p99_us:} (prev_* 0 if not replayed before),
+ *          or nil if nothing was replayed
+ * ============================================== */
+static void c_trace_finish(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    trace_result_t res;
+    trace_result_t prev;
+    if (!trace_play_finish(&res, &prev)) {
+        SET_NIL_RETURN();
+        return;
+    }
+
+    mrbc_value hash = mrbc_hash_new(vm, 12);
+    hash_set_int(&hash, "passes", res.passes);
+    hash_set_int(&hash, "keys", res.keys);
+    hash_set_int(&hash, "wall_ms", res.wall_ms);
+    hash_set_int(&hash, "handle_ms", res.handle_ms);
+    hash_set_int(&hash, "redraw_ms", res.redraw_ms);
+    hash_set_int(&hash, "p50_us", res.p50_us);
+    hash_set_int(&hash, "p99_us", res.p99_us);
+    hash_set_int(&hash, "max_us", res.max_us);
+    hash_set_int(&hash, "prev_wall_ms", prev.wall_ms);
+    hash_set_int(&hash, "prev_handle_ms", prev.handle_ms);
+    hash_set_int(&hash, "prev_redraw_ms", prev.redraw_ms);
+    hash_set_int(&hash, "prev_p99_us", prev.p99_us);
+
+    SET_RETURN(hash);
+}
+
+/* ==============================================
+ * Initialize Trace class
+ * ============================================== */
+void mrbc_trace_init(mrbc_vm *vm)
+{
+    mrbc_class_Trace = mrbc_define_class(vm, "Trace", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Trace, "record", c_trace_record);
+    mrbc_define_method(vm, mrbc_class_Trace, "pass", c_trace_pass);
+    mrbc_define_method(vm, mrbc_class_Trace, "stop", c_trace_stop);
+    mrbc_define_method(vm, mrbc_class_Trace, "play", c_trace_play);
+    mrbc_define_method(vm, mrbc_class_Trace, "next", c_trace_next);
+    mrbc_define_method(vm, mrbc_class_Trace, "wait_ms", c_trace_wait_ms);
+    mrbc_define_method(vm, mrbc_class_Trace, "redraw_begin", c_trace_redraw_begin);
+    mrbc_define_method(vm, mrbc_class_Trace, "redraw_end", c_trace_redraw_end);
+    mrbc_define_method(vm, mrbc_class_Trace, "finish", c_trace_finish);
+}
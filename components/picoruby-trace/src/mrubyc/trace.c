@@ -0,0 +1,9 @@
+/*
+ * Trace mrubyc initialization stub
+ * Actual implementation is in ports/esp32/trace_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/trace_native.c */
+extern void mrbc_trace_init(mrbc_vm *vm);
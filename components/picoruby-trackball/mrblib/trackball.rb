@@ -0,0 +1 @@
+# Trackball class - implemented in C
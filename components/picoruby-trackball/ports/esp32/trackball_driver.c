@@ -0,0 +1,134 @@
+#include "trackball_driver.h"
+#include "event_queue.h"
+#include <stdatomic.h>
+#include "driver/gpio.h"
+#include "esp_log.h"
+
+static const char *TAG = "Trackball";
+
+static const gpio_num_t pins[4] = {
+    TRACKBALL_LEFT_PIN,
+    TRACKBALL_RIGHT_PIN,
+    TRACKBALL_UP_PIN,
+    TRACKBALL_DOWN_PIN,
+};
+
+// Free-running edge counters (written by ISR only)
+static atomic_uint edges[4];
+
+// Counter values at the previous trackball_delta call (VM only)
+static unsigned last_edges[4];
+
+// Pin levels when light sleep was entered (VM only)
+static int sleep_levels[4];
+
+static bool initialized = false;
+static uint8_t accel_threshold = 2;
+static uint8_t accel_gain = 0;
+
+// Count one step per rising edge, as the old high? polling did
+static void IRAM_ATTR trackball_isr_handler(void *arg)
+{
+    atomic_fetch_add_explicit(&edges[(intptr_t)arg], 1, memory_order_relaxed);
+    event_post_from_isr(EVENT_TRACKBALL);
+}
+
+static int take_edges(int dir)
+{
+    unsigned now = atomic_load_explicit(&edges[dir], memory_order_relaxed);
+    int count = (int)(now - last_edges[dir]);
+    last_edges[dir] = now;
+    return count;
+}
+
+static int accelerate(int d)
+{
+    int mag = d < 0 ? -d : d;
+    if (accel_gain == 0 || mag <= accel_threshold) {
+        return d;
+    }
+    mag += (mag - accel_threshold) * accel_gain;
+    return d < 0 ? -mag : mag;
+}
+
+bool trackball_init(void)
+{
+    if (initialized) {
+        return true;
+    }
+
+    gpio_config_t conf = {
+        .pin_bit_mask = (1ULL << TRACKBALL_LEFT_PIN) | (1ULL << TRACKBALL_RIGHT_PIN) |
+                        (1ULL << TRACKBALL_UP_PIN) | (1ULL << TRACKBALL_DOWN_PIN),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_POSEDGE,
+    };
+    gpio_config(&conf);
+
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to install ISR service: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        last_edges[i] = atomic_load_explicit(&edges[i], memory_order_relaxed);
+        gpio_isr_handler_add(pins[i], trackball_isr_handler, (void *)(intptr_t)i);
+    }
+
+    initialized = true;
+    ESP_LOGI(TAG, "Trackball initialized");
+    return true;
+}
+
+void trackball_delta(int *dx, int *dy)
+{
+    int left = take_edges(TRACKBALL_LEFT);
+    int right = take_edges(TRACKBALL_RIGHT);
+    int up = take_edges(TRACKBALL_UP);
+    int down = take_edges(TRACKBALL_DOWN);
+
+    *dx = accelerate(right - left);
+    *dy = accelerate(down - up);
+}
+
+void trackball_set_acceleration(uint8_t threshold, uint8_t gain)
+{
+    accel_threshold = threshold;
+    accel_gain = gain;
+}
+
+void trackball_sleep_prepare(void)
+{
+    if (!initialized) {
+        return;
+    }
+    for (int i = 0; i < 4; i++) {
+        // A level interrupt would fire until the pin is set back
+        sleep_levels[i] = gpio_get_level(pins[i]);
+        gpio_intr_disable(pins[i]);
+        gpio_wakeup_enable(pins[i], sleep_levels[i] ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    }
+}
+
+void trackball_sleep_resume(void)
+{
+    if (!initialized) {
+        return;
+    }
+    bool moved = false;
+    for (int i = 0; i < 4; i++) {
+        gpio_wakeup_disable(pins[i]);
+        gpio_set_intr_type(pins[i], GPIO_INTR_POSEDGE);
+        gpio_intr_enable(pins[i]);
+        if (sleep_levels[i] == 0 && gpio_get_level(pins[i]) == 1) {
+            atomic_fetch_add_explicit(&edges[i], 1, memory_order_relaxed);
+            moved = true;
+        }
+    }
+    if (moved) {
+        event_post(EVENT_TRACKBALL);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// T-Deck Plus trackball pins (one pulse line per direction)
+#define TRACKBALL_LEFT_PIN   1
+#define TRACKBALL_RIGHT_PIN  2
+#define TRACKBALL_UP_PIN     3
+#define TRACKBALL_DOWN_PIN   15
+
+// Direction indexes for the edge counters
+#define TRACKBALL_LEFT   0
+#define TRACKBALL_RIGHT  1
+#define TRACKBALL_UP     2
+#define TRACKBALL_DOWN   3
+
+// Configure pins and install edge-counting ISRs
+// Safe to call more than once
+bool trackball_init(void);
+
+// Accumulated movement since the previous call, acceleration applied
+// dx > 0 is right, dy > 0 is down
+void trackball_delta(int *dx, int *dy);
+
+// Acceleration curve: per-axis counts above threshold are boosted by
+// (count - threshold) * gain. gain 0 disables acceleration.
+void trackball_set_acceleration(uint8_t threshold, uint8_t gain);
+
+// Light sleep: wake the chip when any pin leaves its current level
+// (edges cannot wake it)
+void trackball_sleep_prepare(void);
+
+// Back to rising edges; a pin that rose during the sleep counts one step
+void trackball_sleep_resume(void);
+
+#ifdef __cplusplus
+}
+#endif
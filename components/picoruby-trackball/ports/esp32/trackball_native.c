@@ -0,0 +1,70 @@
+/*
+ * Trackball Native mrubyc bindings
+ */
+
+#include "trackball_driver.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Trackball = NULL;
+
+/* ==============================================
+ * Method: Trackball.init
+ * Start counting trackball edges
+ * Returns: true on success, false on failure
+ * ============================================== */
+static void c_trackball_init(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (trackball_init()) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: Trackball.delta
+ * Movement accumulated since the previous call
+ * Returns: [dx, dy] (right and down are positive)
+ * ============================================== */
+static void c_trackball_delta(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int dx = 0;
+    int dy = 0;
+    trackball_delta(&dx, &dy);
+
+    mrbc_value ary = mrbc_array_new(vm, 2);
+    mrbc_value x = mrbc_integer_value(dx);
+    mrbc_value y = mrbc_integer_value(dy);
+    mrbc_array_push(&ary, &x);
+    mrbc_array_push(&ary, &y);
+
+    SET_RETURN(ary);
+}
+
+/* ==============================================
+ * Method: Trackball.set_acceleration(threshold, gain)
+ * Boost counts above threshold by (count - threshold) * gain
+ * gain 0 disables acceleration
+ * ============================================== */
+static void c_trackball_set_acceleration(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc >= 2) {
+        uint8_t threshold = (uint8_t)GET_INT_ARG(1);
+        uint8_t gain = (uint8_t)GET_INT_ARG(2);
+        trackball_set_acceleration(threshold, gain);
+    }
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Initialize Trackball class
+ * ============================================== */
+void mrbc_trackball_init(mrbc_vm *vm)
+{
+    mrbc_class_Trackball = mrbc_define_class(vm, "Trackball", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Trackball, "init", c_trackball_init);
+    mrbc_define_method(vm, mrbc_class_Trackball, "delta", c_trackball_delta);
+    mrbc_define_method(vm, mrbc_class_Trackball, "set_acceleration", c_trackball_set_acceleration);
+}
@@ -0,0 +1,9 @@
+/*
+ * Trackball mrubyc initialization stub
+ * Actual implementation is in ports/esp32/trackball_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/trackball_native.c */
+extern void mrbc_trackball_init(mrbc_vm *vm);
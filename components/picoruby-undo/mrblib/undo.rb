@@ -0,0 +1,3 @@
+# Undo class - implemented in C
+class Undo
+end
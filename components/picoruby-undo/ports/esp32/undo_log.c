@@ -0,0 +1,349 @@
+#include "undo_log.h"
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char *TAG = "Undo";
+
+// Records are packed back to back in the arena:
+//   header, a_len + b_len bytes of payload, u16 record size
+// The trailing size lets undo walk backwards. Records before pos can be
+// undone, records between pos and used can be redone.
+typedef struct {
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t line;
+    uint16_t a;        // INSERT / DELETE: column, LINES: old line count
+    uint16_t b;        // LINES: new line count
+    uint16_t a_len;    // INSERT / DELETE: text, LINES: old block
+    uint16_t b_len;    // LINES: new block
+} rec_t;
+
+#define REC_JOINED  0x01   // undone / redone with the record before it
+
+static uint8_t *arena = NULL;
+static uint32_t used = 0;
+static uint32_t pos = 0;
+static bool open = false;   // last record may still grow
+static uint32_t undo_count = 0;
+static uint32_t redo_count = 0;
+static uint32_t evicted = 0;
+static bool paused = false;  // edits are dropped, see undo_pause
+
+static uint32_t rec_size(const rec_t *r)
+{
+    return sizeof(rec_t) + r->a_len + r->b_len + 2;
+}
+
+static void read_rec(uint32_t at, rec_t *r)
+{
+    memcpy(r, arena + at, sizeof(rec_t));
+}
+
+static void write_rec(uint32_t at, const rec_t *r)
+{
+    uint16_t size = (uint16_t)rec_size(r);
+    memcpy(arena + at, r, sizeof(rec_t));
+    memcpy(arena + at + size - 2, &size, 2);
+}
+
+// Start of the record that ends at end
+static uint32_t rec_before(uint32_t end)
+{
+    uint16_t size;
+    memcpy(&size, arena + end - 2, 2);
+    return end - size;
+}
+
+static bool ensure_arena(void)
+{
+    if (arena == NULL) {
+        arena = heap_caps_malloc(UNDO_ARENA_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (arena == NULL) {
+            arena = heap_caps_malloc(UNDO_ARENA_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }
+        if (arena == NULL) {
+            ESP_LOGE(TAG, "No memory for the undo log");
+        }
+    }
+    return arena != NULL;
+}
+
+// Drop the oldest record, and the rest of its group
+static void evict_first(void)
+{
+    rec_t r;
+    do {
+        read_rec(0, &r);
+        uint32_t size = rec_size(&r);
+        memmove(arena, arena + size, used - size);
+        used -= size;
+        pos -= size;
+        undo_count--;
+        evicted++;
+        if (used > 0) {
+            read_rec(0, &r);
+        }
+    } while (used > 0 && (r.flags & REC_JOINED));
+}
+
+// Append a record after pos (dropping the redo history), returns its payload
+static uint8_t *append(const rec_t *r)
+{
+    uint32_t size = rec_size(r);
+    if (size > UNDO_ARENA_SIZE || !ensure_arena()) {
+        // Older history cannot be undone past an edit that was not logged
+        undo_clear();
+        return NULL;
+    }
+
+    used = pos;
+    redo_count = 0;
+    while (used + size > UNDO_ARENA_SIZE) {
+        evict_first();
+    }
+
+    uint32_t at = used;
+    write_rec(at, r);
+    used += size;
+    pos = used;
+    undo_count++;
+    open = false;
+    return arena + at + sizeof(rec_t);
+}
+
+// Record that new typing may be merged into
+static bool last_open(rec_t *r, uint32_t *at)
+{
+    if (!open || pos == 0 || pos != used) {
+        return false;
+    }
+    *at = rec_before(pos);
+    read_rec(*at, r);
+    return true;
+}
+
+bool undo_insert(uint16_t line, uint16_t col, const char *text, size_t len)
+{
+    if (paused) {
+        return false;
+    }
+    if (len == 0) {
+        return true;
+    }
+
+    rec_t r;
+    uint32_t at;
+    if (last_open(&r, &at) && r.kind == UNDO_INSERT && r.line == line &&
+        col == r.a + r.a_len && r.a_len + len <= UINT16_MAX && used + len <= UNDO_ARENA_SIZE) {
+        memcpy(arena + used - 2, text, len);
+        r.a_len += len;
+        write_rec(at, &r);
+        used += len;
+        pos = used;
+        return true;
+    }
+
+    if (len > UINT16_MAX) {
+        undo_clear();
+        return false;
+    }
+    r = (rec_t){ .kind = UNDO_INSERT, .line = line, .a = col, .a_len = (uint16_t)len };
+    uint8_t *p = append(&r);
+    if (p == NULL) {
+        return false;
+    }
+    memcpy(p, text, len);
+    open = true;
+    return true;
+}
+
+bool undo_delete(uint16_t line, uint16_t col, const char *text, size_t len)
+{
+    if (paused) {
+        return false;
+    }
+    if (len == 0) {
+        return true;
+    }
+
+    rec_t r;
+    uint32_t at;
+    if (last_open(&r, &at) && r.kind == UNDO_DELETE && r.line == line &&
+        col + len == r.a && r.a_len + len <= UINT16_MAX && used + len <= UNDO_ARENA_SIZE) {
+        // Backspacing: the new text goes in front
+        uint8_t *payload = arena + at + sizeof(rec_t);
+        memmove(payload + len, payload, r.a_len);
+        memcpy(payload, text, len);
+        r.a = col;
+        r.a_len += len;
+        write_rec(at, &r);
+        used += len;
+        pos = used;
+        return true;
+    }
+
+    if (len > UINT16_MAX) {
+        undo_clear();
+        return false;
+    }
+    r = (rec_t){ .kind = UNDO_DELETE, .line = line, .a = col, .a_len = (uint16_t)len };
+    uint8_t *p = append(&r);
+    if (p == NULL) {
+        return false;
+    }
+    memcpy(p, text, len);
+    open = true;
+    return true;
+}
+
+uint8_t *undo_lines(uint16_t line, uint16_t old_count, uint16_t new_count,
+                    size_t old_len, size_t new_len, bool joined)
+{
+    if (paused) {
+        return NULL;
+    }
+    if (old_len > UINT16_MAX || new_len > UINT16_MAX) {
+        undo_clear();
+        return NULL;
+    }
+
+    rec_t r = {
+        .kind = UNDO_LINES,
+        .flags = joined ? REC_JOINED : 0,
+        .line = line,
+        .a = old_count,
+        .b = new_count,
+        .a_len = (uint16_t)old_len,
+        .b_len = (uint16_t)new_len,
+    };
+    return append(&r);
+}
+
+uint8_t *undo_put_line(uint8_t *p, int indent, const char *text, size_t len)
+{
+    p[0] = (uint8_t)(indent < 0 ? 0 : indent > 255 ? 255 : indent);
+    p[1] = (uint8_t)(len & 0xFF);
+    p[2] = (uint8_t)(len >> 8);
+    memcpy(p + 3, text, len);
+    return p + UNDO_LINE_BYTES(len);
+}
+
+const uint8_t *undo_get_line(const uint8_t *p, int *indent, const char **text, size_t *len)
+{
+    *indent = p[0];
+    *len = p[1] | (p[2] << 8);
+    *text = (const char *)(p + 3);
+    return p + UNDO_LINE_BYTES(*len);
+}
+
+void undo_seal(void)
+{
+    open = false;
+}
+
+void undo_pause(bool on)
+{
+    paused = on;
+    open = false;
+}
+
+int undo_undo(undo_apply_fn apply, void *ctx)
+{
+    int count = 0;
+    open = false;
+
+    while (pos > 0) {
+        uint32_t at = rec_before(pos);
+        rec_t r;
+        read_rec(at, &r);
+        const uint8_t *payload = arena + at + sizeof(rec_t);
+
+        undo_op_t op = { .line = r.line, .col = r.a };
+        switch (r.kind) {
+        case UNDO_INSERT:
+            op.kind = UNDO_DELETE;
+            op.count = r.a_len;
+            break;
+        case UNDO_DELETE:
+            op.kind = UNDO_INSERT;
+            op.data = payload;
+            op.len = r.a_len;
+            break;
+        default:
+            // Put the old lines back in place of the new ones
+            op.kind = UNDO_LINES;
+            op.col = r.b;
+            op.count = r.a;
+            op.data = payload;
+            op.len = r.a_len;
+            break;
+        }
+        apply(ctx, &op);
+
+        pos = at;
+        undo_count--;
+        redo_count++;
+        count++;
+        if (!(r.flags & REC_JOINED)) {
+            break;
+        }
+    }
+    return count;
+}
+
+int undo_redo(undo_apply_fn apply, void *ctx)
+{
+    int count = 0;
+    open = false;
+
+    while (pos < used) {
+        rec_t r;
+        read_rec(pos, &r);
+        if (count > 0 && !(r.flags & REC_JOINED)) {
+            break;
+        }
+        const uint8_t *payload = arena + pos + sizeof(rec_t);
+
+        undo_op_t op = { .kind = r.kind, .line = r.line, .col = r.a };
+        switch (r.kind) {
+        case UNDO_INSERT:
+            op.data = payload;
+            op.len = r.a_len;
+            break;
+        case UNDO_DELETE:
+            op.count = r.a_len;
+            break;
+        default:
+            op.count = r.b;
+            op.data = payload + r.a_len;
+            op.len = r.b_len;
+            break;
+        }
+        apply(ctx, &op);
+
+        pos += rec_size(&r);
+        undo_count++;
+        redo_count--;
+        count++;
+    }
+    return count;
+}
+
+void undo_clear(void)
+{
+    used = 0;
+    pos = 0;
+    open = false;
+    undo_count = 0;
+    redo_count = 0;
+}
+
+void undo_get_stats(undo_stats_t *st)
+{
+    st->size = UNDO_ARENA_SIZE;
+    st->used = used;
+    st->undo = undo_count;
+    st->redo = redo_count;
+    st->evicted = evicted;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bytes of edit history (oldest operations are evicted when full)
+#ifndef UNDO_ARENA_SIZE
+#define UNDO_ARENA_SIZE  16384
+#endif
+
+// Operation kinds
+// Lines are numbered like the editor's code_lines, the new line last
+#define UNDO_INSERT  0   // text inserted at line / col
+#define UNDO_DELETE  1   // text deleted at line / col
+#define UNDO_LINES   2   // count lines at line replaced by other lines
+
+// Bytes one line takes in a UNDO_LINES block
+#define UNDO_LINE_BYTES(len)  (3 + (len))
+
+// One operation to apply to the buffer (see undo_undo / undo_redo)
+typedef struct {
+    uint8_t kind;
+    uint16_t line;
+    uint16_t col;          // INSERT / DELETE: column, LINES: lines to remove
+    uint16_t count;        // DELETE: bytes to delete, LINES: lines to insert
+    const uint8_t *data;   // INSERT: text, LINES: block of lines to insert
+    uint16_t len;          // bytes at data
+} undo_op_t;
+
+typedef void (*undo_apply_fn)(void *ctx, const undo_op_t *op);
+
+// Record a typed / deleted run of text
+// Inserts right after the previous insert (and backspaces right before the
+// previous delete) are merged into it until undo_seal
+bool undo_insert(uint16_t line, uint16_t col, const char *text, size_t len);
+bool undo_delete(uint16_t line, uint16_t col, const char *text, size_t len);
+
+// Record a line replacement: returns where to write the old block
+// (old_len bytes) followed by the new block (new_len bytes), see undo_put_line
+// joined = undone / redone together with the previous operation
+// Returns NULL if it does not fit (the history is dropped) or while paused
+uint8_t *undo_lines(uint16_t line, uint16_t old_count, uint16_t new_count,
+                    size_t old_len, size_t new_len, bool joined);
+
+// Write one line of a block, returns the position after it
+uint8_t *undo_put_line(uint8_t *p, int indent, const char *text, size_t len);
+
+// Read one line of a block, returns the position after it
+const uint8_t *undo_get_line(const uint8_t *p, int *indent, const char **text, size_t *len);
+
+// Stop merging into the last operation (cursor moved)
+void undo_seal(void);
+
+// Drop edits instead of recording them until undo_pause(false), for
+// changes outside the buffer the history describes (seals the last one)
+void undo_pause(bool on);
+
+// Pass the operations that revert (or repeat) the last step to apply
+// Returns the number of operations, 0 if there is nothing to undo / redo
+int undo_undo(undo_apply_fn apply, void *ctx);
+int undo_redo(undo_apply_fn apply, void *ctx);
+
+void undo_clear(void);
+
+typedef struct {
+    uint32_t size;      // arena bytes
+    uint32_t used;      // bytes of undo and redo history
+    uint32_t undo;      // operations that can be undone
+    uint32_t redo;      // operations that can be redone
+    uint32_t evicted;   // operations dropped because the arena was full
+} undo_stats_t;
+
+void undo_get_stats(undo_stats_t *st);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,277 @@
+/*
+ * Undo Native mrubyc bindings
+ */
+
+#include "undo_log.h"
+#include "native_hash.h"
+#include <mrubyc.h>
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_Undo = NULL;
+
+static void set_bool_return(mrbc_value *v, bool ok)
+{
+    if (ok) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+static bool text_edit_args(mrbc_value *v, int argc)
+{
+    return argc >= 3 &&
+           mrbc_type(v[1]) == MRBC_TT_INTEGER && GET_INT_ARG(1) >= 0 && GET_INT_ARG(1) <= UINT16_MAX &&
+           mrbc_type(v[2]) == MRBC_TT_INTEGER && GET_INT_ARG(2) >= 0 && GET_INT_ARG(2) <= UINT16_MAX &&
+           mrbc_type(v[3]) == MRBC_TT_STRING;
+}
+
+// {text:, indent:} entry of a code_lines style array
+static bool line_at(const mrbc_value *ary, int i, int *indent, const char **text, size_t *len)
+{
+    mrbc_value line = mrbc_array_get(ary, i);
+    if (mrbc_type(line) != MRBC_TT_HASH) {
+        return false;
+    }
+
+    mrbc_value key = mrbc_symbol_value(mrbc_str_to_symid("text"));
+    mrbc_value str = mrbc_hash_get(&line, &key);
+    if (mrbc_type(str) != MRBC_TT_STRING) {
+        return false;
+    }
+    key = mrbc_symbol_value(mrbc_str_to_symid("indent"));
+    mrbc_value ind = mrbc_hash_get(&line, &key);
+
+    *indent = mrbc_type(ind) == MRBC_TT_INTEGER ? (int)ind.i : 0;
+    *text = mrbc_string_cstr(&str);
+    *len = mrbc_string_size(&str);
+    return true;
+}
+
+// Bytes the lines take in the log, or -1 if one is not {text:, indent:}
+static int block_size(const mrbc_value *ary)
+{
+    int size = 0;
+    for (int i = 0; i < mrbc_array_size(ary); i++) {
+        int indent;
+        const char *text;
+        size_t len;
+        if (!line_at(ary, i, &indent, &text, &len)) {
+            return -1;
+        }
+        size += UNDO_LINE_BYTES(len);
+    }
+    return size;
+}
+
+static uint8_t *put_block(uint8_t *p, const mrbc_value *ary)
+{
+    for (int i = 0; i < mrbc_array_size(ary); i++) {
+        int indent;
+        const char *text;
+        size_t len;
+        line_at(ary, i, &indent, &text, &len);
+        p = undo_put_line(p, indent, text, len);
+    }
+    return p;
+}
+
+/* ==============================================
+ * Method: Undo.insert(line, col, text)
+ * Method: Undo.delete(line, col, text)
+ * Record typed / deleted text (runs of typing are merged)
+ * Returns: true if it was logged
+ * ============================================== */
+static void c_undo_insert(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bool ok = text_edit_args(v, argc) &&
+              undo_insert(GET_INT_ARG(1), GET_INT_ARG(2), (const char *)GET_STRING_ARG(3), mrbc_string_size(&v[3]));
+    set_bool_return(v, ok);
+}
+
+static void c_undo_delete(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    bool ok = text_edit_args(v, argc) &&
+              undo_delete(GET_INT_ARG(1), GET_INT_ARG(2), (const char *)GET_STRING_ARG(3), mrbc_string_size(&v[3]));
+    set_bool_return(v, ok);
+}
+
+/* ==============================================
+ * Method: Undo.lines(line, old_lines, new_lines, joined = false)
+ * Record old_lines at line being replaced by new_lines
+ * (arrays of {text:, indent:}), joined = undo with the previous edit
+ * Returns: true if it was logged
+ * ============================================== */
+static void c_undo_lines(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 3 || mrbc_type(v[1]) != MRBC_TT_INTEGER || GET_INT_ARG(1) < 0 || GET_INT_ARG(1) > UINT16_MAX ||
+        mrbc_type(v[2]) != MRBC_TT_ARRAY || mrbc_type(v[3]) != MRBC_TT_ARRAY ||
+        mrbc_array_size(&v[2]) > UINT16_MAX || mrbc_array_size(&v[3]) > UINT16_MAX) {
+        SET_FALSE_RETURN();
+        return;
+    }
+
+    int old_len = block_size(&v[2]);
+    int new_len = block_size(&v[3]);
+    if (old_len < 0 || new_len < 0) {
+        SET_FALSE_RETURN();
+        return;
+    }
+
+    bool joined = argc >= 4 && mrbc_type(v[4]) == MRBC_TT_TRUE;
+    uint8_t *p = undo_lines(GET_INT_ARG(1), mrbc_array_size(&v[2]), mrbc_array_size(&v[3]),
+                            old_len, new_len, joined);
+    if (p == NULL) {
+        SET_FALSE_RETURN();
+        return;
+    }
+    p = put_block(p, &v[2]);
+    put_block(p, &v[3]);
+    SET_TRUE_RETURN();
+}
+
+/* ==============================================
+ * Method: Undo.seal
+ * Start a new step (call when the cursor moves)
+ * ============================================== */
+static void c_undo_seal(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    undo_seal();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Undo.pause
+ * Method: Undo.resume
+ * Stop / start recording edits (for typing outside the buffer)
+ * ============================================== */
+static void c_undo_pause(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    undo_pause(true);
+    SET_NIL_RETURN();
+}
+
+static void c_undo_resume(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    undo_pause(false);
+    SET_NIL_RETURN();
+}
+
+typedef struct {
+    mrbc_vm *vm;
+    mrbc_value ops;
+} apply_ctx_t;
+
+// [0, line, col, text], [1, line, col, len] or [2, line, count, [{text:, indent:}, ...]]
+static void push_op(void *ctx, const undo_op_t *op)
+{
+    apply_ctx_t *c = ctx;
+    mrbc_value item = mrbc_array_new(c->vm, 4);
+    mrbc_value val = mrbc_integer_value(op->kind);
+    mrbc_array_push(&item, &val);
+    val = mrbc_integer_value(op->line);
+    mrbc_array_push(&item, &val);
+    val = mrbc_integer_value(op->col);
+    mrbc_array_push(&item, &val);
+
+    if (op->kind == UNDO_INSERT) {
+        val = mrbc_string_new(c->vm, op->data, op->len);
+    } else if (op->kind == UNDO_DELETE) {
+        val = mrbc_integer_value(op->count);
+    } else {
+        val = mrbc_array_new(c->vm, op->count);
+        const uint8_t *p = op->data;
+        for (int i = 0; i < op->count; i++) {
+            int indent;
+            const char *text;
+            size_t len;
+            p = undo_get_line(p, &indent, &text, &len);
+
+            mrbc_value line = mrbc_hash_new(c->vm, 2);
+            mrbc_value k = mrbc_symbol_value(mrbc_str_to_symid("text"));
+            mrbc_value s = mrbc_string_new(c->vm, text, len);
+            mrbc_hash_set(&line, &k, &s);
+            hash_set_int(&line, "indent", indent);
+            mrbc_array_push(&val, &line);
+        }
+    }
+    mrbc_array_push(&item, &val);
+    mrbc_array_push(&c->ops, &item);
+}
+
+/* ==============================================
+ * Method: Undo.undo
+ * Method: Undo.redo
+ * Returns: the edits to apply to the buffer, in order, or nil
+ *   [0, line, col, text]   insert text
+ *   [1, line, col, len]    delete len bytes
+ *   [2, line, count, lines] replace count lines by lines ({text:, indent:})
+ * ============================================== */
+static void return_ops(mrbc_vm *vm, mrbc_value *v, bool redo)
+{
+    apply_ctx_t ctx = { .vm = vm, .ops = mrbc_array_new(vm, 1) };
+    int n = redo ? undo_redo(push_op, &ctx) : undo_undo(push_op, &ctx);
+    if (n == 0) {
+        mrbc_decref(&ctx.ops);
+        SET_NIL_RETURN();
+        return;
+    }
+    SET_RETURN(ctx.ops);
+}
+
+static void c_undo_undo(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    return_ops(vm, v, false);
+}
+
+static void c_undo_redo(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    return_ops(vm, v, true);
+}
+
+/* ==============================================
+ * Method: Undo.clear
+ * ============================================== */
+static void c_undo_clear(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    undo_clear();
+    SET_NIL_RETURN();
+}
+
+/* ==============================================
+ * Method: Undo.stats
+ * Returns: {size:, used:, undo:, redo:, evicted:}
+ * ============================================== */
+static void c_undo_stats(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    undo_stats_t st;
+    undo_get_stats(&st);
+
+    mrbc_value hash = mrbc_hash_new(vm, 5);
+    hash_set_int(&hash, "size", st.size);
+    hash_set_int(&hash, "used", st.used);
+    hash_set_int(&hash, "undo", st.undo);
+    hash_set_int(&hash, "redo", st.redo);
+    hash_set_int(&hash, "evicted", st.evicted);
+
+    SET_RETURN(hash);
+}
+
+/* ==============================================
+ * Initialize Undo class
+ * ============================================== */
+void mrbc_undo_init(mrbc_vm *vm)
+{
+    mrbc_class_Undo = mrbc_define_class(vm, "Undo", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_Undo, "insert", c_undo_insert);
+    mrbc_define_method(vm, mrbc_class_Undo, "delete", c_undo_delete);
+    mrbc_define_method(vm, mrbc_class_Undo, "lines", c_undo_lines);
+    mrbc_define_method(vm, mrbc_class_Undo, "seal", c_undo_seal);
+    mrbc_define_method(vm, mrbc_class_Undo, "pause", c_undo_pause);
+    mrbc_define_method(vm, mrbc_class_Undo, "resume", c_undo_resume);
+    mrbc_define_method(vm, mrbc_class_Undo, "undo", c_undo_undo);
+    mrbc_define_method(vm, mrbc_class_Undo, "redo", c_undo_redo);
+    mrbc_define_method(vm, mrbc_class_Undo, "clear", c_undo_clear);
+    mrbc_define_method(vm, mrbc_class_Undo, "stats", c_undo_stats);
+}
@@ -0,0 +1,9 @@
+/*
+ * Undo mrubyc initialization stub
+ * Actual implementation is in ports/esp32/undo_native.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/esp32/undo_native.c */
+extern void mrbc_undo_init(mrbc_vm *vm);
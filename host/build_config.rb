@@ -0,0 +1,42 @@
+# PicoRuby for the headless host build (host/CMakeLists.txt)
+# Same gems as build_config/xtensa-esp.rb, with the stand-ins in host/gems
+# for the hardware classes the editor uses
+
+MRuby::Build.new('host-editor') do |conf|
+  conf.toolchain :gcc
+
+  # Keep in sync with PICORUBY_DEFINES in host/CMakeLists.txt
+  conf.cc.defines << 'PICORB_VM_MRUBYC'
+  conf.cc.defines << 'MRBC_USE_HAL_POSIX'
+  conf.cc.defines << 'MRBC_USE_FLOAT=2'
+  conf.cc.defines << 'MRBC_CONVERT_CRLF=1'
+
+  conf.picoruby(alloc_libc: false)
+
+  conf.gembox 'minimum'
+  conf.gembox 'core'
+  conf.gembox 'shell'
+  conf.gem core: 'picoruby-sandbox'
+
+  conf.gem File.expand_path('gems/picoruby-gpio', __dir__)
+  conf.gem File.expand_path('gems/picoruby-adc', __dir__)
+
+  conf.gem File.expand_path('../components/picoruby-sdcard', __dir__)
+  conf.gem File.expand_path('../components/picoruby-tft', __dir__)
+  conf.gem File.expand_path('../components/picoruby-keyboard', __dir__)
+  conf.gem File.expand_path('../components/picoruby-trackball', __dir__)
+  conf.gem File.expand_path('../components/picoruby-event', __dir__)
+  conf.gem File.expand_path('../components/picoruby-memory', __dir__)
+  conf.gem File.expand_path('../components/picoruby-console', __dir__)
+  conf.gem File.expand_path('../components/picoruby-inspect', __dir__)
+  conf.gem File.expand_path('../components/picoruby-document', __dir__)
+  conf.gem File.expand_path('../components/picoruby-search', __dir__)
+  conf.gem File.expand_path('../components/picoruby-undo', __dir__)
+  conf.gem File.expand_path('../components/picoruby-checker', __dir__)
+  conf.gem File.expand_path('../components/picoruby-trace', __dir__)
+  conf.gem File.expand_path('../components/picoruby-perf', __dir__)
+  conf.gem File.expand_path('../components/picoruby-bench', __dir__)
+  conf.gem File.expand_path('../components/picoruby-session', __dir__)
+  conf.gem File.expand_path('../components/picoruby-lazy', __dir__)
+  conf.gem File.expand_path('../components/picoruby-power', __dir__)
+end
@@ -0,0 +1,3 @@
+# ADC class (host stand-in) - implemented in C
+class ADC
+end
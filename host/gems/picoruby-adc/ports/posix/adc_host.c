@@ -0,0 +1,70 @@
+/*
+ * ADC stand-in for the host build
+ * Inputs read the millivolts set on the emulated board (host_adc_set_mv)
+ */
+
+#include "host_board.h"
+#include <mrubyc.h>
+
+// 12 bit conversion over 0..3.3 V
+#define ADC_MAX_RAW   4095
+#define ADC_FULL_MV   3300
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_ADC = NULL;
+
+static int self_pin(mrbc_value *v)
+{
+    return *(int *)v[0].instance->data;
+}
+
+/* ==============================================
+ * Method: ADC.new(pin)
+ * Returns: ADC instance
+ * ============================================== */
+static void c_adc_new(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_INTEGER) {
+        mrbc_raise(vm, MRBC_CLASS(ArgumentError), "invalid pin");
+        return;
+    }
+
+    mrbc_value obj = mrbc_instance_new(vm, v[0].cls, sizeof(int));
+    *(int *)obj.instance->data = GET_INT_ARG(1);
+    SET_RETURN(obj);
+}
+
+/* ==============================================
+ * Method: ADC#read_voltage (alias: read)
+ * Returns: volts (Float)
+ * ============================================== */
+static void c_adc_read_voltage(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_FLOAT_RETURN(host_adc_get_mv(self_pin(v)) / 1000.0);
+}
+
+/* ==============================================
+ * Method: ADC#read_raw
+ * Returns: 0..4095
+ * ============================================== */
+static void c_adc_read_raw(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int mv = host_adc_get_mv(self_pin(v));
+    if (mv > ADC_FULL_MV) {
+        mv = ADC_FULL_MV;
+    }
+    SET_INT_RETURN(mv < 0 ? 0 : mv * ADC_MAX_RAW / ADC_FULL_MV);
+}
+
+/* ==============================================
+ * Initialize ADC class
+ * ============================================== */
+void mrbc_adc_init(mrbc_vm *vm)
+{
+    mrbc_class_ADC = mrbc_define_class(vm, "ADC", mrbc_class_object);
+
+    mrbc_define_method(vm, mrbc_class_ADC, "new", c_adc_new);
+    mrbc_define_method(vm, mrbc_class_ADC, "read_voltage", c_adc_read_voltage);
+    mrbc_define_method(vm, mrbc_class_ADC, "read", c_adc_read_voltage);
+    mrbc_define_method(vm, mrbc_class_ADC, "read_raw", c_adc_read_raw);
+}
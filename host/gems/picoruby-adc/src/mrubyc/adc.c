@@ -0,0 +1,9 @@
+/*
+ * ADC mrubyc initialization stub
+ * Actual implementation is in ports/posix/adc_host.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/posix/adc_host.c */
+extern void mrbc_adc_init(mrbc_vm *vm);
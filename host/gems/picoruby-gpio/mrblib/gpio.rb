@@ -0,0 +1,3 @@
+# GPIO class (host stand-in) - implemented in C
+class GPIO
+end
@@ -0,0 +1,152 @@
+/*
+ * GPIO stand-in for the host build
+ * Pins are the levels of the emulated board (driver/gpio.h)
+ */
+
+#include "driver/gpio.h"
+#include <stdbool.h>
+#include <mrubyc.h>
+
+// Flags as in picoruby-gpio
+#define GPIO_IN          0x01
+#define GPIO_OUT         0x02
+#define GPIO_HIGH_Z      0x04
+#define GPIO_PULL_UP     0x08
+#define GPIO_PULL_DOWN   0x10
+#define GPIO_OPEN_DRAIN  0x20
+
+// mrubyc class pointer
+mrbc_class *mrbc_class_GPIO = NULL;
+
+static bool pin_arg(mrbc_value *v, int argc, int *pin)
+{
+    if (argc < 1 || mrbc_type(v[1]) != MRBC_TT_INTEGER ||
+        GET_INT_ARG(1) < 0 || GET_INT_ARG(1) >= GPIO_NUM_MAX) {
+        return false;
+    }
+    *pin = GET_INT_ARG(1);
+    return true;
+}
+
+static int self_pin(mrbc_value *v)
+{
+    return *(int *)v[0].instance->data;
+}
+
+static void set_level_return(mrbc_value *v, int level, int want)
+{
+    if (level == want) {
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+/* ==============================================
+ * Method: GPIO.new(pin, flags)
+ * Returns: GPIO instance
+ * ============================================== */
+static void c_gpio_new(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int pin;
+    if (!pin_arg(v, argc, &pin)) {
+        mrbc_raise(vm, MRBC_CLASS(ArgumentError), "invalid pin");
+        return;
+    }
+
+    int flags = argc >= 2 && mrbc_type(v[2]) == MRBC_TT_INTEGER ? GET_INT_ARG(2) : GPIO_IN;
+    gpio_set_direction(pin, (flags & GPIO_OUT) ? GPIO_MODE_OUTPUT : GPIO_MODE_INPUT);
+    if (flags & GPIO_PULL_UP) {
+        gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+    }
+
+    mrbc_value obj = mrbc_instance_new(vm, v[0].cls, sizeof(int));
+    *(int *)obj.instance->data = pin;
+    SET_RETURN(obj);
+}
+
+/* ==============================================
+ * Method: GPIO#write(level)
+ * Method: GPIO#read
+ * Method: GPIO#high? / GPIO#low?
+ * ============================================== */
+static void c_gpio_write(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int level = argc >= 1 && mrbc_type(v[1]) == MRBC_TT_INTEGER ? GET_INT_ARG(1) : 0;
+    gpio_set_level(self_pin(v), level);
+    SET_INT_RETURN(0);
+}
+
+static void c_gpio_read(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    SET_INT_RETURN(gpio_get_level(self_pin(v)));
+}
+
+static void c_gpio_high(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    set_level_return(v, gpio_get_level(self_pin(v)), 1);
+}
+
+static void c_gpio_low(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    set_level_return(v, gpio_get_level(self_pin(v)), 0);
+}
+
+/* ==============================================
+ * Method: GPIO.pull_up_at(pin)
+ * Method: GPIO.read_at(pin)
+ * Method: GPIO.write_at(pin, level)
+ * ============================================== */
+static void c_gpio_pull_up_at(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int pin;
+    if (pin_arg(v, argc, &pin)) {
+        gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+    }
+    SET_NIL_RETURN();
+}
+
+static void c_gpio_read_at(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int pin;
+    SET_INT_RETURN(pin_arg(v, argc, &pin) ? gpio_get_level(pin) : 0);
+}
+
+static void c_gpio_write_at(mrbc_vm *vm, mrbc_value *v, int argc)
+{
+    int pin;
+    if (pin_arg(v, argc, &pin) && argc >= 2 && mrbc_type(v[2]) == MRBC_TT_INTEGER) {
+        gpio_set_level(pin, GET_INT_ARG(2));
+    }
+    SET_INT_RETURN(0);
+}
+
+static void set_const(const char *name, int value)
+{
+    mrbc_value val = mrbc_integer_value(value);
+    mrbc_set_class_const(mrbc_class_GPIO, mrbc_str_to_symid(name), &val);
+}
+
+/* ==============================================
+ * Initialize GPIO class
+ * ============================================== */
+void mrbc_gpio_init(mrbc_vm *vm)
+{
+    mrbc_class_GPIO = mrbc_define_class(vm, "GPIO", mrbc_class_object);
+
+    set_const("IN", GPIO_IN);
+    set_const("OUT", GPIO_OUT);
+    set_const("HIGH_Z", GPIO_HIGH_Z);
+    set_const("PULL_UP", GPIO_PULL_UP);
+    set_const("PULL_DOWN", GPIO_PULL_DOWN);
+    set_const("OPEN_DRAIN", GPIO_OPEN_DRAIN);
+
+    mrbc_define_method(vm, mrbc_class_GPIO, "new", c_gpio_new);
+    mrbc_define_method(vm, mrbc_class_GPIO, "write", c_gpio_write);
+    mrbc_define_method(vm, mrbc_class_GPIO, "read", c_gpio_read);
+    mrbc_define_method(vm, mrbc_class_GPIO, "high?", c_gpio_high);
+    mrbc_define_method(vm, mrbc_class_GPIO, "low?", c_gpio_low);
+    mrbc_define_method(vm, mrbc_class_GPIO, "pull_up_at", c_gpio_pull_up_at);
+    mrbc_define_method(vm, mrbc_class_GPIO, "read_at", c_gpio_read_at);
+    mrbc_define_method(vm, mrbc_class_GPIO, "write_at", c_gpio_write_at);
+}
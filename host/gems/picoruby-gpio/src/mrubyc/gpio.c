@@ -0,0 +1,9 @@
+/*
+ * GPIO mrubyc initialization stub
+ * Actual implementation is in ports/posix/gpio_host.c
+ */
+
+#include <mrubyc.h>
+
+/* Forward declaration - implemented in ports/posix/gpio_host.c */
+extern void mrbc_gpio_init(mrbc_vm *vm);
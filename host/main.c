@@ -0,0 +1,321 @@
+/*
+ * Headless host build of the editor
+ *
+ * app.rb runs on the mruby/c VM against the emulated board (shim/), and a
+ * script drives the keyboard and trackball, one command per line:
+ *
+ *   key <text>      type text, \n = Return, \b = Backspace, \e = Esc,
+ *                   \t = Tab, \xHH = any code, \\ = backslash
+ *   code <n> ...    send raw keyboard codes
+ *   ball <dx> <dy>  roll the trackball
+ *   adc <pin> <mv>  set an ADC input (battery = pin 4)
+ *   wait <ms>       let time pass (timers, the background check)
+ *   idle [ms]       wait until the VM sleeps in Event.wait
+ *   dump <file>     write the panel as a PPM to the frame directory
+ *   quit [status]
+ *
+ * Lines starting with # are comments. For each step the time until the VM
+ * sleeps again and the pixels sent to the panel are printed.
+ */
+
+#include <inttypes.h>
+#include <nvs_flash.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "picoruby.h"
+#include <mrubyc.h>
+#include "memory_heap.h"
+#include "trackball_driver.h"
+#include "render_queue.h"
+#include "host_board.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lazy_loader.h"
+#include "mrb/app.c"
+#include "mrb/lazy_welcome.c"
+#include "mrb/lazy_slots.c"
+#include "mrb/lazy_completion.c"
+#include "mrb/lazy_commands.c"
+#include "mrb/lazy_document.c"
+#include "mrb/lazy_status.c"
+
+// Longest a step may keep the VM busy
+#define STEP_TIMEOUT_MS   10000
+
+#define LINE_MAX_LEN      1024
+
+// Same modules as main/main.c
+static const lazy_module_t lazy_modules[] = {
+    { "welcome", lazy_welcome },
+    { "slots", lazy_slots },
+    { "completion", lazy_completion },
+    { "commands", lazy_commands },
+    { "document", lazy_document },
+    { "status", lazy_status },
+};
+
+typedef struct {
+    FILE *script;
+    const char *frame_dir;
+    int step;
+    int failures;
+    int status;     // quit <status>
+} runner_t;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-s script] [-c card.img] [-f flash.img] [-o frame_dir] [-v]\n"
+            "  -s  session script (default: stdin)\n"
+            "  -c  SD card image, created if missing (default: sdcard.img)\n"
+            "  -f  storage partition image, created if missing (default: in memory)\n"
+            "  -o  directory for dump files (default: .)\n"
+            "  -v  show ESP_LOGI output\n",
+            prog);
+}
+
+static void report(runner_t *r, const char *cmd, const char *arg, int64_t start_us, bool ok)
+{
+    double ms = (esp_timer_get_time() - start_us) / 1000.0;
+    printf("%4d %-5s %9.2f ms %8" PRIu32 " px  %s%s\n", r->step, cmd, ms, host_panel_take_written(),
+           arg, ok ? "" : "  (timeout)");
+    fflush(stdout);
+    if (!ok) {
+        r->failures++;
+    }
+}
+
+// The render worker may still be drawing when the VM sleeps
+static bool render_settle(void)
+{
+    int64_t deadline = esp_timer_get_time() + STEP_TIMEOUT_MS * 1000LL;
+    while (!render_idle()) {
+        if (esp_timer_get_time() > deadline) {
+            return false;
+        }
+        usleep(100);
+    }
+    return true;
+}
+
+// Run one input and wait until the editor has handled it
+static bool settle_after(void (*input)(int, int), int a, int b)
+{
+    uint32_t since = host_vm_wakeups();
+    input(a, b);
+    return host_vm_settle(since, STEP_TIMEOUT_MS) && render_settle();
+}
+
+static void press_key(int code, int unused)
+{
+    host_keyboard_push((uint8_t)code);
+}
+
+static void roll_ball(int pin, int count)
+{
+    for (int i = 0; i < count; i++) {
+        host_gpio_pulse(pin);
+    }
+}
+
+static int parse_escape(const char **p)
+{
+    const char *s = *p;
+    *p = s + 1;
+    switch (*s) {
+    case 'n': return 13;
+    case 'b': return 8;
+    case 'e': return 27;
+    case 't': return 9;
+    case 'x': {
+        char hex[3] = { 0 };
+        char *end;
+        strncpy(hex, s + 1, 2);
+        long code = strtol(hex, &end, 16);
+        if (end == hex) {
+            return 'x';
+        }
+        *p = s + 1 + (end - hex);
+        return (int)code;
+    }
+    default: return (uint8_t)*s;
+    }
+}
+
+static bool run_key(runner_t *r, const char *text)
+{
+    int64_t start = esp_timer_get_time();
+    int64_t worst = 0;
+    int count = 0;
+    bool ok = true;
+
+    for (const char *p = text; *p != '\0' && ok;) {
+        int code;
+        if (*p == '\\' && p[1] != '\0') {
+            p++;
+            code = parse_escape(&p);
+        } else {
+            code = (uint8_t)*p++;
+        }
+
+        int64_t t = esp_timer_get_time();
+        ok = settle_after(press_key, code, 0);
+        int64_t us = esp_timer_get_time() - t;
+        worst = us > worst ? us : worst;
+        count++;
+    }
+
+    char arg[LINE_MAX_LEN + 64];
+    snprintf(arg, sizeof(arg), "%s  (%d keys, max %.2f ms)", text, count, worst / 1000.0);
+    report(r, "key", arg, start, ok);
+    return ok;
+}
+
+static bool run_line(runner_t *r, char *line)
+{
+    char *cmd = strtok(line, " \t");
+    char *rest = strtok(NULL, "");
+    if (cmd == NULL || cmd[0] == '#') {
+        return true;
+    }
+    rest = rest != NULL ? rest : "";
+    r->step++;
+
+    int64_t start = esp_timer_get_time();
+    if (strcmp(cmd, "key") == 0) {
+        run_key(r, rest);
+    } else if (strcmp(cmd, "code") == 0) {
+        bool ok = true;
+        for (char *tok = strtok(rest, " \t"); tok != NULL && ok; tok = strtok(NULL, " \t")) {
+            ok = settle_after(press_key, (int)strtol(tok, NULL, 0), 0);
+        }
+        report(r, cmd, "", start, ok);
+    } else if (strcmp(cmd, "ball") == 0) {
+        int dx = 0, dy = 0;
+        sscanf(rest, "%d %d", &dx, &dy);
+        uint32_t since = host_vm_wakeups();
+        roll_ball(dx < 0 ? TRACKBALL_LEFT_PIN : TRACKBALL_RIGHT_PIN, abs(dx));
+        roll_ball(dy < 0 ? TRACKBALL_UP_PIN : TRACKBALL_DOWN_PIN, abs(dy));
+        bool ok = (dx == 0 && dy == 0) || (host_vm_settle(since, STEP_TIMEOUT_MS) && render_settle());
+        report(r, cmd, rest, start, ok);
+    } else if (strcmp(cmd, "adc") == 0) {
+        int pin = 0, mv = 0;
+        sscanf(rest, "%d %d", &pin, &mv);
+        host_adc_set_mv(pin, mv);
+        report(r, cmd, rest, start, true);
+    } else if (strcmp(cmd, "wait") == 0) {
+        usleep((useconds_t)atoi(rest) * 1000);
+        report(r, cmd, rest, start, true);
+    } else if (strcmp(cmd, "idle") == 0) {
+        int ms = rest[0] != '\0' ? atoi(rest) : STEP_TIMEOUT_MS;
+        bool ok = host_vm_wait_idle(ms) && render_settle();
+        report(r, cmd, rest, start, ok);
+    } else if (strcmp(cmd, "dump") == 0) {
+        char path[LINE_MAX_LEN + 256];
+        snprintf(path, sizeof(path), "%s/%s", r->frame_dir, rest);
+        report(r, cmd, path, start, render_settle() && host_panel_dump_ppm(path));
+    } else if (strcmp(cmd, "quit") == 0) {
+        r->status = atoi(rest);
+        return false;
+    } else {
+        fprintf(stderr, "unknown command: %s\n", cmd);
+        r->failures++;
+    }
+    return true;
+}
+
+static void *runner_task(void *arg)
+{
+    runner_t *r = arg;
+
+    // Boot: app.rb is ready once it first sleeps in Event.wait
+    int64_t start = esp_timer_get_time();
+    report(r, "boot", "", start, host_vm_wait_idle(STEP_TIMEOUT_MS) && render_settle());
+
+    char line[LINE_MAX_LEN];
+    while (fgets(line, sizeof(line), r->script) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!run_line(r, line)) {
+            break;
+        }
+    }
+
+    host_sdcard_close();
+    fflush(stdout);
+    exit(r->status != 0 ? r->status : r->failures > 0 ? 1 : 0);
+    return NULL;
+}
+
+static void initialize_nvs(void)
+{
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+}
+
+int main(int argc, char **argv)
+{
+    static runner_t runner = { .frame_dir = "." };
+    const char *script = NULL;
+    const char *card = "sdcard.img";
+    const char *flash = NULL;
+    int opt;
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+    while ((opt = getopt(argc, argv, "s:c:f:o:vh")) != -1) {
+        switch (opt) {
+        case 's': script = optarg; break;
+        case 'c': card = optarg; break;
+        case 'f': flash = optarg; break;
+        case 'o': runner.frame_dir = optarg; break;
+        case 'v': esp_log_level_set("*", ESP_LOG_INFO); break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+
+    runner.script = script != NULL ? fopen(script, "r") : stdin;
+    if (runner.script == NULL) {
+        perror(script);
+        return 2;
+    }
+    host_sdcard_open(card);
+    if (flash != NULL && !host_flash_open(flash)) {
+        return 2;
+    }
+
+    // The script runs beside the VM, as the keyboard and trackball would
+    pthread_t thread;
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    pthread_create(&thread, NULL, runner_task, &runner);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    initialize_nvs();
+
+    size_t heap_size = 0;
+    uint8_t *heap_pool = memory_heap_alloc(&heap_size);
+    if (heap_pool == NULL) {
+        return 1;
+    }
+    mrbc_init(heap_pool, heap_size);
+    lazy_register(lazy_modules, sizeof(lazy_modules) / sizeof(lazy_modules[0]));
+
+    mrbc_tcb *main_tcb = mrbc_create_task(app, 0);
+    mrbc_set_task_name(main_tcb, "app");
+    mrbc_vm *vm = &main_tcb->vm;
+
+    picoruby_init_require(vm);
+    mrbc_run();
+
+    // app.rb ended (an exception at top level)
+    fprintf(stderr, "app.rb stopped\n");
+    return 1;
+}
@@ -0,0 +1,765 @@
+// The T-Deck hardware behind the driver stand-ins: GPIO levels and
+// interrupts, the ST7789 panel, the keyboard controller, the SD card and
+// the storage partition of the flash
+#include "host_board.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "driver/i2c_master.h"
+#include "driver/sdspi_host.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "Board";
+
+// GPIO
+
+typedef struct {
+    gpio_int_type_t intr_type;
+    bool masked;            // gpio_intr_disable
+    gpio_isr_t handler;
+    void *arg;
+} pin_isr_t;
+
+static uint8_t pin_levels[GPIO_NUM_MAX];
+static pin_isr_t pin_isrs[GPIO_NUM_MAX];
+static bool isr_service = false;
+static int adc_mv[GPIO_NUM_MAX];
+static pthread_mutex_t gpio_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool valid_pin(int pin)
+{
+    return pin >= 0 && pin < GPIO_NUM_MAX;
+}
+
+esp_err_t gpio_config(const gpio_config_t *conf)
+{
+    pthread_mutex_lock(&gpio_lock);
+    for (int pin = 0; pin < GPIO_NUM_MAX; pin++) {
+        if (conf->pin_bit_mask & (1ULL << pin)) {
+            pin_isrs[pin].intr_type = conf->intr_type;
+            if (conf->mode == GPIO_MODE_INPUT && conf->pull_up_en) {
+                pin_levels[pin] = 1;
+            }
+        }
+    }
+    pthread_mutex_unlock(&gpio_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t pin)
+{
+    return valid_pin(pin) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode)
+{
+    return valid_pin(pin) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t pin, gpio_pull_mode_t pull)
+{
+    if (!valid_pin(pin)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (pull == GPIO_PULLUP_ONLY) {
+        pin_levels[pin] = 1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    if (!valid_pin(pin)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pin_levels[pin] = level ? 1 : 0;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin)
+{
+    return valid_pin(pin) ? pin_levels[pin] : 0;
+}
+
+// Nothing resets or sleeps on the host, so held pins need no state
+esp_err_t gpio_hold_en(gpio_num_t pin)
+{
+    return valid_pin(pin) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_hold_dis(gpio_num_t pin)
+{
+    return valid_pin(pin) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t intr_type)
+{
+    if (!valid_pin(pin)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&gpio_lock);
+    pin_isrs[pin].intr_type = intr_type;
+    pthread_mutex_unlock(&gpio_lock);
+    return ESP_OK;
+}
+
+static esp_err_t set_masked(gpio_num_t pin, bool masked)
+{
+    if (!valid_pin(pin)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&gpio_lock);
+    pin_isrs[pin].masked = masked;
+    pthread_mutex_unlock(&gpio_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t pin)
+{
+    return set_masked(pin, false);
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin)
+{
+    return set_masked(pin, true);
+}
+
+// As on the chip, the wake-up level becomes the interrupt type
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t intr_type)
+{
+    return gpio_set_intr_type(pin, intr_type);
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t pin)
+{
+    return valid_pin(pin) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    pthread_mutex_lock(&gpio_lock);
+    bool installed = isr_service;
+    isr_service = true;
+    pthread_mutex_unlock(&gpio_lock);
+    return installed ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t handler, void *arg)
+{
+    if (!valid_pin(pin) || !isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_lock(&gpio_lock);
+    pin_isrs[pin].handler = handler;
+    pin_isrs[pin].arg = arg;
+    pthread_mutex_unlock(&gpio_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t pin)
+{
+    return gpio_isr_handler_add(pin, NULL, NULL);
+}
+
+void host_gpio_pulse(int pin)
+{
+    if (!valid_pin(pin)) {
+        return;
+    }
+    pthread_mutex_lock(&gpio_lock);
+    pin_isr_t isr = pin_isrs[pin];
+    pthread_mutex_unlock(&gpio_lock);
+
+    if (isr.handler != NULL && isr.intr_type != GPIO_INTR_DISABLE && !isr.masked) {
+        isr.handler(isr.arg);
+    }
+}
+
+void host_adc_set_mv(int pin, int mv)
+{
+    if (valid_pin(pin)) {
+        adc_mv[pin] = mv + 1;   // 0 = never set
+    }
+}
+
+int host_adc_get_mv(int pin)
+{
+    if (!valid_pin(pin) || adc_mv[pin] == 0) {
+        return HOST_ADC_DEFAULT_MV;
+    }
+    return adc_mv[pin] - 1;
+}
+
+// ST7789 panel: decodes the command stream sent to the panel CS
+
+#define PANEL_LONG      320
+#define PANEL_SHORT     240
+
+#define CMD_CASET       0x2A
+#define CMD_RASET       0x2B
+#define CMD_RAMWR       0x2C
+#define CMD_MADCTL      0x36
+#define MADCTL_MV       0x20
+
+typedef struct {
+    uint16_t pixels[PANEL_LONG * PANEL_SHORT];
+    uint8_t madctl;
+    uint8_t cmd;
+    uint8_t args[4];
+    int argc;
+    int x0, x1, y0, y1;     // address window
+    int x, y;               // RAMWR position
+    int high;               // first byte of a pixel, -1 if none
+    uint32_t written;
+} panel_t;
+
+static panel_t panel = { .madctl = MADCTL_MV, .high = -1 };
+static pthread_mutex_t panel_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int panel_width(void)
+{
+    return (panel.madctl & MADCTL_MV) ? PANEL_LONG : PANEL_SHORT;
+}
+
+static int panel_height(void)
+{
+    return (panel.madctl & MADCTL_MV) ? PANEL_SHORT : PANEL_LONG;
+}
+
+static void panel_pixel(uint16_t color)
+{
+    if (panel.y > panel.y1) {
+        return;
+    }
+    if (panel.x >= 0 && panel.x < panel_width() && panel.y >= 0 && panel.y < panel_height()) {
+        panel.pixels[panel.y * panel_width() + panel.x] = color;
+    }
+    panel.written++;
+    if (++panel.x > panel.x1) {
+        panel.x = panel.x0;
+        panel.y++;
+    }
+}
+
+static void panel_command(uint8_t cmd)
+{
+    panel.cmd = cmd;
+    panel.argc = 0;
+    if (cmd == CMD_RAMWR) {
+        panel.x = panel.x0;
+        panel.y = panel.y0;
+        panel.high = -1;
+    }
+}
+
+static void panel_data(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = data[i];
+        switch (panel.cmd) {
+        case CMD_RAMWR:
+            if (panel.high < 0) {
+                panel.high = b;
+            } else {
+                panel_pixel((uint16_t)(panel.high << 8 | b));
+                panel.high = -1;
+            }
+            break;
+        case CMD_CASET:
+        case CMD_RASET:
+            if (panel.argc < 4) {
+                panel.args[panel.argc++] = b;
+            }
+            if (panel.argc == 4) {
+                int start = panel.args[0] << 8 | panel.args[1];
+                int end = panel.args[2] << 8 | panel.args[3];
+                if (panel.cmd == CMD_CASET) {
+                    panel.x0 = start;
+                    panel.x1 = end;
+                } else {
+                    panel.y0 = start;
+                    panel.y1 = end;
+                }
+            }
+            break;
+        case CMD_MADCTL:
+            panel.madctl = b;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void host_panel_size(int *width, int *height)
+{
+    pthread_mutex_lock(&panel_lock);
+    *width = panel_width();
+    *height = panel_height();
+    pthread_mutex_unlock(&panel_lock);
+}
+
+const uint16_t *host_panel_pixels(void)
+{
+    return panel.pixels;
+}
+
+uint32_t host_panel_take_written(void)
+{
+    pthread_mutex_lock(&panel_lock);
+    uint32_t n = panel.written;
+    panel.written = 0;
+    pthread_mutex_unlock(&panel_lock);
+    return n;
+}
+
+bool host_panel_dump_ppm(const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "Cannot write %s", path);
+        return false;
+    }
+
+    pthread_mutex_lock(&panel_lock);
+    int w = panel_width();
+    int h = panel_height();
+    fprintf(fp, "P6\n%d %d\n255\n", w, h);
+    for (int i = 0; i < w * h; i++) {
+        uint16_t c = panel.pixels[i];
+        uint8_t rgb[3] = {
+            (uint8_t)((c >> 11) * 255 / 31),
+            (uint8_t)(((c >> 5) & 0x3F) * 255 / 63),
+            (uint8_t)((c & 0x1F) * 255 / 31),
+        };
+        fwrite(rgb, 1, 3, fp);
+    }
+    pthread_mutex_unlock(&panel_lock);
+
+    return fclose(fp) == 0;
+}
+
+// SPI: only the panel listens, other devices (radio) are ignored
+
+#define HOST_SPI_QUEUE_MAX 16
+
+struct spi_device_t {
+    int cs;
+    int clock_hz;
+    int queue_size;
+    transaction_cb_t pre_cb;
+    transaction_cb_t post_cb;
+    spi_transaction_t *done[HOST_SPI_QUEUE_MAX];
+    int done_head;
+    int done_count;
+};
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config,
+                             spi_dma_chan_t dma_chan)
+{
+    static bool initialized[3];
+    if (initialized[host_id]) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    initialized[host_id] = true;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id)
+{
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle)
+{
+    struct spi_device_t *dev = calloc(1, sizeof(*dev));
+    if (dev == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    dev->cs = dev_config->spics_io_num;
+    dev->clock_hz = dev_config->clock_speed_hz;
+    dev->queue_size = dev_config->queue_size < HOST_SPI_QUEUE_MAX ? dev_config->queue_size
+                                                                 : HOST_SPI_QUEUE_MAX;
+    dev->pre_cb = dev_config->pre_cb;
+    dev->post_cb = dev_config->post_cb;
+    *handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    if (handle == NULL || trans_desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (handle->pre_cb != NULL) {
+        handle->pre_cb(trans_desc);
+    }
+    if (handle->cs == HOST_PANEL_CS) {
+        const uint8_t *tx = (trans_desc->flags & SPI_TRANS_USE_TXDATA) ? trans_desc->tx_data
+                                                                        : trans_desc->tx_buffer;
+        size_t len = trans_desc->length / 8;
+
+        pthread_mutex_lock(&panel_lock);
+        if (gpio_get_level(HOST_PANEL_DC) == 0) {
+            for (size_t i = 0; i < len; i++) {
+                panel_command(tx[i]);
+            }
+        } else if (tx != NULL) {
+            panel_data(tx, len);
+        }
+        pthread_mutex_unlock(&panel_lock);
+    }
+    if (handle->post_cb != NULL) {
+        handle->post_cb(trans_desc);
+    }
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    return spi_device_polling_transmit(handle, trans_desc);
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans_desc,
+                                 TickType_t ticks_to_wait)
+{
+    if (handle == NULL || trans_desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handle->done_count >= handle->queue_size) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret = spi_device_polling_transmit(handle, trans_desc);
+    if (ret == ESP_OK) {
+        int tail = (handle->done_head + handle->done_count) % HOST_SPI_QUEUE_MAX;
+        handle->done[tail] = trans_desc;
+        handle->done_count++;
+    }
+    return ret;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans_desc,
+                                      TickType_t ticks_to_wait)
+{
+    if (handle == NULL || trans_desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handle->done_count == 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    *trans_desc = handle->done[handle->done_head];
+    handle->done_head = (handle->done_head + 1) % HOST_SPI_QUEUE_MAX;
+    handle->done_count--;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_actual_freq(spi_device_handle_t handle, int *freq_khz)
+{
+    if (handle == NULL || freq_khz == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *freq_khz = handle->clock_hz / 1000;
+    return ESP_OK;
+}
+
+// Keyboard controller: answers each read with the next queued code, 0 when empty
+
+#define KEY_QUEUE_SIZE  256
+
+static uint8_t key_queue[KEY_QUEUE_SIZE];
+static unsigned key_head = 0;
+static unsigned key_tail = 0;
+static pthread_mutex_t key_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct i2c_master_bus_t {
+    int port;
+};
+
+struct i2c_master_dev_t {
+    uint16_t address;
+};
+
+void host_keyboard_push(uint8_t code)
+{
+    pthread_mutex_lock(&key_lock);
+    if (key_head - key_tail < KEY_QUEUE_SIZE) {
+        key_queue[key_head++ % KEY_QUEUE_SIZE] = code;
+    }
+    pthread_mutex_unlock(&key_lock);
+    host_gpio_pulse(HOST_KEYBOARD_INT);
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle)
+{
+    struct i2c_master_bus_t *bus = calloc(1, sizeof(*bus));
+    if (bus == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    bus->port = bus_config->i2c_port;
+    *ret_bus_handle = bus;
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle)
+{
+    free(bus_handle);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config,
+                                    i2c_master_dev_handle_t *ret_handle)
+{
+    struct i2c_master_dev_t *dev = calloc(1, sizeof(*dev));
+    if (dev == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    dev->address = dev_config->device_address;
+    *ret_handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle)
+{
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t handle, uint8_t *read_buffer, size_t read_size,
+                             int xfer_timeout_ms)
+{
+    pthread_mutex_lock(&key_lock);
+    for (size_t i = 0; i < read_size; i++) {
+        read_buffer[i] = key_tail != key_head ? key_queue[key_tail++ % KEY_QUEUE_SIZE] : 0;
+    }
+    pthread_mutex_unlock(&key_lock);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t handle, const uint8_t *write_buffer, size_t write_size,
+                              int xfer_timeout_ms)
+{
+    return ESP_OK;
+}
+
+// SD card: 512 byte sectors of the image file
+
+#define SECTOR_SIZE     512
+#define CARD_SECTORS    (32 * 1024 * 1024 / SECTOR_SIZE * 1024)   // 32 GB
+
+static int card_fd = -1;
+static pthread_mutex_t card_lock = PTHREAD_MUTEX_INITIALIZER;
+
+bool host_sdcard_open(const char *path)
+{
+    host_sdcard_close();
+    card_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (card_fd < 0) {
+        ESP_LOGE(TAG, "Cannot open card image %s", path);
+        return false;
+    }
+    return true;
+}
+
+void host_sdcard_close(void)
+{
+    if (card_fd >= 0) {
+        close(card_fd);
+        card_fd = -1;
+    }
+}
+
+esp_err_t sdspi_host_init_device(const sdspi_device_config_t *dev_config, sdspi_dev_handle_t *out_handle)
+{
+    *out_handle = dev_config->gpio_cs;
+    return ESP_OK;
+}
+
+esp_err_t sdspi_host_remove_device(sdspi_dev_handle_t handle)
+{
+    return ESP_OK;
+}
+
+esp_err_t sdmmc_card_init(const sdmmc_host_t *host, sdmmc_card_t *out_card)
+{
+    if (card_fd < 0) {
+        return ESP_ERR_TIMEOUT;     // no card in the slot
+    }
+    memset(out_card, 0, sizeof(*out_card));
+    out_card->host = *host;
+    out_card->csd.capacity = CARD_SECTORS;
+    out_card->csd.sector_size = SECTOR_SIZE;
+    out_card->max_freq_khz = host->max_freq_khz;
+    return ESP_OK;
+}
+
+void sdmmc_card_print_info(FILE *stream, const sdmmc_card_t *card)
+{
+    fprintf(stream, "Name: HOST\nType: SDHC (image file)\nSize: %lluMB\n",
+            (unsigned long long)card->csd.capacity * card->csd.sector_size / (1024 * 1024));
+}
+
+esp_err_t sdmmc_read_sectors(sdmmc_card_t *card, void *dst, size_t start_sector, size_t sector_count)
+{
+    if (start_sector + sector_count > (size_t)card->csd.capacity) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    pthread_mutex_lock(&card_lock);
+    size_t len = sector_count * SECTOR_SIZE;
+    ssize_t n = pread(card_fd, dst, len, (off_t)start_sector * SECTOR_SIZE);
+    pthread_mutex_unlock(&card_lock);
+    if (n < 0) {
+        return ESP_FAIL;
+    }
+    // Never written: erased card
+    memset((uint8_t *)dst + n, 0, len - (size_t)n);
+    return ESP_OK;
+}
+
+esp_err_t sdmmc_write_sectors(sdmmc_card_t *card, const void *src, size_t start_sector, size_t sector_count)
+{
+    if (start_sector + sector_count > (size_t)card->csd.capacity) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    pthread_mutex_lock(&card_lock);
+    size_t len = sector_count * SECTOR_SIZE;
+    ssize_t n = pwrite(card_fd, src, len, (off_t)start_sector * SECTOR_SIZE);
+    pthread_mutex_unlock(&card_lock);
+    return n == (ssize_t)len ? ESP_OK : ESP_FAIL;
+}
+
+// Flash: the storage partition, kept in memory and written through to
+// the image file when one is open
+
+#define FLASH_SECTOR    4096
+
+static const esp_partition_t storage = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = ESP_PARTITION_SUBTYPE_DATA_FAT,
+    .address = 0x210000,
+    .size = 1024 * 1024,
+    .erase_size = FLASH_SECTOR,
+    .label = "storage",
+};
+
+static uint8_t *flash;
+static int flash_fd = -1;
+static pthread_mutex_t flash_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool flash_ready(void)
+{
+    if (flash == NULL) {
+        flash = malloc(storage.size);
+        if (flash == NULL) {
+            return false;
+        }
+        memset(flash, 0xFF, storage.size);
+    }
+    return true;
+}
+
+bool host_flash_open(const char *path)
+{
+    pthread_mutex_lock(&flash_lock);
+    bool ok = flash_ready();
+    if (ok) {
+        flash_fd = open(path, O_RDWR | O_CREAT, 0644);
+        ok = flash_fd >= 0;
+    }
+    if (ok) {
+        // A new or short image reads as erased past its end
+        ssize_t n = pread(flash_fd, flash, storage.size, 0);
+        n = n < 0 ? 0 : n;
+        memset(flash + n, 0xFF, storage.size - (size_t)n);
+        ok = pwrite(flash_fd, flash, storage.size, 0) == (ssize_t)storage.size;
+    }
+    pthread_mutex_unlock(&flash_lock);
+    if (!ok) {
+        ESP_LOGE(TAG, "Cannot open flash image %s", path);
+    }
+    return ok;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype, const char *label)
+{
+    if (type != storage.type || (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != storage.subtype) ||
+        (label != NULL && strcmp(label, storage.label) != 0)) {
+        return NULL;
+    }
+    pthread_mutex_lock(&flash_lock);
+    bool ok = flash_ready();
+    pthread_mutex_unlock(&flash_lock);
+    return ok ? &storage : NULL;
+}
+
+static bool flash_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    return partition == &storage && offset <= storage.size && size <= storage.size - offset;
+}
+
+static void flash_sync(size_t offset, size_t size)
+{
+    if (flash_fd >= 0 && pwrite(flash_fd, flash + offset, size, (off_t)offset) != (ssize_t)size) {
+        ESP_LOGE(TAG, "Flash image write failed");
+    }
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (!flash_range(partition, src_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    pthread_mutex_lock(&flash_lock);
+    memcpy(dst, flash + src_offset, size);
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src,
+                              size_t size)
+{
+    if (!flash_range(partition, dst_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // NOR flash: programming only clears bits
+    pthread_mutex_lock(&flash_lock);
+    const uint8_t *p = src;
+    for (size_t i = 0; i < size; i++) {
+        flash[dst_offset + i] &= p[i];
+    }
+    flash_sync(dst_offset, size);
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (!flash_range(partition, offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (offset % FLASH_SECTOR != 0 || size % FLASH_SECTOR != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&flash_lock);
+    memset(flash + offset, 0xFF, size);
+    flash_sync(offset, size);
+    pthread_mutex_unlock(&flash_lock);
+    return ESP_OK;
+}
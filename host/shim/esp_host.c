@@ -0,0 +1,414 @@
+// esp_err, esp_log, esp_timer, the cycle counter, heap_caps, NVS, the ROM
+// delay and the reset reason on the host
+#include "esp_err.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "nvs_flash.h"
+#include "esp_system.h"
+#include "esp_rom_sys.h"
+#include "sdkconfig.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// esp_err
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                        return "ESP_OK";
+    case ESP_FAIL:                      return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_FOUND:         return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_NO_FREE_PAGES:     return "ESP_ERR_NVS_NO_FREE_PAGES";
+    case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+    default:                            return "UNKNOWN ERROR";
+    }
+}
+
+// esp_log
+
+static esp_log_level_t log_level = ESP_LOG_WARN;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > log_level) {
+        return;
+    }
+
+    flockfile(stderr);
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    va_list ap;
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    funlockfile(stderr);
+}
+
+// esp_timer
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint64_t period_us;     // 0 = one shot
+    uint64_t due_us;
+    bool active;
+};
+
+static struct timespec start_time;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+
+static void init_start_time(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    pthread_once(&start_once, init_start_time);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - start_time.tv_sec) * 1000000 + (now.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ns = (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+    return (esp_cpu_cycle_count_t)(ns * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ / 1000);
+}
+
+static void timespec_from_us(struct timespec *ts, uint64_t us)
+{
+    pthread_once(&start_once, init_start_time);
+    uint64_t ns = (uint64_t)start_time.tv_nsec + (us % 1000000) * 1000;
+    ts->tv_sec = start_time.tv_sec + (time_t)(us / 1000000) + (time_t)(ns / 1000000000);
+    ts->tv_nsec = (long)(ns % 1000000000);
+}
+
+// Callbacks run on the timer's own thread, as on the esp_timer task
+static void *timer_thread(void *arg)
+{
+    esp_timer_handle_t timer = arg;
+    pthread_mutex_lock(&timer->lock);
+    for (;;) {
+        if (!timer->active) {
+            pthread_cond_wait(&timer->cond, &timer->lock);
+            continue;
+        }
+
+        struct timespec due;
+        timespec_from_us(&due, timer->due_us);
+        if (pthread_cond_timedwait(&timer->cond, &timer->lock, &due) != ETIMEDOUT ||
+            !timer->active || (uint64_t)esp_timer_get_time() < timer->due_us) {
+            continue;
+        }
+
+        if (timer->period_us > 0) {
+            timer->due_us += timer->period_us;
+        } else {
+            timer->active = false;
+        }
+        pthread_mutex_unlock(&timer->lock);
+        timer->callback(timer->arg);
+        pthread_mutex_lock(&timer->lock);
+    }
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (args == NULL || args->callback == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_timer_handle_t timer = calloc(1, sizeof(*timer));
+    if (timer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    pthread_mutex_init(&timer->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int ret = pthread_create(&timer->thread, NULL, timer_thread, timer);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (ret != 0) {
+        free(timer);
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_detach(timer->thread);
+
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t timer, uint64_t after_us, uint64_t period_us)
+{
+    pthread_mutex_lock(&timer->lock);
+    if (timer->active) {
+        pthread_mutex_unlock(&timer->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    timer->period_us = period_us;
+    timer->due_us = (uint64_t)esp_timer_get_time() + after_us;
+    pthread_cond_signal(&timer->cond);
+    pthread_mutex_unlock(&timer->lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return timer_start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer->lock);
+    bool was_active = timer->active;
+    timer->active = false;
+    pthread_cond_signal(&timer->cond);
+    pthread_mutex_unlock(&timer->lock);
+    return was_active ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    // The thread keeps the handle, a deleted timer just never fires again
+    return esp_timer_stop(timer) == ESP_OK ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer->lock);
+    bool active = timer->active;
+    pthread_mutex_unlock(&timer->lock);
+    return active;
+}
+
+// heap_caps
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    return realloc(ptr, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_total_size(uint32_t caps)
+{
+    return (caps & MALLOC_CAP_SPIRAM) ? HOST_HEAP_SPIRAM_SIZE : HOST_HEAP_INTERNAL_SIZE;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return heap_caps_get_total_size(caps);
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return heap_caps_get_total_size(caps);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return heap_caps_get_total_size(caps);
+}
+
+// NVS: a small table of namespace / key / value entries
+
+#define NVS_MAX_ENTRIES   64
+#define NVS_NAME_MAX      16
+
+typedef struct {
+    char ns[NVS_NAME_MAX];
+    char key[NVS_NAME_MAX];
+    uint32_t value;
+    bool used;
+} nvs_entry_t;
+
+#define NVS_MAX_HANDLES   8
+
+static nvs_entry_t nvs_entries[NVS_MAX_ENTRIES];
+static char nvs_handles[NVS_MAX_HANDLES][NVS_NAME_MAX];
+static bool nvs_handle_writable[NVS_MAX_HANDLES];
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&nvs_lock);
+    memset(nvs_entries, 0, sizeof(nvs_entries));
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (strlen(namespace_name) >= NVS_NAME_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&nvs_lock);
+    for (int i = 0; i < NVS_MAX_HANDLES; i++) {
+        if (nvs_handles[i][0] == '\0') {
+            strcpy(nvs_handles[i], namespace_name);
+            nvs_handle_writable[i] = open_mode == NVS_READWRITE;
+            pthread_mutex_unlock(&nvs_lock);
+            *out_handle = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    if (handle >= 1 && handle <= NVS_MAX_HANDLES) {
+        pthread_mutex_lock(&nvs_lock);
+        nvs_handles[handle - 1][0] = '\0';
+        pthread_mutex_unlock(&nvs_lock);
+    }
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+// Entry for the key in the handle's namespace, lock held
+static nvs_entry_t *nvs_find(nvs_handle_t handle, const char *key, bool create)
+{
+    if (handle < 1 || handle > NVS_MAX_HANDLES || nvs_handles[handle - 1][0] == '\0' ||
+        strlen(key) >= NVS_NAME_MAX) {
+        return NULL;
+    }
+    const char *ns = nvs_handles[handle - 1];
+
+    nvs_entry_t *free_entry = NULL;
+    for (int i = 0; i < NVS_MAX_ENTRIES; i++) {
+        nvs_entry_t *e = &nvs_entries[i];
+        if (e->used && strcmp(e->ns, ns) == 0 && strcmp(e->key, key) == 0) {
+            return e;
+        }
+        if (!e->used && free_entry == NULL) {
+            free_entry = e;
+        }
+    }
+    if (!create || free_entry == NULL) {
+        return NULL;
+    }
+    strcpy(free_entry->ns, ns);
+    strcpy(free_entry->key, key);
+    free_entry->used = true;
+    return free_entry;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_entry_t *e = nvs_find(handle, key, false);
+    if (e != NULL) {
+        *out_value = e->value;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return e != NULL ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    pthread_mutex_lock(&nvs_lock);
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    if (handle >= 1 && handle <= NVS_MAX_HANDLES && nvs_handle_writable[handle - 1]) {
+        nvs_entry_t *e = nvs_find(handle, key, true);
+        if (e != NULL) {
+            e->value = value;
+            ret = ESP_OK;
+        } else {
+            ret = ESP_ERR_NVS_NO_FREE_PAGES;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_entry_t *e = nvs_find(handle, key, false);
+    if (e != NULL) {
+        e->used = false;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return e != NULL ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+// esp_rom
+
+void esp_rom_delay_us(uint32_t us)
+{
+    int64_t end = esp_timer_get_time() + us;
+    while (esp_timer_get_time() < end) {
+    }
+}
+
+// esp_system
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
@@ -0,0 +1,384 @@
+// FreeRTOS on pthreads: tasks, notifications, event groups, semaphores
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "host_board.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+};
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+struct host_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+};
+
+static __thread struct host_task *current_task = NULL;
+
+// VM idle tracking: only the VM blocks on an event group (event_wait)
+static pthread_mutex_t idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_cond;
+static pthread_once_t idle_once = PTHREAD_ONCE_INIT;
+static int idle_waiters = 0;
+static uint32_t idle_wakeups = 0;
+
+static void cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void deadline_after(struct timespec *ts, uint64_t ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+// Wait on cond until pred holds or ticks pass, lock held; returns pred
+#define WAIT_UNTIL(pred, cond, lock, ticks) ({                                  \
+        bool ok_ = (pred);                                                      \
+        if (!ok_ && (ticks) == portMAX_DELAY) {                                 \
+            while (!(ok_ = (pred))) {                                           \
+                pthread_cond_wait((cond), (lock));                              \
+            }                                                                   \
+        } else if (!ok_ && (ticks) > 0) {                                       \
+            struct timespec ts_;                                                \
+            deadline_after(&ts_, (uint64_t)(ticks) * portTICK_PERIOD_MS);       \
+            while (!(ok_ = (pred))) {                                           \
+                if (pthread_cond_timedwait((cond), (lock), &ts_) == ETIMEDOUT) { \
+                    ok_ = (pred);                                               \
+                    break;                                                      \
+                }                                                               \
+            }                                                                   \
+        }                                                                       \
+        ok_;                                                                    \
+    })
+
+static struct host_task *task_new(const char *name)
+{
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (task == NULL) {
+        return NULL;
+    }
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    pthread_mutex_init(&task->lock, NULL);
+    cond_init(&task->cond);
+    return task;
+}
+
+static void *task_entry(void *arg)
+{
+    current_task = arg;
+    current_task->fn(current_task->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *out_task,
+                                   BaseType_t core_id)
+{
+    struct host_task *task = task_new(name);
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    // Host frames are bigger than Xtensa ones, give every task headroom
+    size_t stack = stack_depth * 4 + 256 * 1024;
+    pthread_attr_setstacksize(&attr, stack);
+
+    // Signals (the mruby/c tick) stay with the VM thread
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int ret = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    if (out_task != NULL) {
+        *out_task = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *out_task)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, out_task, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == current_task) {
+        pthread_exit(NULL);
+    }
+    pthread_cancel(task->thread);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    uint64_t ms = (uint64_t)ticks * portTICK_PERIOD_MS;
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    // Threads not started by xTaskCreate (the VM) get a handle on first use
+    if (current_task == NULL) {
+        current_task = task_new("main");
+        if (current_task != NULL) {
+            current_task->thread = pthread_self();
+        }
+    }
+    return current_task;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *task = xTaskGetCurrentTaskHandle();
+    pthread_mutex_lock(&task->lock);
+    uint32_t value = 0;
+    if (WAIT_UNTIL(task->notify > 0, &task->cond, &task->lock, ticks)) {
+        value = task->notify;
+        task->notify = clear_on_exit ? 0 : task->notify - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&task->lock);
+    task->notify++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+    if (woken != NULL) {
+        *woken = pdTRUE;
+    }
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_event_group *group = calloc(1, sizeof(*group));
+    if (group == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&group->lock, NULL);
+    cond_init(&group->cond);
+    return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    group->bits |= bits;
+    EventBits_t now = group->bits;
+    pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->lock);
+    return now;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group, EventBits_t bits, BaseType_t *woken)
+{
+    xEventGroupSetBits(group, bits);
+    if (woken != NULL) {
+        *woken = pdTRUE;
+    }
+    return pdPASS;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&group->lock);
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t now = group->bits;
+    pthread_mutex_unlock(&group->lock);
+    return now;
+}
+
+static void idle_init(void)
+{
+    cond_init(&idle_cond);
+}
+
+static void idle_enter(void)
+{
+    pthread_once(&idle_once, idle_init);
+    pthread_mutex_lock(&idle_lock);
+    idle_waiters++;
+    pthread_cond_broadcast(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+static void idle_leave(void)
+{
+    pthread_mutex_lock(&idle_lock);
+    idle_waiters--;
+    idle_wakeups++;
+    pthread_cond_broadcast(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks)
+{
+    bool blocking = ticks > 0;
+    if (blocking) {
+        idle_enter();
+    }
+
+    pthread_mutex_lock(&group->lock);
+    WAIT_UNTIL(wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0,
+               &group->cond, &group->lock, ticks);
+    EventBits_t now = group->bits;
+    if (clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    pthread_mutex_unlock(&group->lock);
+
+    if (blocking) {
+        idle_leave();
+    }
+    return now;
+}
+
+uint32_t host_vm_wakeups(void)
+{
+    pthread_mutex_lock(&idle_lock);
+    uint32_t n = idle_wakeups;
+    pthread_mutex_unlock(&idle_lock);
+    return n;
+}
+
+bool host_vm_wait_idle(uint32_t timeout_ms)
+{
+    pthread_once(&idle_once, idle_init);
+    pthread_mutex_lock(&idle_lock);
+    TickType_t ticks = pdMS_TO_TICKS(timeout_ms);
+    bool ok = WAIT_UNTIL(idle_waiters > 0, &idle_cond, &idle_lock, ticks);
+    pthread_mutex_unlock(&idle_lock);
+    return ok;
+}
+
+bool host_vm_settle(uint32_t since, uint32_t timeout_ms)
+{
+    pthread_once(&idle_once, idle_init);
+    pthread_mutex_lock(&idle_lock);
+    TickType_t ticks = pdMS_TO_TICKS(timeout_ms);
+    bool ok = WAIT_UNTIL(idle_wakeups != since && idle_waiters > 0, &idle_cond, &idle_lock, ticks);
+    pthread_mutex_unlock(&idle_lock);
+    return ok;
+}
+
+static SemaphoreHandle_t semaphore_new(int count)
+{
+    struct host_semaphore *sem = calloc(1, sizeof(*sem));
+    if (sem == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&sem->lock, NULL);
+    cond_init(&sem->cond);
+    sem->count = count;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semaphore_new(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semaphore_new(0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    pthread_mutex_lock(&sem->lock);
+    bool ok = WAIT_UNTIL(sem->count > 0, &sem->cond, &sem->lock, ticks);
+    if (ok) {
+        sem->count--;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    bool ok = sem->count == 0;
+    if (ok) {
+        sem->count = 1;
+        pthread_cond_signal(&sem->cond);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    pthread_mutex_destroy(&sem->lock);
+    pthread_cond_destroy(&sem->cond);
+    free(sem);
+}
@@ -0,0 +1,46 @@
+// Host stand-in for the SD SPI host
+#pragma once
+
+#include "driver/spi_common.h"
+#include "sdmmc_cmd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SDSPI_DEFAULT_HOST  SPI2_HOST
+#define SDMMC_FREQ_DEFAULT  20000
+#define SDSPI_SLOT_NO_CD    (-1)
+#define SDSPI_SLOT_NO_WP    (-1)
+#define SDSPI_SLOT_NO_INT   (-1)
+
+typedef int sdspi_dev_handle_t;
+
+typedef struct {
+    spi_host_device_t host_id;
+    int gpio_cs;
+    int gpio_cd;
+    int gpio_wp;
+    int gpio_int;
+} sdspi_device_config_t;
+
+#define SDSPI_HOST_DEFAULT() { \
+    .flags = 0, \
+    .slot = SDSPI_DEFAULT_HOST, \
+    .max_freq_khz = SDMMC_FREQ_DEFAULT, \
+}
+
+#define SDSPI_DEVICE_CONFIG_DEFAULT() { \
+    .host_id = SDSPI_DEFAULT_HOST, \
+    .gpio_cs = -1, \
+    .gpio_cd = SDSPI_SLOT_NO_CD, \
+    .gpio_wp = SDSPI_SLOT_NO_WP, \
+    .gpio_int = SDSPI_SLOT_NO_INT, \
+}
+
+esp_err_t sdspi_host_init_device(const sdspi_device_config_t *dev_config, sdspi_dev_handle_t *out_handle);
+esp_err_t sdspi_host_remove_device(sdspi_dev_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,7 @@
+// Host stand-in: no IRAM / DRAM placement on the host
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_BSS_ATTR
+#define RTC_NOINIT_ATTR
@@ -0,0 +1,17 @@
+// Host stand-in for the CPU cycle counter (counts at the configured
+// CPU clock from the monotonic clock)
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+#ifdef __cplusplus
+}
+#endif
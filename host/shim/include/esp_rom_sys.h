@@ -0,0 +1,15 @@
+// Host stand-in for the ROM delay
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Busy-waits like the ROM routine (no yield)
+void esp_rom_delay_us(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
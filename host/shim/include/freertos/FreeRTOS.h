@@ -0,0 +1,42 @@
+// Host stand-in for FreeRTOS, tasks are pthreads and the tick is 1 ms
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE               0
+#define pdTRUE                1
+#define pdFAIL                pdFALSE
+#define pdPASS                pdTRUE
+
+#define configTICK_RATE_HZ    CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS    (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY         ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)     ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+// ISRs run on the thread that raised them, there is nothing to switch
+#define portYIELD_FROM_ISR(...)   do { } while (0)
+
+// No interrupts to mask either: critical sections only keep their shape
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED  0
+#define portENTER_CRITICAL(mux)   do { (void)(mux); } while (0)
+#define portEXIT_CRITICAL(mux)    do { (void)(mux); } while (0)
+
+#define tskNO_AFFINITY        ((BaseType_t)0x7fffffff)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,56 @@
+// Emulated T-Deck Plus for the host build
+// The drivers in components/ run unchanged on the ESP-IDF stand-ins in this
+// directory; the functions below are the other side of the wires, used by
+// the script runner (host/main.c) and the stand-in gems.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// T-Deck wiring (st7789_spi.h, keyboard_driver.h)
+#define HOST_PANEL_CS       12
+#define HOST_PANEL_DC       11
+#define HOST_PANEL_BL       42
+#define HOST_KEYBOARD_INT   46
+
+// Battery divider input, read by the stand-in ADC
+#define HOST_ADC_DEFAULT_MV 2050
+
+// Panel: RGB565 memory of the ST7789, in the MADCTL orientation
+void host_panel_size(int *width, int *height);
+const uint16_t *host_panel_pixels(void);
+// Pixels written since the last call (RAMWR data / 2)
+uint32_t host_panel_take_written(void);
+bool host_panel_dump_ppm(const char *path);
+
+// Keyboard: queue codes for the controller and pull INT
+void host_keyboard_push(uint8_t code);
+
+// Raise the interrupt handler of a pin (trackball edges, keyboard INT)
+void host_gpio_pulse(int pin);
+
+void host_adc_set_mv(int pin, int mv);
+int host_adc_get_mv(int pin);
+
+// Card image file, sectors past its end read as zero
+bool host_sdcard_open(const char *path);
+void host_sdcard_close(void);
+
+// Flash image for the storage partition (in memory until opened)
+bool host_flash_open(const char *path);
+
+// Number of times the VM woke from Event.wait
+uint32_t host_vm_wakeups(void);
+// Wait until the VM sleeps in Event.wait
+bool host_vm_wait_idle(uint32_t timeout_ms);
+// Wait until the VM has woken after `since` and sleeps again
+bool host_vm_settle(uint32_t since, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,12 @@
+// Host build configuration (the Kconfig defaults for a T-Deck Plus)
+#pragma once
+
+#define CONFIG_IDF_TARGET "linux"
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
+#define CONFIG_SPIRAM 1
+#define CONFIG_PICORUBY_HEAP_IN_PSRAM 1
+#define CONFIG_PICORUBY_HEAP_SIZE_KB 2048
+#define CONFIG_PICORUBY_RENDER_WORKER 1
+// No CONFIG_PICORUBY_LIGHT_SLEEP: the host does not sleep, and `idle` in a
+// session script waits for the VM to block in event_wait
@@ -0,0 +1,38 @@
+// Host stand-in for the SD card protocol layer
+// Sectors are read from and written to the host card image (host_board.h)
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int flags;
+    int slot;
+    int max_freq_khz;
+} sdmmc_host_t;
+
+typedef struct {
+    int capacity;       // sectors
+    int sector_size;
+} sdmmc_csd_t;
+
+typedef struct {
+    sdmmc_host_t host;
+    sdmmc_csd_t csd;
+    int max_freq_khz;
+} sdmmc_card_t;
+
+esp_err_t sdmmc_card_init(const sdmmc_host_t *host, sdmmc_card_t *out_card);
+void sdmmc_card_print_info(FILE *stream, const sdmmc_card_t *card);
+esp_err_t sdmmc_read_sectors(sdmmc_card_t *card, void *dst, size_t start_sector, size_t sector_count);
+esp_err_t sdmmc_write_sectors(sdmmc_card_t *card, const void *src, size_t start_sector, size_t sector_count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,13 +2,25 @@
 #include <nvs_flash.h>
 #include "picoruby.h"
 #include <mrubyc.h>
+#include "memory_heap.h"
+#include "lazy_loader.h"
 #include "mrb/app.c"
+#include "mrb/lazy_welcome.c"
+#include "mrb/lazy_slots.c"
+#include "mrb/lazy_completion.c"
+#include "mrb/lazy_commands.c"
+#include "mrb/lazy_document.c"
+#include "mrb/lazy_status.c"
 
-#ifndef HEAP_SIZE
-#define HEAP_SIZE (1024 * 120)
-#endif
-
-static uint8_t heap_pool[HEAP_SIZE];
+// Compiled from main/mrblib/lazy, run by Lazy.load when first needed
+static const lazy_module_t lazy_modules[] = {
+  { "welcome", lazy_welcome },
+  { "slots", lazy_slots },
+  { "completion", lazy_completion },
+  { "commands", lazy_commands },
+  { "document", lazy_document },
+  { "status", lazy_status },
+};
 
 void
 initialize_nvs(void)
@@ -24,7 +36,15 @@ initialize_nvs(void)
 void app_main(void)
 {
   initialize_nvs();
-  mrbc_init(heap_pool, HEAP_SIZE);
+
+  // Heap size from Kconfig or NVS, in PSRAM when enabled
+  size_t heap_size = 0;
+  uint8_t *heap_pool = memory_heap_alloc(&heap_size);
+  if (heap_pool == NULL) {
+    return;
+  }
+  mrbc_init(heap_pool, heap_size);
+  lazy_register(lazy_modules, sizeof(lazy_modules) / sizeof(lazy_modules[0]));
 
   mrbc_tcb *main_tcb = mrbc_create_task(app, 0);
   mrbc_set_task_name(main_tcb, "app");
@@ -1,51 +1,57 @@
 require 'shell'
-require 'i2c'
+require 'keyboard'
+require 'trackball'
+require 'event'
 require 'gpio'
 require 'adc'
 require 'tft'
 require 'sdcard'
+require 'memory'
+require 'console'
+require 'inspect'
+require 'document'
+require 'search'
+require 'undo'
+require 'checker'
+require 'trace'
+require 'perf'
+require 'bench'
+require 'session'
+require 'lazy'
+require 'power'
+
+# Boot breakdown (written by :perf)
+Perf.boot_mark 'vm'
 
 #############################################################################
 #                              Init Constants                               #
 #############################################################################
 
-# Boot
+# Boot (GPIO 10 powers the keyboard, panel and SD Card; it is held through
+# a restart or crash, so only a cold boot waits for them to come up)
+warm_boot = Session.warm_boot?
 GPIO.pull_up_at 10
 boot = GPIO.new(10, GPIO::OUT)
 boot.write 1
+Session.hold_pin 10
 
-sleep_ms 500
-
-# Trackball
-left = GPIO.new(1, GPIO::IN)
-right = GPIO.new(2, GPIO::IN) 
-up = GPIO.new(3, GPIO::IN) 
-down = GPIO.new(15, GPIO::IN) 
-
-INTERNAL_CONSTANTS = [
-  'HIGHLIGHT_KEYWORDS',
-  'INDENT_INCREASE',
-  'INDENT_DECREASE',
-  'INTERNAL_CONSTANTS',
-  'CODE_AREA_Y_START',
-  'CODE_AREA_Y_END',
-  'KEYBOARD_I2C_ADDR',
-  'I2C_SDA_PIN',
-  'I2C_SCL_PIN',
-  'KEYBOARD_I2C'
-]
+sleep_ms 500 unless warm_boot
+Perf.boot_mark 'power'
+
+# Trackball (native edge counters on GPIO 1/2/3/15)
+Trackball.init
+Trackball.set_acceleration(2, 1)
 
 # Initialize TFT Display
 TFT.init
 TFT.fill_screen(0x070707)
 TFT.set_text_size(1)
 TFT.set_text_wrap(false)
+Perf.boot_mark 'tft'
 
-# Keyboard Setup
-KEYBOARD_I2C_ADDR = 0x55
-I2C_SDA_PIN = 18
-I2C_SCL_PIN = 8
-KEYBOARD_I2C = I2C.new(unit: "ESP32_I2C1", sda_pin: I2C_SDA_PIN, scl_pin: I2C_SCL_PIN, frequency: 200000)
+# Keyboard Setup (native reader task drains the I2C controller)
+Keyboard.init
+Perf.boot_mark 'keyboard'
 
 # Screen layout
 CODE_AREA_Y_START = 33
@@ -128,49 +134,8 @@ SPECIAL_KEY_CHARS = {
 #############################################################################
 $slot_modal_mode = nil  # nil, :save, :load
 $slot_selected = 0
-
-# ti-doc: Draw slot selection modal
-def draw_slot_modal(mode)
-  # Modal background
-  box_x = 80
-  box_y = 50
-  box_w = 160
-  box_h = 120
-
-  TFT.fill_rect(box_x + 2, box_y + 2, box_w, box_h, 0x000000)
-  TFT.fill_rect(box_x, box_y, box_w, box_h, 0x252526)
-  TFT.draw_rect(box_x, box_y, box_w, box_h, 0x007ACC)
-
-  title = mode == :save ? 'Save to Slot' : 'Load from Slot'
-  title_x = box_x + (box_w - title.length * 6) / 2
-  draw_text(title, title_x, box_y + 6, 0xD4D4D4)
-
-  TFT.draw_fast_h_line(box_x + 1, box_y + 18, box_w - 2, 0x303030)
-
-  8.times do |i|
-    col = i % 2
-    row = i / 2
-    slot_x = box_x + 10 + col * 75
-    slot_y = box_y + 24 + row * 22
-
-    if i == $slot_selected
-      TFT.fill_rect(slot_x - 2, slot_y - 2, 70, 18, 0x094771)
-    end
-
-    label = "SLOT #{i}"
-    draw_text(label, slot_x, slot_y, 0xD4D4D4)
-  end
-
-  inst = 'Ball:Select Return:OK'
-  inst_x = box_x + (box_w - inst.length * 6) / 2
-  draw_text(inst, inst_x, box_y + box_h - 12, 0x6E6E6E)
-end
-
-# ti-doc: Close slot modal and restore screen
-def close_slot_modal
-  $slot_modal_mode = nil
-  $slot_selected = 0
-end
+$slot_mrb = nil      # [source_hash, bytecode] of the last loaded slot
+$running_mrb = nil   # bytecode of the running program
 
 #############################################################################
 #                               Completion                                  #
@@ -183,17 +148,11 @@ $completion_index = 0
 $draw_completion_box_y = CODE_AREA_Y_START
 $completion_box_visible = false
 
-# ti-doc: Load constants for completion
-def load_constants
-  Object.constants.each do |constant|
-    constant_str = constant.to_s
-
-    if INTERNAL_CONSTANTS.include?(constant_str) || constant_str.index('Error') != nil
-      next
-    end
-
-    $dict[constant_str] = true
-  end
+# ti-doc: Load the completion module and its words, then draw (the module replaces this method)
+def draw_completion(current_code, code_lines_count)
+  return if current_code == '' || !Lazy.load(:completion)
+  load_constants
+  draw_completion(current_code, code_lines_count)
 end
 
 # ti-doc: Clear completion box area
@@ -210,81 +169,12 @@ def clear_completion_box
     box_h = max_h
   end
 
-  TFT.fill_rect(box_x, box_y, box_w, box_h, 0x070707)
-  $completion_box_visible = false
-end
-
-# ti-doc: Draw completion and set $completion_chars
-def draw_completion(current_code, code_lines_count)
-  $completion_chars = nil
-  $completion_candidates = []
-
-  clear_completion_box
-
-  return if current_code == ''
-
-  tokens = tokenize(current_code)
-  target = tokens.last
-
-  return if target.nil? || target == '' || target == ' '
-
-  candidates = []
-
-  $dict.keys.each do |key|
-    if key.length > target.length && key[0, target.length] == target
-      candidates << key
-    end
-  end
-
-  return if candidates.length == 0
-
-  candidates = candidates[0, 6]
-  candidates << '(skip)'
-  $completion_candidates = candidates
-
-  if $completion_index >= candidates.length
-    $completion_index = 0
-  end
-
-  # Set completion chars (nil for skip option)
-  if $completion_index == candidates.length - 1
-    $completion_chars = nil
-  else
-    selected = candidates[$completion_index]
-    $completion_chars = selected[target.length, selected.length]
-  end
-
-  box_x = 222
-  box_y = CODE_AREA_Y_START + 2 + (code_lines_count * 10 + 10)
-
-  if (box_y + 70) >= 207
-    box_y = 116
-  end
-
-  box_w = 96
-  box_h = candidates.length * 10 + 4
-
-  $draw_completion_box_y = box_y
-  $completion_box_visible = true
-
-  TFT.fill_rect(box_x + 1, box_y + 1, box_w, box_h, 0x000000)
-  TFT.fill_rect(box_x, box_y, box_w, box_h, 0x252526)
-  TFT.draw_rect(box_x, box_y, box_w, box_h, 0x303030)
-
-  highlight_y = box_y + 1 + $completion_index * 10
-  TFT.fill_rect(box_x + 1, highlight_y, box_w - 2, 10, 0x094771)
-
-  candidates.each_with_index do |candidate, idx|
-    y = box_y + 2 + idx * 10
-
-    if candidate == '(skip)'
-      draw_text(candidate, box_x + 2, y, 0x6E6E6E)
-    else
-      disp_name = candidate.length > 14 ? candidate[0, 13] + '..' : candidate
-      color = (candidate[0] >= 'A' && candidate[0] <= 'Z') ? 0x4EC9B0 : 0xFFFCDA
-      draw_text(disp_name, box_x + 2, y, color)
-    end
+  # Blit the code area back from the shadow, or blank it without one
+  unless TFT.restore_rect(box_x, box_y, box_w, box_h)
+    TFT.fill_rect(box_x, box_y, box_w, box_h, 0x070707)
+    forget_code_rows
   end
+  $completion_box_visible = false
 end
 
 
@@ -305,24 +195,23 @@ def draw_newline_no_scroll(prev_line, current_code, indent_ct, current_row, code
   prev_y = current_line_y(code_lines_count - 1)
   prev_row = current_row - 1
 
+  forget_code_rows((prev_y - CODE_AREA_Y_START) / 10)
+  forget_code_rows((prev_y - CODE_AREA_Y_START) / 10 + 1)
   TFT.fill_rect(0, prev_y, 320, 10, 0x070707)
-  line_number = prev_row > 9 ? 1 : 2
 
   TFT.fill_rect(0, prev_y, 34, 10, 0x070707)
   TFT.draw_fast_v_line(28, prev_y - 2, 10, 0x303030)
 
-  draw_text("#{' ' * line_number}#{prev_row}", 0, prev_y, 0x6E6E6E)
+  draw_line_number(prev_row, prev_y, 0x6E6E6E)
   draw_code_highlighted("#{'  ' * prev_line[:indent]}#{prev_line[:text]}", 38, prev_y)
 
   y = current_line_y(code_lines_count)
 
   return if y > CODE_AREA_Y_END - 10
 
-  line_number = current_row > 9 ? 1 : 2
-
   TFT.draw_fast_v_line(28, y - 2, 10, 0x303030)
 
-  draw_text("#{' ' * line_number}#{current_row}", 0, y, 0xD4D4D4)
+  draw_line_number(current_row, y, 0xD4D4D4)
   code_display = "#{'  ' * indent_ct}#{current_code}"
   draw_code_highlighted(code_display, 38, y)
   draw_text('_', 38 + code_display.length * 6, y, 0x007ACC)
@@ -372,12 +261,11 @@ def draw_line_at(line_index, is_active, code_lines, scroll_start)
   line = code_lines[line_index]
   ln = line_index + 1
 
+  forget_code_rows(visible_offset)
   TFT.fill_rect(0, y, 320, 10, 0x070707)
   TFT.draw_fast_v_line(28, y - 2, 10, 0x303030)
 
-  line_number_padding = ln > 9 ? 1 : 2
-  ln_color = is_active ? 0xD4D4D4 : 0x6E6E6E
-  draw_text("#{' ' * line_number_padding}#{ln}", 0, y, ln_color)
+  draw_line_number(ln, y, is_active ? 0xD4D4D4 : 0x6E6E6E)
 
   code_display = "#{'  ' * line[:indent]}#{line[:text]}"
   draw_code_highlighted(code_display, 38, y)
@@ -398,12 +286,11 @@ def draw_new_line_at(current_code, indent_ct, current_row, code_lines_count, is_
   y = current_line_y(code_lines_count)
   return if y > CODE_AREA_Y_END - 10
 
+  forget_code_rows((y - CODE_AREA_Y_START) / 10)
   TFT.fill_rect(0, y, 320, 10, 0x070707)
   TFT.draw_fast_v_line(28, y - 2, 10, 0x303030)
 
-  line_number_padding = current_row > 9 ? 1 : 2
-  ln_color = is_active ? 0xD4D4D4 : 0x6E6E6E
-  draw_text("#{' ' * line_number_padding}#{current_row}", 0, y, ln_color)
+  draw_line_number(current_row, y, is_active ? 0xD4D4D4 : 0x6E6E6E)
 
   code_display = "#{'  ' * indent_ct}#{current_code}"
   draw_code_highlighted(code_display, 38, y)
@@ -565,6 +452,9 @@ end
 
 # ti-doc: Draw Static UI frame
 def draw_ui file_name
+  forget_code_rows
+  $tab_file = file_name
+
   # Tab bar background (full width)
   TFT.fill_rect(0, 0, 320, 22, 0x2D2D2D)
 
@@ -627,6 +517,9 @@ end
 
 # ti-doc: Insert a character at the current cursor position
 def insert_char_at_cursor(code, char, code_lines)
+  line, col = cursor_position(code, code_lines)
+  Undo.insert(line, col, char)
+
   if $cursor_line_index.nil?
     if $cursor_col.nil?
       code << char
@@ -664,14 +557,6 @@ def adjust_cursor_col(visual_col, target_indent, target_text_length)
   end
 end
 
-# ti-doc: Mark all trackball directions as consumed (debounce)
-def debounce_track
-  $up_pressed = true
-  $down_pressed = true
-  $left_pressed = true
-  $right_pressed = true
-end
-
 # ti-doc: Move cursor from one code_line to another code_line
 def move_cursor_between_lines(target_index, code_lines)
   old_scroll = $scroll_start
@@ -722,16 +607,25 @@ def move_cursor_to_new_line(code_lines, current_row)
   end
 end
 
+# ti-doc: Draw a line number in the gutter (the line of a syntax error is marked red)
+def draw_line_number(ln, y, color)
+  if ln - 1 == $check_line
+    color = 0xF44747
+    TFT.fill_rect(0, y, 2, 8, color)
+  end
+  draw_text("#{' ' * (ln > 9 ? 1 : 2)}#{ln}", 0, y, color)
+end
+
 # ti-doc: Draw current line only
 def draw_current_line(current_code, indent_ct, current_row, code_lines_count)
   y = current_line_y(code_lines_count)
   return if y > CODE_AREA_Y_END - 10
 
+  forget_code_rows((y - CODE_AREA_Y_START) / 10)
   TFT.fill_rect(0, y, 320, 10, 0x070707)
   TFT.draw_fast_v_line(28, y - 2, 10, 0x303030)
 
-  line_number = current_row > 9 ? 1 : 2
-  draw_text("#{' ' * line_number}#{current_row}", 0, y, 0x858585)
+  draw_line_number(current_row, y, 0x858585)
 
   code_display = "#{'  ' * indent_ct}#{current_code}"
   draw_code_highlighted(code_display, 38, y)
@@ -748,14 +642,57 @@ def draw_current_line(current_code, indent_ct, current_row, code_lines_count)
   draw_completion(current_code, code_lines_count)
 end
 
-# ti-doc: Draw code area (full redraw)
+# What each code area row currently shows (nil = unknown)
+$row_sigs = []
+
+# ti-doc: Forget drawn code rows (all, or one row) so the next full redraw repaints them
+def forget_code_rows(row = nil)
+  if row.nil?
+    $row_sigs = []
+  elsif row >= 0
+    $row_sigs[row] = nil
+  end
+end
+
+# ti-doc: Draw one code area row unless it already shows the same line
+def draw_code_row(row, y, ln, is_active, indent, text)
+  cursor = is_active ? ($cursor_col.nil? ? -1 : $cursor_col) : -2
+  mark = ln - 1 == $check_line ? 'E' : ''
+  sig = "#{ln}:#{indent}:#{cursor}:#{mark}:#{text}"
+  return if $row_sigs[row] == sig
+  $row_sigs[row] = sig
+
+  TFT.fill_rect(0, y, 320, 10, 0x070707)
+  TFT.draw_fast_v_line(28, y - 2, 10, 0x303030)
+  draw_line_number(ln, y, is_active ? 0xD4D4D4 : 0x6E6E6E)
+  code_display = "#{'  ' * indent}#{text}"
+  draw_code_highlighted(code_display, 38, y)
+
+  if is_active
+    cursor_x = 
+      if $cursor_col.nil?
+        38 + code_display.length * 6
+      else
+        38 + (2 * indent + $cursor_col) * 6
+      end
+
+    draw_text('_', cursor_x, y, 0x007ACC)
+  end
+end
+
+# ti-doc: Draw code area (full redraw, rows that did not change are skipped)
 def draw_code_area(code_lines, current_code, indent_ct, current_row)
   # Reset completion for class context
   $dict.delete('attr_reader')
   $dict.delete('attr_accessor')
   $dict.delete('initialize')
 
-  TFT.fill_rect(0, CODE_AREA_Y_START, 320, CODE_AREA_Y_END - CODE_AREA_Y_START, 0x070707)
+  # The popup may cover rows that are skipped below
+  clear_completion_box
+
+  if $row_sigs.empty?
+    TFT.fill_rect(0, CODE_AREA_Y_START, 320, CODE_AREA_Y_END - CODE_AREA_Y_START, 0x070707)
+  end
 
   max_visible = 16
   total = code_lines.length
@@ -763,56 +700,31 @@ def draw_code_area(code_lines, current_code, indent_ct, current_row)
   start_line = $scroll_start
   end_line = [total, start_line + max_visible].min
   y = CODE_AREA_Y_START
+  row = 0
 
   # Draw history lines
   (start_line...end_line).each do |i|
     line = code_lines[i]
-    ln = i + 1
-    line_number = ln > 9 ? 1 : 2
-
-    is_active = ($cursor_line_index == i)
-    ln_color = is_active ? 0xD4D4D4 : 0x6E6E6E
-
-    TFT.fill_rect(0, y, 34, 10, 0x070707)
-    TFT.draw_fast_v_line(28, y - 2, 10, 0x303030)
-    draw_text("#{' ' * line_number}#{ln}", 0, y, ln_color)
-    code_display = "#{'  ' * line[:indent]}#{line[:text]}"
-    draw_code_highlighted(code_display, 38, y)
-
-    if is_active
-      cursor_x = 
-        if $cursor_col.nil?
-          38 + code_display.length * 6
-        else
-          38 + (2 * line[:indent] + $cursor_col) * 6
-        end
-
-      draw_text('_', cursor_x, y, 0x007ACC)
-    end
+    draw_code_row(row, y, i + 1, $cursor_line_index == i, line[:indent], line[:text])
     y += 10
+    row += 1
   end
 
   # Draw current/new line
   if y <= CODE_AREA_Y_END - 10
-    line_number = current_row > 9 ? 1 : 2
-    is_new_line_active = $cursor_line_index.nil?
-    ln_color = is_new_line_active ? 0xD4D4D4 : 0x6E6E6E
-
-    TFT.draw_fast_v_line(28, y - 2, 10, 0x303030)
-    draw_text("#{' ' * line_number}#{current_row}", 0, y, ln_color)
-    code_display = "#{'  ' * indent_ct}#{current_code}"
-    draw_code_highlighted(code_display, 38, y)
-
-    if is_new_line_active
-      cursor_x = 
-        if $cursor_col.nil?
-          38 + code_display.length * 6
-        else
-          38 + (2 * indent_ct + $cursor_col) * 6
-        end
+    draw_code_row(row, y, current_row, $cursor_line_index.nil?, indent_ct, current_code)
+    y += 10
+    row += 1
+  end
 
-      draw_text('_', cursor_x, y, 0x007ACC)
+  # Blank the rows below the last line
+  while y <= CODE_AREA_Y_END - 10
+    if $row_sigs[row] != ''
+      TFT.fill_rect(0, y, 320, 10, 0x070707)
+      $row_sigs[row] = ''
     end
+    y += 10
+    row += 1
   end
 
   code_lines.each do |line|
@@ -830,6 +742,9 @@ def draw_code_area(code_lines, current_code, indent_ct, current_row)
   draw_completion(current_code, current_row)
 end
 
+# Characters that fit in the result area
+RESULT_COLS = 49
+
 # ti-doc: Draw result with horizontal scroll offset
 def draw_result(res, offset = 0)
   TFT.fill_rect(22, 208, 298, 12, 0x070707)
@@ -844,10 +759,8 @@ def draw_result(res, offset = 0)
   elsif res.class == TrueClass || res.class == FalseClass
     color = 0x569CD6
   end
-  display_str = res.to_s
-  if offset > 0 && display_str.length > offset
-    display_str = display_str[offset..]
-  end
+  # Format only the visible window, big results never become one string
+  display_str = Inspect.window(res, offset, RESULT_COLS)
   draw_text(display_str, 22, 210, color)
 end
 
@@ -862,6 +775,8 @@ def draw_status(msg, line_num = nil)
 
   $last_status_line = line_num
 
+  msg = '--RUNNING--' if $sandbox_running && msg == '--NORMAL--'
+
   TFT.fill_rect(0, 227, 320, 13, 0x007ACC)
   draw_text(msg, 4, 230, 0xFFFFFF)
 
@@ -880,36 +795,446 @@ def draw_status(msg, line_num = nil)
 end
 
 #############################################################################
-#                                 Welcome                                   #
+#                                 Sandbox                                   #
 #############################################################################
 
-draw_text 'Pro Editor Pocket For Picoruby', 70, 110, 0xFFFFFF
-draw_text 'Press return to start', 100, 135, 0x555555
-draw_ruby_icon 252, 108
+# CPU time given to the sandbox task per main loop pass
+SANDBOX_SLICE_MS = 20
 
-loop do
-  key_event = 0
-
-  begin
-    data = KEYBOARD_I2C.read(KEYBOARD_I2C_ADDR, 1)
-    sleep_ms 5
-    key_event = data.ord if data && data.length > 0
-  rescue
-    # nop
+# Stop user code this many ms after it started (0 = no limit)
+# Can be changed from the editor, e.g. `$sandbox_budget_ms = 600_000`
+$sandbox_budget_ms = 30_000
+
+$sandbox_running = false
+
+# ti-doc: Send print output to the console
+def print(*args)
+  args.each { |arg| Console.write(arg.to_s) }
+  nil
+end
+
+# ti-doc: Send puts output to the console
+def puts(*args)
+  Console.write("\n") if args.empty?
+  args.each do |arg|
+    str = arg.to_s
+    Console.write(str)
+    Console.write("\n") if str[-1] != "\n"
+  end
+  nil
+end
+
+# ti-doc: Send p output to the console
+def p(*args)
+  args.each { |arg| Console.write("#{arg.inspect}\n") }
+  args.length == 1 ? args[0] : nil
+end
+
+# Heap usage of the last run (see Sandbox#memory_stats)
+$last_memory_stats = nil
+
+class Sandbox
+  # ti-doc: Start heap accounting for one run
+  def memory_begin
+    @mem_baseline = Memory.used
+    @mem_peak = @mem_baseline
+    @mem_retained = 0
+  end
+
+  # ti-doc: Record the current heap usage as a peak candidate
+  def memory_sample
+    used = Memory.used
+    @mem_peak = used if used > @mem_peak
+  end
+
+  # ti-doc: Finish heap accounting after the sandbox was released
+  def memory_end
+    @mem_retained = Memory.used - @mem_baseline
   end
 
-  if key_event == 13
-    break
+  # ti-doc: Heap usage of the last run in bytes (peak and retained are relative to the start of the run)
+  def memory_stats
+    return nil if @mem_baseline.nil?
+    { peak: @mem_peak - @mem_baseline, retained: @mem_retained, used: Memory.used }
   end
+
+  # ti-doc: Release the compiled code and parser after a run (executed: false after a failed compile)
+  def release(executed = true)
+    memory_sample
+    suspend if executed
+    free_parser
+    memory_end
+  end
+end
+
+# Heap overlay in the tab bar, toggle with `$mem_overlay = true`
+$mem_overlay = false
+
+# Key to pixel latency HUD in the tab bar (takes the place of the heap
+# overlay), toggle with `:hud` or `$perf_hud = true`
+$perf_hud = false
+
+# Both are drawn by lazy/status.rb, loaded when one is first turned on
+
+# ti-doc: Format n / 1000 with one decimal (us as ms, ns as us)
+def format_milli(n)
+  "#{n / 1000}.#{n % 1000 / 100}"
+end
+
+# ti-doc: Read result or error of a finished sandbox and release it
+def take_sandbox_result(sandbox)
+  err = sandbox.error
+  if err.nil?
+    res = sandbox.result
+    Console.write("=> #{Inspect.window(res, 0, 150, true)}\n")
+  else
+    res = "#{err} #{err.message}"
+    Console.write("#{res}\n")
+  end
+
+  sandbox.release
+  $last_memory_stats = sandbox.memory_stats
+  $sandbox_running = false
+  $running_mrb = nil
+  res
+end
+
+# ti-doc: Stop a running sandbox and release it
+def stop_sandbox(sandbox, reason)
+  Console.write("#{reason}\n")
+  sandbox.stop
+  sandbox.release
+  $last_memory_stats = sandbox.memory_stats
+  $sandbox_running = false
+  $running_mrb = nil
+end
+
+# ti-doc: Build the exact source the sandbox compiles for code_lines (tail goes inside, before the closing paren)
+def sandbox_source(code_lines, tail = '')
+  src = ''
+  code_lines.each do |line|
+    src << "#{'  ' * line[:indent]}#{line[:text]}\n"
+  end
+  "_ = (#{src}#{tail})"
+end
+
+# ti-doc: Run code repeatedly in its own sandbox and report heap usage (retained bytes should stay 0)
+def sandbox_soak(runs = 1000, code = '[1, 2, 3].map { |x| x * 2 }.join(",")')
+  soak = Sandbox.new('soak')
+  start_used = Memory.used
+  max_retained = 0
+  failed = nil
+
+  runs.times do |i|
+    next if failed
+
+    soak.memory_begin
+    if soak.compile("_ = (#{code})", remove_lv: true)
+      soak.execute
+      soak.wait(timeout: nil)
+      soak.release
+    else
+      soak.release(false)
+      failed = i
+    end
+
+    retained = soak.memory_stats[:retained]
+    max_retained = retained if retained > max_retained
+    if (i + 1) % 100 == 0
+      puts "soak #{i + 1}/#{runs}: used #{Memory.used} retained #{retained}"
+    end
+  end
+
+  soak.terminate
+  return "soak: syntax error" if failed
+
+  "soak #{runs} runs: heap #{start_used} -> #{Memory.used}, max retained #{max_retained}"
 end
 
 #############################################################################
-#                               Start Main loop                             #
+#                                 Console                                   #
 #############################################################################
 
-# Initial draw
-draw_ui 'app.rb'
-draw_status('--NORMAL--', 1)
+# Console pane covers the code area while the code buffer is empty
+CONSOLE_ROWS = 16
+CONSOLE_COLS = 52
+
+$console_top = 0        # first visible line
+$console_follow = true  # keep the newest line in view
+$console_drawn = -1     # last line drawn (redrawn while it grows)
+$console_version = -1   # Console.version at the last draw
+
+# ti-doc: Draw one console line in its pane row
+def draw_console_row(line_no, row)
+  y = CODE_AREA_Y_START + row * 10
+  TFT.fill_rect(0, y, 320, 10, 0x070707)
+  text = Console.line(line_no)
+  draw_text(text[0, CONSOLE_COLS], 4, y + 1, 0xD4D4D4) if text && text.length > 0
+end
+
+# ti-doc: Draw new console lines (full redraws every row)
+def draw_console(full = false)
+  version = Console.version
+  return if !full && version == $console_version
+  $console_version = version
+
+  first = Console.first_line
+  last = Console.last_line
+
+  # Following the output jumps half a page, so the whole pane is
+  # redrawn once per CONSOLE_ROWS / 2 lines, not on every line
+  if $console_follow && last >= $console_top + CONSOLE_ROWS
+    $console_top = last - CONSOLE_ROWS / 2 + 1
+    full = true
+  end
+  if $console_top < first
+    $console_top = first
+    full = true
+  end
+
+  bottom = [last, $console_top + CONSOLE_ROWS - 1].min
+  forget_code_rows
+  if full
+    TFT.fill_rect(0, CODE_AREA_Y_START, 320, CODE_AREA_Y_END - CODE_AREA_Y_START, 0x070707)
+    line_no = $console_top
+  else
+    # The last drawn line may have grown, lines after it are new
+    line_no = [$console_drawn, $console_top].max
+  end
+
+  while line_no <= bottom
+    draw_console_row(line_no, line_no - $console_top)
+    line_no += 1
+  end
+  $console_drawn = bottom
+end
+
+# ti-doc: Scroll the console view by dy lines
+def scroll_console(dy)
+  first = Console.first_line
+  max_top = [Console.last_line - CONSOLE_ROWS + 1, first, $console_top].max
+  top = $console_top + dy
+  top = first if top < first
+  top = max_top if top > max_top
+
+  # Back at the bottom: follow new output again
+  $console_follow = top >= Console.last_line - CONSOLE_ROWS + 1
+  if top != $console_top
+    $console_top = top
+    draw_console(true)
+  end
+end
+
+#############################################################################
+#                                Document                                   #
+#############################################################################
+# Large files live in SD Card documents (0-3) and are paged in natively;
+# only the visible rows are ever fetched into the VM. The view is in
+# lazy/document.rb, loaded when a document is first opened
+
+$document = nil    # set to 0-3 from the editor to open a document, nil to close
+$doc_open = nil    # document shown in the code area
+$doc_top = 0       # first visible line
+$doc_cursor = 0    # line being edited
+
+#############################################################################
+#                               Syntax check                                #
+#############################################################################
+# Once typing pauses, the buffer is parsed on the other core (see Checker)
+# and the line of the first syntax error is marked in the gutter.
+# Results are cached by buffer version, so undoing back to a checked
+# buffer is not parsed again.
+
+CHECK_DELAY_MS = 300  # pause in typing before the buffer is checked
+
+$check_line = nil     # code line index of the error, nil if none
+$check_message = nil  # "line:col: message" of the error
+$check_version = nil  # buffer version the two above belong to
+
+# ti-doc: Source the checker parses: what a run compiles, with an `end` for each open block
+def check_source(code_lines, indent_ct)
+  sandbox_source(code_lines, "end\n" * indent_ct)
+end
+
+# ti-doc: Take a Checker.result, returns true if the marked line changed
+def apply_check(check, code_lines)
+  line = nil
+  $check_message = nil
+  $check_version = check[0]
+
+  if check[1] > 0
+    # The first line starts with `_ = (`, see sandbox_source
+    col = check[1] == 1 ? check[2] - 5 : check[2]
+    line = [check[1] - 1, code_lines.length].min
+    $check_message = "#{check[1]}:#{[col, 0].max + 1}: #{check[3]}"
+  end
+
+  changed = line != $check_line
+  $check_line = line
+  changed
+end
+
+#############################################################################
+#                                   Undo                                    #
+#############################################################################
+# Edits are logged natively in a fixed arena (see Undo), typing runs are
+# merged into one step. Lines are numbered like code_lines, the new line
+# being code_lines.length.
+
+# Sym -> Shift + key sends the key's sym character & 0x1F (as in
+# SPECIAL_KEY_CHARS): E ('2') is undo, R ('3') is redo.
+$undo_key = 18  # Sym -> Shift + E
+$redo_key = 19  # Sym -> Shift + R
+
+# ti-doc: Line and column of the cursor
+def cursor_position(code, code_lines)
+  if $cursor_line_index.nil?
+    [code_lines.length, $cursor_col || code.length]
+  else
+    [$cursor_line_index, $cursor_col || code_lines[$cursor_line_index][:text].length]
+  end
+end
+
+# ti-doc: Copy of lines with count lines at index replaced by inserted
+def splice_lines(lines, index, count, inserted)
+  out = []
+  i = 0
+  while i < index
+    out << lines[i]
+    i += 1
+  end
+  inserted.each { |line| out << line }
+  i = index + count
+  while i < lines.length
+    out << lines[i]
+    i += 1
+  end
+  out
+end
+
+# ti-doc: The whole buffer as {text:, indent:} lines, new line last
+def undo_buffer(code_lines, code, indent_ct)
+  code_lines + [{text: code, indent: indent_ct}]
+end
+
+# ti-doc: Apply the edits from Undo.undo / Undo.redo, returns [code_lines, code, indent_ct]
+def apply_undo(ops, code_lines, code, indent_ct)
+  lines = undo_buffer(code_lines, code, indent_ct)
+  at = 0
+  col = nil
+
+  ops.each do |op|
+    at = op[1]
+    if op[0] == 2
+      lines = splice_lines(lines, at, op[2], op[3])
+      col = nil
+    else
+      line = lines[at]
+      if line.nil?
+        # Buffer changed outside the log, the history no longer applies
+        Undo.clear
+        break
+      end
+      text = line[:text]
+      if op[0] == 0
+        line[:text] = text[0, op[2]] + op[3] + text[op[2]..]
+        col = op[2] + op[3].length
+      else
+        line[:text] = text[0, op[2]] + text[(op[2] + op[3])..]
+        col = op[2]
+      end
+    end
+  end
+
+  new_line = lines.pop
+  code = new_line[:text]
+  indent_ct = new_line[:indent]
+
+  # Cursor goes to the last edit
+  if at < lines.length
+    $cursor_line_index = at
+    $saved_new_line = code
+    $saved_new_indent = indent_ct
+    $cursor_col = col && col < lines[at][:text].length ? col : nil
+  else
+    $cursor_line_index = nil
+    $cursor_col = col && col < code.length ? col : nil
+  end
+  $scroll_start = adjust_scroll($cursor_line_index, lines.length)
+
+  [lines, code, indent_ct]
+end
+
+#############################################################################
+#                                 Commands                                  #
+#############################################################################
+# A new line starting with ':' runs an editor command instead of code:
+#   :find foo       find in the buffer and every slot (:find /re/ for a regex)
+#   :replace a b    replace in the buffer (:replace! also rewrites the slots)
+#   :console        show the console over the code until the next key
+#   :trace rec 0    record keys and trackball into trace slot 0 (:trace stop)
+#   :trace play 0   replay trace slot 0 at full speed (add 'real' for the
+#                   recorded timing) and report the handling times
+#   :hud            toggle the key latency HUD in the tab bar
+#   :perf           dump the key latency histogram (:perf reset clears it)
+#   :bench          time the editor hot paths
+#   :bench spi      sweep the panel SPI clock, transfer mode and chunk size
+# They are in lazy/commands.rb, loaded by the first one. Any other line
+# starting with ':' (:sym.to_s, ::Foo.new) is Ruby and runs as code
+EDITOR_COMMANDS = ['find', 'replace', 'replace!', 'console', 'trace', 'hud', 'perf', 'bench']
+
+# ti-doc: Whether a line is one of EDITOR_COMMANDS rather than Ruby
+def editor_command?(code)
+  return false unless code[0] == ':'
+
+  sep = code.index(' ')
+  name = sep ? code[1, sep - 1] : code[1, code.length - 1]
+  EDITOR_COMMANDS.include?(name)
+end
+
+$search_pattern = nil    # pattern still being streamed through the slots
+$search_hits = 0         # slot hits of the current search
+$console_pinned = false
+$trace_recording = false
+$trace_playing = false
+$trace_slot = 0
+
+#############################################################################
+#                                  Session                                  #
+#############################################################################
+
+# ti-doc: Snapshot the editing state to flash (restored at the next boot)
+def save_session(code_lines, code, indent_ct, current_row, execute_code)
+  Session.save(code_lines,
+               [$tab_file, code, execute_code, $saved_new_line],
+               [$cursor_line_index, $cursor_col, $scroll_start, indent_ct, current_row, $saved_new_indent],
+               $dict.keys)
+end
+
+# ti-doc: Last saved session, nil if none (or saved in another layout)
+def load_session
+  snapshot = Session.load
+  return nil unless snapshot && snapshot[1].length == 4 && snapshot[2].length == 6
+  snapshot
+end
+
+#############################################################################
+#                                 Welcome                                   #
+#############################################################################
+
+# A saved session goes straight back to the editor
+resume = load_session
+Perf.boot_mark 'session'
+
+unless resume
+  Lazy.load :welcome
+  show_welcome
+  Perf.boot_mark 'welcome'
+end
+
+#############################################################################
+#                               Start Main loop                             #
+#############################################################################
 
 # State for main loop
 code = ''
@@ -924,42 +1249,68 @@ need_line_redraw = false
 need_newline_redraw = false
 need_result_redraw = false
 prev_line_for_newline = nil
-$right_pressed = right.high?
-$left_pressed = left.high?
-$up_pressed = up.high?
-$down_pressed = down.high?
-loop_counter = 0
+run_started_ms = 0
+events = 0
+tab_overlay = nil
+console_shown = false
+check_pending = false
+last_key_ms = 0
+tab_file = 'app.rb'
+
+if resume
+  code_lines, texts, numbers, words = resume
+  tab_file, code, execute_code, $saved_new_line = texts
+  $cursor_line_index, $cursor_col, $scroll_start, indent_ct, current_row, $saved_new_indent = numbers
+  words.each { |word| $dict[word] = true }
+  resume = nil
+end
+
+# Initial draw
+draw_ui tab_file
+draw_status('--NORMAL--', $cursor_line_index.nil? ? current_row : $cursor_line_index + 1)
 
 sandbox = Sandbox.new('')
 
-load_constants
+Perf.reset
+Perf.boot_mark 'ready'
 
 loop do
-  loop_counter += 1
-
-  # Get keyboard input
-  key_event = 0
-  begin
-    data = KEYBOARD_I2C.read(KEYBOARD_I2C_ADDR, 1)
-    sleep_ms 5
-    key_event = data.ord if data && data.length > 0
-  rescue
-    # nop
+  # Get keyboard input (apply the whole batch, then redraw once)
+  key_events = Keyboard.read_all
+  Perf.frame_begin
+
+  # A trace replay stands in for the keyboard and trackball (a key stops it)
+  replay = nil
+  if $trace_playing
+    replay = Trace.next if key_events.empty?
+    if replay.nil?
+      finish_trace(!key_events.empty?)
+      need_full_redraw = true
+    end
+    key_events = replay ? replay[0] : []
   end
 
-  if key_event > 0
+  key_events.each do |key_event|
     # Debug: show key code at top right
     # if key_event != 7
     #   TFT.fill_rect(280, 4, 40, 14, 0x2D2D2D)
     #   draw_text("K:#{key_event}", 282, 8, 0x6E6E6E)
     # end
 
+    $console_pinned = false
+
+    # Document view takes all keys
+    if $doc_open
+      need_full_redraw = true if doc_key(key_event)
+      next
+    end
+
     draw_status('--NORMAL--', current_row)
 
     # Cancel slot modal with backspace
     if $slot_modal_mode && key_event == 8
       close_slot_modal
-      need_full_redraw = true
+      need_full_redraw = true unless restore_slot_modal
       next
     end
 
@@ -970,38 +1321,27 @@ loop do
       close_slot_modal
 
       if mode == :save
-        full_code = ''
-
-        code_lines.each do |line|
-          full_code << "#{'  ' * line[:indent]}#{line[:text]}\n"
-        end
-        full_code << "#{'  ' * indent_ct}#{code}" if code != ''
-
-        save_result = SDCard.save(slot, full_code)
+        save_result = save_to_slot(slot, code_lines, code, indent_ct)
 
-        TFT.init
-        TFT.fill_screen(0x070707)
+        # The card borrowed the bus; the screen is kept, the full redraw
+        # below covers the modal
+        TFT.resume
         draw_ui 'slot' + slot.to_s + '.rb'
 
         $last_status_line = nil
         draw_status(save_result ? '--SAVED--' : '--FAILED--', current_row)
       else
         loaded = SDCard.load(slot)
+        $slot_mrb = loaded ? SDCard.load_mrb(slot) : nil
 
-        TFT.init
+        TFT.resume
         TFT.fill_screen(0x070707)
         draw_ui 'slot' + slot.to_s + '.rb'
 
         if loaded
-          lines = loaded.split("\n")
-
-          code_lines = []
-
-          lines.each do |line|
-            stripped = line.lstrip
-            indent = (line.length - stripped.length) / 2
-            code_lines << {text: stripped, indent: indent}
-          end
+          loaded_lines = slot_lines(loaded)
+          Undo.lines(0, undo_buffer(code_lines, code, indent_ct), undo_buffer(loaded_lines, '', 0))
+          code_lines = loaded_lines
 
           code = ''
           indent_ct = 0
@@ -1023,8 +1363,40 @@ loop do
       next
     end
 
+    # Undo / redo
+    if key_event == $undo_key || key_event == $redo_key
+      ops = key_event == $undo_key ? Undo.undo : Undo.redo
+      if ops
+        code_lines, code, indent_ct = apply_undo(ops, code_lines, code, indent_ct)
+        current_row = code_lines.length + 1
+        $completion_index = 0
+        $completion_candidates = []
+        $completion_chars = nil
+        need_full_redraw = true
+      end
+      next
+    end
+
     # alt + c
     if key_event == 12
+      # Stop running code first, keep the buffer
+      if $sandbox_running
+        stop_sandbox(sandbox, 'stopped')
+        result = 'stopped'
+        result_offset = 0
+        draw_result(result, result_offset)
+        $last_status_line = nil
+        draw_status('--NORMAL--', current_row)
+        next
+      end
+
+      # Empty buffer: clear the console instead
+      if code_lines.empty? && code.empty?
+        Console.clear
+      else
+        Undo.lines(0, undo_buffer(code_lines, code, indent_ct), undo_buffer([], '', 0))
+      end
+
       code = ''
       code_lines = []
       indent_ct = 0
@@ -1047,6 +1419,7 @@ loop do
         if code == '' && code_lines.length > 0
           # Move cursor to prev line
           prev_line = code_lines.pop
+          Undo.lines(code_lines.length, [prev_line, {text: code, indent: indent_ct}], [prev_line])
           code = prev_line[:text]
           indent_ct = prev_line[:indent]
           current_row -= 1
@@ -1066,8 +1439,10 @@ loop do
 
         elsif code.length > 0
           if $cursor_col.nil?
+            Undo.delete(code_lines.length, code.length - 1, code[-1])
             code = code[0..-2]
           elsif $cursor_col > 0
+            Undo.delete(code_lines.length, $cursor_col - 1, code[$cursor_col - 1])
             code = code[0...$cursor_col-1] + code[$cursor_col..]
             $cursor_col -= 1
           end
@@ -1082,8 +1457,10 @@ loop do
 
         if line[:text].length > 0
           if $cursor_col.nil?
+            Undo.delete($cursor_line_index, line[:text].length - 1, line[:text][-1])
             line[:text] = line[:text][0..-2]
           elsif $cursor_col > 0
+            Undo.delete($cursor_line_index, $cursor_col - 1, line[:text][$cursor_col - 1])
             line[:text] = line[:text][0...$cursor_col-1] + line[:text][$cursor_col..]
             $cursor_col -= 1
           end
@@ -1098,8 +1475,10 @@ loop do
       # Select completion candidate
       if $completion_chars.is_a?(String)
         if $cursor_line_index.nil?
+          Undo.insert(code_lines.length, code.length, $completion_chars)
           code << $completion_chars
         else
+          Undo.insert($cursor_line_index, code_lines[$cursor_line_index][:text].length, $completion_chars)
           code_lines[$cursor_line_index][:text] << $completion_chars
         end
 
@@ -1124,10 +1503,11 @@ loop do
       # On existing line, move to next line
       if $cursor_line_index.is_a?(Integer)
         if $cursor_line_index < code_lines.length - 1
-          need_full_redraw = move_cursor_between_lines($cursor_line_index + 1, code_lines)
+          need_full_redraw = true if move_cursor_between_lines($cursor_line_index + 1, code_lines)
           draw_status('--NORMAL--', $cursor_line_index + 1)
         else
-          code, indent_ct, need_full_redraw = move_cursor_to_new_line(code_lines, current_row)
+          code, indent_ct, scrolled = move_cursor_to_new_line(code_lines, current_row)
+          need_full_redraw = true if scrolled
           draw_completion(code, code_lines.length)
           draw_status('--NORMAL--', current_row)
         end
@@ -1135,12 +1515,26 @@ loop do
         next
       end
 
+      # Editor command instead of code
+      if editor_command?(code)
+        Undo.delete(code_lines.length, 0, code)
+        Lazy.load :commands
+        result = run_command(code[1, code.length - 1], code_lines, indent_ct)
+        result_offset = 0
+        need_result_redraw = true
+        code = ''
+        $cursor_col = nil
+        need_full_redraw = true
+        next
+      end
+
       # Append execute code
       if code != ''
         execute_code << code
         execute_code << "\n"
 
         tokens = tokenize(code)
+        old_indent = indent_ct
 
         tokens.each do |token|
           if INDENT_DECREASE.include?(token)
@@ -1165,6 +1559,9 @@ loop do
           end
         end
 
+        Undo.lines(code_lines.length - 1, [{text: code, indent: old_indent}],
+                   [prev_line_for_newline, {text: '', indent: indent_ct}])
+
         code = ''
         current_row += 1
         $cursor_col = nil
@@ -1174,7 +1571,8 @@ loop do
         $scroll_start = adjust_scroll(nil, code_lines.length)
 
         # Full redraw if scroll changed, otherwise just redraw 2 lines
-        if old_scroll != $scroll_start
+        # (a second newline in the same batch also needs the full redraw)
+        if old_scroll != $scroll_start || need_newline_redraw
           need_full_redraw = true
         else
           need_newline_redraw = true
@@ -1182,30 +1580,46 @@ loop do
 
       # Execute code
       elsif indent_ct == 0 && code_lines.length > 0
-        # Rebuild execute_code from code_lines (in case lines were edited)
-        execute_code = ''
-        code_lines.each do |line|
-          execute_code << "#{'  ' * line[:indent]}#{line[:text]}\n"
-        end
+        # One program at a time, keep the buffer until the run ends
+        next if $sandbox_running
 
-        if sandbox.compile("_ = (#{execute_code})", remove_lv: true)
-          sandbox.execute
-          sandbox.wait(timeout: nil)
+        # Rebuild the source from code_lines (in case lines were edited)
+        source = sandbox_source(code_lines)
 
-          err = sandbox.error
-          if err.nil?
-            result = sandbox.result
-          else
-            result = "#{err} #{err.message}"
-          end
+        # A loaded slot brings its bytecode, skip the compiler if it still matches
+        mrb = $slot_mrb
+        $slot_mrb = nil
 
-          sandbox.suspend
+        sandbox.memory_begin
+        if mrb && mrb[0] == SDCard.source_hash(source) && sandbox.exec_mrb(mrb[1])
+          started = true
+          $running_mrb = mrb[1]  # keep the image alive while it runs
+        elsif sandbox.compile(source, remove_lv: true)
+          sandbox.execute
+          started = true
         else
-          result = "syntax error"
+          started = false
         end
 
-        result_offset = 0
-        draw_result(result, result_offset)
+        if started
+          # Run in the background, the main loop gives it CPU slices
+          $sandbox_running = true
+          run_started_ms = Event.now_ms
+          result = nil
+          TFT.fill_rect(22, 208, 298, 12, 0x070707)
+          $last_status_line = nil
+          draw_status('--NORMAL--', 1)
+        else
+          sandbox.release(false)
+
+          # Where, if the checker has seen this buffer (cached results come back at once)
+          version = Checker.submit(check_source(code_lines, 0))
+          check = Checker.result
+          apply_check(check, code_lines) if check
+          result = version && version == $check_version && $check_message ? "syntax error #{$check_message}" : 'syntax error'
+          result_offset = 0
+          draw_result(result, result_offset)
+        end
 
         # Add to completion dict
         code_lines.each do |line|
@@ -1239,7 +1653,8 @@ loop do
               end
             end
 
-            if token == 'require'
+            # New constants (the first completion loads them anyway)
+            if token == 'require' && Lazy.loaded?(:completion)
               load_constants
             end
           end
@@ -1251,6 +1666,9 @@ loop do
         $dict.delete('attr_accessor')
         $dict.delete('initialize')
 
+        # The program can be brought back with undo
+        Undo.lines(0, undo_buffer(code_lines, code, indent_ct), undo_buffer([], '', 0))
+
         code_lines = []
         execute_code = ''
         indent_ct = 0
@@ -1271,6 +1689,7 @@ loop do
 
     # SDCard save - open slot modal
     elsif key_event == 20
+      Lazy.load :slots
       $slot_modal_mode = :save
       $slot_selected = 0
       draw_slot_modal(:save)
@@ -1278,6 +1697,7 @@ loop do
 
     # SDCard load - open slot modal
     elsif key_event == 2
+      Lazy.load :slots
       $slot_modal_mode = :load
       $slot_selected = 0
       draw_slot_modal(:load)
@@ -1290,196 +1710,177 @@ loop do
     end
   end
 
-  # Track ball (check every 2 loops)
-  if loop_counter >= 2
-    loop_counter = 0
-
-    r_high = right.high?
-    l_high = left.high?
-    u_high = up.high?
-    d_high = down.high?
-
-    # Debug: show trackball state
-    # TFT.fill_rect(200, 4, 120, 14, 0x2D2D2D)
-    # draw_text("U:#{u_high ? 1 : 0} D:#{d_high ? 1 : 0} R:#{r_high ? 1 : 0} L:#{l_high ? 1 : 0}", 202, 8, 0x6E6E6E)
-
-    # Reset flags when released
-    $right_pressed = false if !r_high
-    $left_pressed = false if !l_high
-    $up_pressed = false if !u_high
-    $down_pressed = false if !d_high
-
-    # Slot modal navigation
-    if $slot_modal_mode
-      if u_high && !$up_pressed
-        debounce_track
-
-        if $slot_selected >= 2
-          $slot_selected -= 2
-          draw_slot_modal($slot_modal_mode)
-        end
-      elsif d_high && !$down_pressed
-        debounce_track
+  unless key_events.empty?
+    check_pending = true
+    last_key_ms = Event.now_ms
+  end
+  Session.touch unless key_events.empty?
 
-        if $slot_selected <= 5
-          $slot_selected += 2
-          draw_slot_modal($slot_modal_mode)
-        end
-      elsif l_high && !$left_pressed
-        debounce_track
+  # Track ball (edges are counted natively between polls)
+  dx, dy = Trackball.delta
+  dx, dy = replay[1], replay[2] if replay
 
-        if $slot_selected % 2 == 1
-          $slot_selected -= 1
-          draw_slot_modal($slot_modal_mode)
-        end
-      elsif r_high && !$right_pressed
-        debounce_track
+  if $trace_recording && (!key_events.empty? || dx != 0 || dy != 0)
+    Trace.pass(key_events, dx, dy)
+  end
 
-        if $slot_selected % 2 == 0
-          $slot_selected += 1
-          draw_slot_modal($slot_modal_mode)
-        end
-      end
+  if dx != 0 || dy != 0
+    Undo.seal
+    Session.touch
 
-      next
-    end
+    if $doc_open
+      need_full_redraw = true if dy != 0 && move_doc_cursor(dy)
 
-    # Completion navigation
-    if $completion_candidates.length > 0
-      if u_high && !$up_pressed
-        debounce_track
+    elsif $slot_modal_mode
+      move_slot_selection(dx, dy)
 
-        if $completion_index > 0
-          $completion_index -= 1
-          need_line_redraw = true
-        end
-      elsif d_high && !$down_pressed
-        debounce_track
+    elsif $completion_candidates.length > 0
+      # Completion navigation
+      index = $completion_index + dy
+      index = 0 if index < 0
+      index = $completion_candidates.length - 1 if index >= $completion_candidates.length
 
-        if $completion_index < $completion_candidates.length - 1
-          $completion_index += 1
-          need_line_redraw = true
-        end
+      if index != $completion_index
+        $completion_index = index
+        need_line_redraw = true
       end
 
-      next
-    end
+    else
+      # Vertical cursor navigation (a fast flick moves several lines at once)
+      if console_shown
+        scroll_console(dy) if dy != 0
 
-    # Vertical cursor navigation (when not in modal or completion)
-    if u_high && !$up_pressed
-      debounce_track
+      elsif dy < 0
+        if $cursor_line_index.nil?
+          # Currently on new line, move up into code_lines
+          if code_lines.length > 0
+            old_scroll = $scroll_start
+            visual_col = visual_column(indent_ct, code.length)
+
+            $saved_new_line = code
+            $saved_new_indent = indent_ct
+            $cursor_line_index = [code_lines.length + dy, 0].max
+
+            new_line = code_lines[$cursor_line_index]
+            adjust_cursor_col(visual_col, new_line[:indent], new_line[:text].length)
+            new_scroll = adjust_scroll($cursor_line_index, code_lines.length)
+
+            if old_scroll != new_scroll
+              $scroll_start = new_scroll
+              need_full_redraw = true
+            else
+              draw_line_at($cursor_line_index, true, code_lines, $scroll_start)
+              draw_new_line_at($saved_new_line, $saved_new_indent, current_row, code_lines.length, false)
+            end
 
-      # Move cursor up
-      if $cursor_line_index.nil?
-        # Currently on new line, move to last code_line
-        if code_lines.length > 0
-          old_scroll = $scroll_start
-          visual_col = visual_column(indent_ct, code.length)
-
-          $saved_new_line = code
-          $saved_new_indent = indent_ct
-          $cursor_line_index = code_lines.length - 1
-
-          new_line = code_lines[$cursor_line_index]
-          adjust_cursor_col(visual_col, new_line[:indent], new_line[:text].length)
-          new_scroll = adjust_scroll($cursor_line_index, code_lines.length)
-
-          if old_scroll != new_scroll
-            $scroll_start = new_scroll
-            need_full_redraw = true
-          else
-            draw_line_at($cursor_line_index, true, code_lines, $scroll_start)
-            draw_new_line_at($saved_new_line, $saved_new_indent, current_row, code_lines.length, false)
+            clear_completion_box
+            draw_status('--NORMAL--', $cursor_line_index + 1)
           end
 
-          clear_completion_box
+        elsif $cursor_line_index > 0
+          target = [$cursor_line_index + dy, 0].max
+          need_full_redraw = true if move_cursor_between_lines(target, code_lines)
           draw_status('--NORMAL--', $cursor_line_index + 1)
         end
 
-      elsif $cursor_line_index > 0
-        need_full_redraw = move_cursor_between_lines($cursor_line_index - 1, code_lines)
-        draw_status('--NORMAL--', $cursor_line_index + 1)
-      end
-
-    elsif d_high && !$down_pressed
-      debounce_track
-
-      # Move cursor down
-      if $cursor_line_index.nil?
-        # Already on new line, can't go down
-      elsif $cursor_line_index < code_lines.length - 1
-        need_full_redraw = move_cursor_between_lines($cursor_line_index.to_i + 1, code_lines)
-        draw_status('--NORMAL--', $cursor_line_index + 1)
-      else
-        code, indent_ct, need_full_redraw = move_cursor_to_new_line(code_lines, current_row)
-        draw_completion(code, code_lines.length)
-        draw_status('--NORMAL--', current_row)
+      elsif dy > 0
+        if $cursor_line_index.nil?
+          # Already on new line, can't go down
+        elsif $cursor_line_index + dy <= code_lines.length - 1
+          need_full_redraw = true if move_cursor_between_lines($cursor_line_index + dy, code_lines)
+          draw_status('--NORMAL--', $cursor_line_index + 1)
+        else
+          code, indent_ct, scrolled = move_cursor_to_new_line(code_lines, current_row)
+          need_full_redraw = true if scrolled
+          draw_completion(code, code_lines.length)
+          draw_status('--NORMAL--', current_row)
+        end
       end
-    end
-
-    # Left/Right trackball handling
-    has_code = !code_lines.empty? || !code.empty?
 
-    if r_high && !$right_pressed
-      debounce_track
+      # Left/Right trackball handling
+      has_code = !code_lines.empty? || !code.empty?
 
-      if has_code
-        # Move cursor right
-        current_text = $cursor_line_index.nil? ? code : code_lines[$cursor_line_index][:text]
-        if $cursor_col.nil?
-          # Do nothing if at end
-        elsif $cursor_col < current_text.length
-          $cursor_col += 1
+      if dx != 0
+        if has_code
+          # Move cursor horizontally (nil = end of line)
+          current_text = $cursor_line_index.nil? ? code : code_lines[$cursor_line_index][:text]
+          col = ($cursor_col.nil? ? current_text.length : $cursor_col) + dx
+          col = 0 if col < 0
+          col = nil if col >= current_text.length
 
-          if $cursor_col >= current_text.length
-            $cursor_col = nil
+          if col != $cursor_col
+            $cursor_col = col
+            need_line_redraw = true
+          end
+        elsif result
+          # Scroll result only when no code exists
+          offset = result_offset + dx * 8
+          offset = 0 if offset < 0
+
+          # Stop at the end without formatting the whole result
+          while offset > result_offset && Inspect.window(result, offset, 1) == ''
+            offset -= 8
           end
 
-          need_line_redraw = true
-        end
-      elsif result
-        # Scroll result only when no code exists
-        res_str = result.to_s
-        check_offset = result_offset + 8
-
-        if res_str.length >= check_offset
-          result_offset += 8
-          need_result_redraw = true
+          if offset != result_offset
+            result_offset = offset
+            need_result_redraw = true
+          end
         end
       end
-    elsif l_high && !$left_pressed
-      debounce_track
-
-      if has_code
-        # Move cursor left
-        current_text = $cursor_line_index.nil? ? code : code_lines[$cursor_line_index][:text]
-
-        if $cursor_col.nil?
-          $cursor_col = current_text.length - 1 if current_text.length > 0
-        elsif $cursor_col > 0
-          $cursor_col -= 1
-        end
-
-        need_line_redraw = true
-      elsif result
-        # Scroll result only when no code exists
-        check_offset = result_offset - 8
-
-        if check_offset >= 0
-          result_offset = check_offset
-        else
-          result_offset = 0
-        end
+    end
+  end
 
-        need_result_redraw = true
-      end
+  # `$document = n` from the editor opens a document, nil closes it
+  if $document != $doc_open
+    Lazy.load :document
+    if $document.nil?
+      close_document
+    elsif !open_document($document)
+      Console.write("document #{$document} could not be opened\n")
+      $document = nil
     end
+    need_full_redraw = true
+    $last_status_line = nil
+    draw_status('--NORMAL--', current_row) unless $doc_open
+  end
+
+  # Console pane takes over the code area while the buffer is empty
+  show_console = !$doc_open && Console.last_line >= Console.first_line &&
+                 ($console_pinned || (code_lines.empty? && code.empty?))
+  if show_console != console_shown
+    console_shown = show_console
+    need_full_redraw = true
+  end
 
-    next
+  # Syntax check once typing pauses for CHECK_DELAY_MS (trackball, timer
+  # and other key-less passes come sooner), the result comes back with
+  # Event::CHECK
+  check_wait_ms = check_pending ? CHECK_DELAY_MS - (Event.now_ms - last_key_ms) : nil
+  if check_wait_ms && check_wait_ms <= 0
+    Checker.submit(check_source(code_lines, indent_ct))
+    check_pending = false
   end
+  check = Checker.result
+  need_full_redraw = true if check && apply_check(check, code_lines)
+
+  # Snapshot the session once input has paused for 2 s (SESSION_QUIET_MS)
+  save_session(code_lines, code, indent_ct, current_row, execute_code) if Session.wait_ms == 0
 
   # Redraw
-  if need_full_redraw
+  Trace.redraw_begin if $trace_playing
+  Perf.redraw(need_full_redraw, need_newline_redraw, need_line_redraw)
+  if $doc_open
+    draw_document if need_full_redraw
+    need_full_redraw = false
+    need_line_redraw = false
+    need_newline_redraw = false
+  elsif console_shown
+    draw_console(need_full_redraw) unless $slot_modal_mode
+    need_full_redraw = false
+    need_line_redraw = false
+    need_newline_redraw = false
+  elsif need_full_redraw
     draw_code_area(code_lines, code, indent_ct, current_row)
     need_full_redraw = false
     need_line_redraw = false
@@ -1500,4 +1901,63 @@ loop do
     draw_result(result, result_offset)
     need_result_redraw = false
   end
+  Trace.redraw_end if $trace_playing
+  Perf.frame_end
+
+  # Latency HUD or heap overlay, refreshed by the 1 s event timer
+  overlay = $perf_hud ? :perf : ($mem_overlay ? :mem : nil)
+  if overlay != tab_overlay
+    Lazy.load :status
+    tab_overlay = overlay
+    Event.set_timer(tab_overlay ? 1000 : 0)
+    clear_mem_overlay
+    if tab_overlay == :mem
+      draw_mem_overlay
+    elsif tab_overlay == :perf
+      Perf.fps   # the first HUD shows the second from now
+    end
+  elsif tab_overlay && (events & Event::TIMER) != 0
+    tab_overlay == :perf ? draw_perf_hud : draw_mem_overlay
+  end
+
+  if $sandbox_running
+    # Let user code run for one slice, then come back for input
+    if sandbox.wait(timeout: SANDBOX_SLICE_MS)
+      result = take_sandbox_result(sandbox)
+      result_offset = 0
+      draw_result(result, result_offset)
+      $last_status_line = nil
+      draw_status('--NORMAL--', $cursor_line_index.nil? ? current_row : $cursor_line_index + 1)
+    else
+      sandbox.memory_sample
+
+      # Measured from the start: slices that return early and the time
+      # spent on keys and redraws in between all count
+      if $sandbox_budget_ms > 0 && Event.now_ms - run_started_ms >= $sandbox_budget_ms
+        result = "timeout (#{$sandbox_budget_ms} ms)"
+        stop_sandbox(sandbox, result)
+        result_offset = 0
+        draw_result(result, result_offset)
+        $last_status_line = nil
+        draw_status('--NORMAL--', $cursor_line_index.nil? ? current_row : $cursor_line_index + 1)
+      end
+    end
+    events = Event.wait(0)
+  elsif $search_pattern
+    # Keep streaming slot hits, input still comes first
+    step_search
+    events = Event.wait(0)
+  elsif $trace_playing
+    # Next replayed pass right away, or when it is due at the recorded timing
+    events = Event.wait(Trace.wait_ms)
+  else
+    # Sleep until a key, trackball, timer, SD or check event arrives
+    # (after typing, wake up when the pause is long enough for a check
+    # or a session snapshot); Power dims the backlight and light sleeps
+    # while nothing comes
+    timeout = check_wait_ms && check_wait_ms > 0 ? check_wait_ms : nil
+    save_ms = Session.wait_ms
+    timeout = save_ms if save_ms && (timeout.nil? || save_ms < timeout)
+    events = timeout ? Power.wait(timeout) : Power.wait
+  end
 end
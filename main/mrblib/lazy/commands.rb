@@ -0,0 +1,281 @@
+#############################################################################
+#                                 Commands                                  #
+#############################################################################
+# Loaded by the first ':' command (the list is in app.rb, with the state
+# the main loop reads)
+
+# ti-doc: Split a command argument into [pattern, regex]
+def command_pattern(arg)
+  if arg.length > 2 && arg[0] == '/' && arg[-1] == '/'
+    [arg[1, arg.length - 2], true]
+  else
+    [arg, false]
+  end
+end
+
+# ti-doc: Find in the buffer, move the cursor to the first hit, then search the slots
+def command_find(arg, code_lines, indent_ct)
+  pattern, regex = command_pattern(arg)
+  return 'find: bad pattern' unless Search.start(pattern, regex)
+
+  hits = Search.scan(code_lines.map { |line| line[:text] }.join("\n"))
+  Console.write("find #{arg}\n")
+  hits.each do |hit|
+    Console.write("#{hit[0] + 1}:#{hit[1] + 1}: #{code_lines[hit[0]][:text]}\n")
+  end
+
+  if hits.length > 0
+    $saved_new_line = ''
+    $saved_new_indent = indent_ct
+    $cursor_line_index = hits[0][0]
+    $cursor_col = hits[0][1]
+    $scroll_start = adjust_scroll($cursor_line_index, code_lines.length)
+  end
+
+  # Slot hits stream into the console from the main loop
+  if Search.slots
+    $search_pattern = arg
+    $search_hits = 0
+  end
+  "#{hits.length} hits in buffer"
+end
+
+# ti-doc: Replace in the buffer (and in every slot with slots = true)
+def command_replace(arg, code_lines, slots)
+  sep = arg.index(' ')
+  return 'replace: missing replacement' if sep.nil?
+
+  pattern, regex = command_pattern(arg[0, sep])
+  return 'replace: bad pattern' unless Search.start(pattern, regex)
+  replacement = arg[sep + 1, arg.length - sep - 1]
+
+  count = 0
+  code_lines.each_with_index do |line, i|
+    replaced = Search.replace(line[:text], replacement)
+    next if replaced.nil? || replaced[1] == 0
+    # One undo step with the command line
+    Undo.lines(i, [{text: line[:text], indent: line[:indent]}], [{text: replaced[0], indent: line[:indent]}], true)
+    line[:text] = replaced[0]
+    count += replaced[1]
+  end
+  $cursor_col = nil
+  msg = "#{count} replaced"
+
+  if slots
+    slot_count = 0
+    8.times do |slot|
+      n = Search.replace_slot(slot, replacement)
+      slot_count += n if n
+    end
+    msg << ", #{slot_count} in slots"
+  end
+  msg
+end
+
+# ti-doc: Record, stop or replay a keystroke trace
+def command_trace(arg)
+  words = arg.split(' ')
+  slot = words.length > 1 ? words[1].to_i : 0
+
+  case words[0]
+  when 'rec'
+    return 'trace: busy' if $trace_recording || $trace_playing
+    return "trace: cannot record #{slot}" unless Trace.record(slot)
+    $trace_recording = true
+    $trace_slot = slot
+    "recording trace #{slot}"
+  when 'stop'
+    return 'trace: not recording' unless $trace_recording
+    $trace_recording = false
+    saved = Trace.stop
+    saved ? "#{saved} events saved to trace #{$trace_slot}" : 'trace: save failed'
+  when 'play'
+    return 'trace: busy' if $trace_recording || $trace_playing
+    return "trace #{slot} is empty" unless Trace.play(slot, words[2] == 'real')
+    $trace_playing = true
+    $trace_slot = slot
+    "replaying trace #{slot}"
+  else
+    'trace: rec N | stop | play N [real]'
+  end
+end
+
+# ti-doc: ' (was N)' when a previous replay of the trace reported N
+def trace_prev(value)
+  value > 0 ? " (was #{value})" : ''
+end
+
+# ti-doc: End the trace replay and report it in the console
+def finish_trace(stopped)
+  $trace_playing = false
+  res = Trace.finish
+  if res.nil?
+    Console.write("trace #{$trace_slot}: nothing replayed\n")
+  else
+    Console.write("trace #{$trace_slot}#{stopped ? ' (stopped)' : ''}: #{res[:passes]} passes, #{res[:keys]} keys\n")
+    Console.write("  wall #{res[:wall_ms]} ms#{trace_prev(res[:prev_wall_ms])}\n")
+    Console.write("  handle #{res[:handle_ms]} ms#{trace_prev(res[:prev_handle_ms])}\n")
+    Console.write("  redraw #{res[:redraw_ms]} ms#{trace_prev(res[:prev_redraw_ms])}\n")
+    Console.write("  pass p50 #{res[:p50_us]} us, p99 #{res[:p99_us]} us#{trace_prev(res[:prev_p99_us])}\n")
+    Console.write("  pass max #{res[:max_us]} us\n")
+  end
+  $console_pinned = true
+end
+
+# ti-doc: Write one benchmark result (median, min-max, allocations per run) to the console
+def bench_report(name, res)
+  if res.nil?
+    Console.write("#{name}: no samples\n")
+    return
+  end
+  allocs = res[:allocs] / res[:iterations]
+  Console.write("#{name}: #{format_milli(res[:median_ns])} us (#{format_milli(res[:min_ns])}-#{format_milli(res[:max_ns])}) #{allocs} allocs\n")
+end
+
+# ti-doc: Time the editor hot paths with the cycle counter and write the results to the console
+def command_bench(code_lines)
+  line = "def draw(x, y) TFT.fill_rect(x, y, 10, 'abc'.length) end"
+  Console.write("bench: median us (min-max), allocs per run\n")
+
+  # A block that clearly allocates must count, or the allocs below mean nothing
+  probe = Bench.measure(10) { 'a' * 10 }
+  if probe.nil? || probe[:allocs] == 0
+    Console.write("bench: allocation counter not hooked, allocs below read 0\n")
+  end
+
+  bench_report('tokenize', Bench.measure(100) { tokenize(line) })
+  bench_report('draw_code_highlighted', Bench.measure(50) { draw_code_highlighted(line, 4, CODE_AREA_Y_START) })
+  bench_report('draw_completion', Bench.measure(50) { draw_completion('TF', 0) })
+  clear_completion_box
+
+  # Typing on a scratch line, not recorded so the undo history is kept
+  saved_line = $cursor_line_index
+  saved_col = $cursor_col
+  $cursor_line_index = nil
+  $cursor_col = nil
+  scratch = ''
+  Undo.pause
+  bench_report('insert_char_at_cursor', Bench.measure(200) { scratch = insert_char_at_cursor(scratch, 'a', code_lines) })
+  Undo.resume
+  $cursor_line_index = saved_line
+  $cursor_col = saved_col
+
+  [[8, 8], [64, 64], [320, 100]].each do |size|
+    # Fenced, so the run lasts until the render worker has sent the pixels
+    bench_report("fill_rect #{size[0]}x#{size[1]}", Bench.measure(20) { TFT.fill_rect(0, CODE_AREA_Y_START, size[0], size[1], 0x070707); TFT.fence })
+  end
+  bench_report('SDCard.load', Bench.measure(10, 1) { SDCard.load(0) })
+
+  $console_pinned = true
+  'bench done'
+end
+
+# ti-doc: Right align text in width columns
+def pad_left(text, width)
+  text.length < width ? "#{' ' * (width - text.length)}#{text}" : text
+end
+
+# ti-doc: Write the panel SPI sweep as a table to the console and repaint the screen it drew over
+def command_bench_spi
+  rows = Bench.spi_sweep
+  TFT.fill_screen(0x070707)
+  draw_ui $tab_file
+  $last_status_line = nil
+  return 'no panel' if rows.nil?
+
+  # us per transaction beyond the bits on the wire (x10 from C)
+  Console.write(" MHz mode  buf  chunk   KB/s us/xfer sd KB/s\n")
+  rows.each do |row|
+    mode = row[:queued] ? 'queue' : 'poll '
+    buf = row[:dma] ? 'dma ' : 'psrm'
+    over = row[:overhead_x10]
+    over_text = over < 0 ? "-#{-over / 10}.#{-over % 10}" : "#{over / 10}.#{over % 10}"
+    sd_text = row[:sd] ? row[:sd_kb_per_s].to_s : '-'
+    Console.write("#{pad_left(format_milli(row[:clock_khz]), 4)} #{mode} #{buf} #{pad_left(row[:chunk].to_s, 6)} #{pad_left(row[:kb_per_s].to_s, 6)} #{pad_left(over_text, 7)} #{pad_left(sd_text, 8)}\n")
+  end
+
+  $console_pinned = true
+  'bench spi done'
+end
+
+# ti-doc: Run an editor command line (without ':'), returns the message to show
+def run_command(line, code_lines, indent_ct)
+  sep = line.index(' ')
+  name = sep ? line[0, sep] : line
+  arg = sep ? line[sep + 1, line.length - sep - 1] : ''
+
+  case name
+  when 'find'
+    command_find(arg, code_lines, indent_ct)
+  when 'replace', 'replace!'
+    command_replace(arg, code_lines, name == 'replace!')
+  when 'console'
+    $console_pinned = true
+    'console'
+  when 'trace'
+    command_trace(arg)
+  when 'bench'
+    arg == 'spi' ? command_bench_spi : command_bench(code_lines)
+  when 'hud'
+    $perf_hud = !$perf_hud
+    $perf_hud ? 'hud on' : 'hud off'
+  when 'perf'
+    if arg == 'reset'
+      Perf.reset
+      'perf reset'
+    else
+      dump_perf
+      $console_pinned = true
+      'perf'
+    end
+  else
+    "unknown command: #{name}"
+  end
+end
+
+# ti-doc: Write the slot hits found since the last pass to the console
+def step_search
+  hits = Search.step(4)
+  if hits.nil?
+    Console.write("#{$search_hits} hits in slots\n")
+    $search_pattern = nil
+    return
+  end
+
+  hits.each do |hit|
+    Console.write("slot#{hit[0]}.rb:#{hit[1] + 1}:#{hit[2] + 1}: #{hit[3]}\n")
+  end
+  $search_hits += hits.length
+end
+
+# ti-doc: Write the latency histogram and redraw counts to the console
+def dump_perf
+  stats = Perf.stats
+  Console.write("keys #{stats[:keys]} (#{stats[:unseen]} drew nothing), frames #{stats[:frames]}\n")
+  Console.write("redraws full #{stats[:full]} newline #{stats[:newline]} line #{stats[:line]}\n")
+  Console.write("p50 #{format_milli(stats[:p50_us])} ms p99 #{format_milli(stats[:p99_us])} ms max #{format_milli(stats[:max_us])} ms\n")
+  Perf.histogram.each do |bucket|
+    Console.write("  >= #{format_milli(bucket[0])} ms: #{bucket[1]}\n")
+  end
+  render = TFT.render_stats
+  Console.write("render #{render[:commands]} cmds, #{render[:full_waits]} full, #{render[:fences]} fences #{format_milli(render[:fence_us])} ms, depth #{render[:max_depth]}\n")
+
+  # Time from the previous mark (the first one from app start)
+  boot = 'boot'
+  prev_us = 0
+  Perf.boot.each do |mark|
+    boot << " #{mark[0]} #{format_milli(mark[1] - prev_us)}"
+    prev_us = mark[1]
+  end
+  Console.write("#{boot} ms\n")
+
+  # Heap each module kept when it was loaded, and its load time
+  Console.write("modules (heap used #{Memory.used})\n")
+  Lazy.stats.each do |mod|
+    cost = mod[:loaded] ? "#{mod[:bytes]} bytes #{format_milli(mod[:us])} ms" : 'not loaded'
+    Console.write("  #{mod[:name]}: #{cost}\n")
+  end
+
+  power = Power.stats
+  Console.write("power #{power[:sleeps]} sleeps #{format_milli(power[:sleep_ms])} s, #{power[:input_wakes]} input wakes, #{power[:dims]} dims\n")
+end
@@ -0,0 +1,110 @@
+#############################################################################
+#                               Completion                                  #
+#############################################################################
+# Loaded by the draw_completion stub in app.rb the first time there is
+# something to complete; these definitions replace the stub
+
+# Editor constants left out of the completion words
+INTERNAL_CONSTANTS = [
+  'HIGHLIGHT_KEYWORDS',
+  'INDENT_INCREASE',
+  'INDENT_DECREASE',
+  'INTERNAL_CONSTANTS',
+  'CODE_AREA_Y_START',
+  'CODE_AREA_Y_END',
+  'RESULT_COLS',
+  'SANDBOX_SLICE_MS',
+  'CONSOLE_ROWS',
+  'CONSOLE_COLS',
+  'DOC_ROWS',
+  'DOC_COLS',
+  'CHECK_DELAY_MS'
+]
+
+# ti-doc: Load constants for completion
+def load_constants
+  Object.constants.each do |constant|
+    constant_str = constant.to_s
+
+    if INTERNAL_CONSTANTS.include?(constant_str) || constant_str.index('Error') != nil
+      next
+    end
+
+    $dict[constant_str] = true
+  end
+end
+
+# ti-doc: Draw completion and set $completion_chars
+def draw_completion(current_code, code_lines_count)
+  $completion_chars = nil
+  $completion_candidates = []
+
+  clear_completion_box
+
+  return if current_code == ''
+
+  tokens = tokenize(current_code)
+  target = tokens.last
+
+  return if target.nil? || target == '' || target == ' '
+
+  candidates = []
+
+  $dict.keys.each do |key|
+    if key.length > target.length && key[0, target.length] == target
+      candidates << key
+    end
+  end
+
+  return if candidates.length == 0
+
+  candidates = candidates[0, 6]
+  candidates << '(skip)'
+  $completion_candidates = candidates
+
+  if $completion_index >= candidates.length
+    $completion_index = 0
+  end
+
+  # Set completion chars (nil for skip option)
+  if $completion_index == candidates.length - 1
+    $completion_chars = nil
+  else
+    selected = candidates[$completion_index]
+    $completion_chars = selected[target.length, selected.length]
+  end
+
+  box_x = 222
+  box_y = CODE_AREA_Y_START + 2 + (code_lines_count * 10 + 10)
+
+  if (box_y + 70) >= 207
+    box_y = 116
+  end
+
+  box_w = 96
+  box_h = candidates.length * 10 + 4
+
+  $draw_completion_box_y = box_y
+  $completion_box_visible = true
+
+  TFT.overlay_begin
+  TFT.fill_rect(box_x + 1, box_y + 1, box_w, box_h, 0x000000)
+  TFT.fill_rect(box_x, box_y, box_w, box_h, 0x252526)
+  TFT.draw_rect(box_x, box_y, box_w, box_h, 0x303030)
+
+  highlight_y = box_y + 1 + $completion_index * 10
+  TFT.fill_rect(box_x + 1, highlight_y, box_w - 2, 10, 0x094771)
+
+  candidates.each_with_index do |candidate, idx|
+    y = box_y + 2 + idx * 10
+
+    if candidate == '(skip)'
+      draw_text(candidate, box_x + 2, y, 0x6E6E6E)
+    else
+      disp_name = candidate.length > 14 ? candidate[0, 13] + '..' : candidate
+      color = (candidate[0] >= 'A' && candidate[0] <= 'Z') ? 0x4EC9B0 : 0xFFFCDA
+      draw_text(disp_name, box_x + 2, y, color)
+    end
+  end
+  TFT.overlay_end
+end
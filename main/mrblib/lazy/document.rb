@@ -0,0 +1,122 @@
+#############################################################################
+#                                Document                                   #
+#############################################################################
+# Loaded when `$document` first changes; the view state lives in app.rb
+DOC_ROWS = 16
+DOC_COLS = 47
+DOC_LINE_MAX = 256   # longest editable line (document_store.h)
+
+# ti-doc: Open a document in the code area, false if it cannot be read
+def open_document(doc)
+  if Document.open(doc).nil?
+    $doc_open = nil
+    return false
+  end
+
+  $doc_open = doc
+  $doc_top = 0
+  $doc_cursor = 0
+  clear_completion_box
+  forget_code_rows
+  true
+end
+
+# ti-doc: Close the open document (unsaved edits are dropped)
+def close_document
+  Document.close
+  $doc_open = nil
+  $document = nil
+  forget_code_rows
+end
+
+# ti-doc: Draw one document row unless it already shows the same line
+def draw_doc_row(row, n)
+  text = Document.line(n)
+  active = n == $doc_cursor
+  sig = text.nil? ? '' : "#{n}:#{active}:#{text}"
+  return if $row_sigs[row] == sig
+  $row_sigs[row] = sig
+
+  y = CODE_AREA_Y_START + row * 10
+  TFT.fill_rect(0, y, 320, 10, 0x070707)
+  return if text.nil?
+
+  ln = (n + 1).to_s
+  TFT.draw_fast_v_line(33, y - 2, 10, 0x303030)
+  draw_text("#{' ' * (5 - ln.length)}#{ln}", 0, y, active ? 0xD4D4D4 : 0x6E6E6E)
+  draw_text(text[0, DOC_COLS], 38, y, 0xD4D4D4)
+  draw_text('_', 38 + [text.length, DOC_COLS - 1].min * 6, y, 0x007ACC) if active
+end
+
+# ti-doc: Draw the visible document rows (unchanged rows are skipped)
+def draw_document
+  if $row_sigs.empty?
+    TFT.fill_rect(0, CODE_AREA_Y_START, 320, CODE_AREA_Y_END - CODE_AREA_Y_START, 0x070707)
+  end
+
+  DOC_ROWS.times do |row|
+    draw_doc_row(row, $doc_top + row)
+  end
+
+  $last_status_line = nil
+  draw_status("--DOC #{$doc_open}#{Document.modified? ? ' +' : ''}--", $doc_cursor + 1)
+end
+
+# ti-doc: Move the document cursor by dy lines, true if a redraw is needed
+def move_doc_cursor(dy)
+  last = [Document.lines - 1, 0].max
+  cursor = $doc_cursor + dy
+  cursor = 0 if cursor < 0
+  cursor = last if cursor > last
+  return false if cursor == $doc_cursor
+
+  $doc_cursor = cursor
+  $doc_top = cursor if cursor < $doc_top
+  $doc_top = cursor - DOC_ROWS + 1 if cursor >= $doc_top + DOC_ROWS
+  true
+end
+
+# ti-doc: Handle a key in the document view, true if a redraw is needed
+def doc_key(key_event)
+  # alt + c closes, sym + S saves
+  if key_event == 12
+    close_document
+    return true
+  elsif key_event == 20
+    saved = Document.save
+    $last_status_line = nil
+    draw_status(saved ? '--SAVED--' : '--FAILED--', $doc_cursor + 1)
+    return false
+  end
+  return false unless key_event == 13 || key_event == 8 || (key_event >= 32 && key_event < 127)
+
+  Document.insert_line(0, '') if Document.lines == 0
+  text = Document.line($doc_cursor)
+  return false if text.nil?
+
+  if key_event == 13
+    Document.insert_line($doc_cursor + 1, '')
+    move_doc_cursor(1)
+    return true
+  end
+
+  # Document.line cuts longer lines: writing one back would lose the rest
+  if Document.line_size($doc_cursor) > DOC_LINE_MAX ||
+     (key_event != 8 && text.length >= DOC_LINE_MAX)
+    $last_status_line = nil
+    draw_status('--LINE TOO LONG--', $doc_cursor + 1)
+    return false
+  end
+
+  if key_event == 8
+    if text.empty?
+      Document.delete_line($doc_cursor)
+      move_doc_cursor(-1) if $doc_cursor >= Document.lines
+    else
+      Document.set_line($doc_cursor, text[0, text.length - 1])
+    end
+  else
+    Document.set_line($doc_cursor, text + key_event.chr)
+  end
+  true
+end
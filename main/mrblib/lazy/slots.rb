@@ -0,0 +1,111 @@
+#############################################################################
+#                               Save & Load                                 #
+#############################################################################
+# Loaded when the slot modal first opens; the modal state lives in app.rb
+
+# ti-doc: Draw slot selection modal
+def draw_slot_modal(mode)
+  # Modal background
+  box_x = 80
+  box_y = 50
+  box_w = 160
+  box_h = 120
+
+  # Drawn as an overlay so cancel can restore what was underneath
+  TFT.overlay_begin
+  TFT.fill_rect(box_x + 2, box_y + 2, box_w, box_h, 0x000000)
+  TFT.fill_rect(box_x, box_y, box_w, box_h, 0x252526)
+  TFT.draw_rect(box_x, box_y, box_w, box_h, 0x007ACC)
+
+  title = mode == :save ? 'Save to Slot' : 'Load from Slot'
+  title_x = box_x + (box_w - title.length * 6) / 2
+  draw_text(title, title_x, box_y + 6, 0xD4D4D4)
+
+  TFT.draw_fast_h_line(box_x + 1, box_y + 18, box_w - 2, 0x303030)
+
+  8.times do |i|
+    col = i % 2
+    row = i / 2
+    slot_x = box_x + 10 + col * 75
+    slot_y = box_y + 24 + row * 22
+
+    if i == $slot_selected
+      TFT.fill_rect(slot_x - 2, slot_y - 2, 70, 18, 0x094771)
+    end
+
+    label = "SLOT #{i}"
+    draw_text(label, slot_x, slot_y, 0xD4D4D4)
+  end
+
+  inst = 'Ball:Select Return:OK'
+  inst_x = box_x + (box_w - inst.length * 6) / 2
+  draw_text(inst, inst_x, box_y + box_h - 12, 0x6E6E6E)
+  TFT.overlay_end
+end
+
+# ti-doc: Put back the screen under the slot modal, false if not possible
+def restore_slot_modal
+  return true if TFT.restore_rect(80, 50, 162, 122)
+  forget_code_rows
+  false
+end
+
+# ti-doc: Close slot modal and restore screen
+def close_slot_modal
+  $slot_modal_mode = nil
+  $slot_selected = 0
+end
+
+# ti-doc: Move the modal selection with the trackball (one slot per event)
+def move_slot_selection(dx, dy)
+  selected = $slot_selected
+
+  if dy < 0 && selected >= 2
+    selected -= 2
+  elsif dy > 0 && selected <= 5
+    selected += 2
+  elsif dx < 0 && selected % 2 == 1
+    selected -= 1
+  elsif dx > 0 && selected % 2 == 0
+    selected += 1
+  end
+
+  if selected != $slot_selected
+    $slot_selected = selected
+    draw_slot_modal($slot_modal_mode)
+  end
+end
+
+# ti-doc: Write the buffer and its bytecode to a slot, true on success
+def save_to_slot(slot, code_lines, code, indent_ct)
+  full_code = ''
+
+  code_lines.each do |line|
+    full_code << "#{'  ' * line[:indent]}#{line[:text]}\n"
+  end
+  full_code << "#{'  ' * indent_ct}#{code}" if code != ''
+
+  save_result = SDCard.save(slot, full_code)
+
+  # Companion bytecode, keyed to the source as it will be run after loading
+  if save_result
+    saved_lines = code_lines.dup
+    saved_lines << {text: code, indent: indent_ct} if code != ''
+    SDCard.save_mrb(slot, sandbox_source(saved_lines))
+  end
+
+  save_result
+end
+
+# ti-doc: Split a loaded slot into {text:, indent:} lines
+def slot_lines(loaded)
+  loaded_lines = []
+
+  loaded.split("\n").each do |line|
+    stripped = line.lstrip
+    indent = (line.length - stripped.length) / 2
+    loaded_lines << {text: stripped, indent: indent}
+  end
+
+  loaded_lines
+end
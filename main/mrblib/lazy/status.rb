@@ -0,0 +1,33 @@
+#############################################################################
+#                                  Status                                   #
+#############################################################################
+# Tab bar overlays, loaded when `$mem_overlay` or `$perf_hud` first turns
+# one on
+
+# ti-doc: Draw heap free / largest block / fragmentation in the tab bar
+def draw_mem_overlay
+  stats = Memory.stats
+  free = stats[:free]
+  largest = Memory.largest_free
+  frag = largest && free > 0 ? 100 - largest * 100 / free : 0
+  max = largest ? "#{largest / 1024}K" : '-'
+
+  TFT.fill_rect(176, 4, 144, 14, 0x2D2D2D)
+  text = "#{free / 1024}K max #{max} #{frag}%"
+  draw_text(text, 316 - text.length * 6, 8, frag > 50 ? 0xCE9178 : 0x6E6E6E)
+end
+
+# ti-doc: Clear the heap overlay
+def clear_mem_overlay
+  TFT.fill_rect(176, 4, 144, 14, 0x2D2D2D)
+end
+
+# ti-doc: Draw key latency p50 / p99 (ms) and frames per second in the tab bar
+def draw_perf_hud
+  stats = Perf.stats
+  fps = Perf.fps
+
+  TFT.fill_rect(176, 4, 144, 14, 0x2D2D2D)
+  text = "#{format_milli(stats[:p50_us])}/#{format_milli(stats[:p99_us])}ms #{fps / 10}.#{fps % 10}fps"
+  draw_text(text, 316 - text.length * 6, 8, stats[:p99_us] > 50_000 ? 0xCE9178 : 0x6E6E6E)
+end
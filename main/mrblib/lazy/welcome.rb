@@ -0,0 +1,16 @@
+#############################################################################
+#                                 Welcome                                   #
+#############################################################################
+# Only a cold boot without a saved session shows it (see Lazy in app.rb)
+
+# ti-doc: Show the welcome screen until return is pressed
+def show_welcome
+  draw_text 'Pro Editor Pocket For Picoruby', 70, 110, 0xFFFFFF
+  draw_text 'Press return to start', 100, 135, 0x555555
+  draw_ruby_icon 252, 108
+
+  loop do
+    Power.wait
+    break if Keyboard.read_all.include?(13)
+  end
+end